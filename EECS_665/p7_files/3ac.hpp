@@ -5,9 +5,13 @@
 #include <list>
 #include <map>
 #include <set>
+#include <vector>
+#include <stdint.h>
 #include <string.h>
 #include "symbol_table.hpp"
 #include "types.hpp"
+#include "buffered_writer.hpp"
+#include "x64_emitter.hpp"
 
 namespace a_lang{
 
@@ -15,7 +19,9 @@ class TypeAnalysis;
 class Procedure;
 class IRProgram;
 class ControlFlowGraph;
+class CodeStats;
 class ASTNode;
+class IRWriter;
 
 class Label{
 public:
@@ -25,65 +31,72 @@ public:
 	std::string toString(){
 		return this->name;
 	}
-	std::string getName(){
+	const std::string& getName(){
 		return name;
 	}
 private:
 	std::string name;
 };
 
+//All 16 general-purpose registers. Codegen only writes the
+// caller-saved ones (frames don't save any others); the rest
+// are here so they can be named.
 enum Register{
-	A, B, C, D, DI, SI
+	A, B, C, D, DI, SI, BP, SP,
+	R8, R9, R10, R11, R12, R13, R14, R15
 };
 
 class RegUtils{
 public:
-	static std::string rootStr(Register reg){
-		switch(reg){
-			case A: return "a";
-			case B: return "b";
-			case C: return "c";
-			case D: return "d";
-			case DI: return "di";
-			case SI: return "si";
+	//Register names are preformatted in tables indexed
+	// by Register, so codegen never builds them as strings
+	static const char * reg64(Register reg){
+		static const char * const names[] = {
+			"%rax", "%rbx", "%rcx", "%rdx", "%rdi", "%rsi", "%rbp", "%rsp",
+			"%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+		};
+		return names[checked(reg)];
+	}
+
+	static const char * reg8(Register reg){
+		static const char * const names[] = {
+			"%al", "%bl", "%cl", "%dl", "%dil", "%sil", "%bpl", "%spl",
+			"%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
+		};
+		return names[checked(reg)];
+	}
+
+	//Whether a procedure has to give the register back as it
+	// found it (SysV)
+	static bool calleeSaved(Register reg){
+		switch (reg){
+		case B: case BP: case SP: case R12: case R13: case R14: case R15:
+			return true;
+		default:
+			return false;
 		}
 	}
-
-	static std::string reg64(Register reg){
-		switch(reg){
-			case A: return "%rax";
-			case B: return "%rbx";
-			case C: return "%rcx";
-			case D: return "%rdx";
-			case DI: return "%rdi";
-			case SI: return "%rsi";
-		}
-		throw new InternalError("no such register");
-	}
-
-	static std::string reg8(Register reg){
-		switch(reg){
-			case A: return "%al";
-			case B: return "%bl";
-			case C: return "%cl";
-			case D: return "%dl";
-			case DI: return "%dil";
-			case SI: return "%sil";
+private:
+	static size_t checked(Register reg){
+		size_t idx = static_cast<size_t>(reg);
+		if (idx > static_cast<size_t>(R15)){
+			throw new InternalError("no such register");
 		}
-		throw new InternalError("no such register");
+		return idx;
 	}
 };
 
 class Opd{
 public:
 	Opd(size_t widthIn) : myWidth(widthIn), myIsFunction(false){}
+	virtual ~Opd(){ }
 	virtual std::string valString() = 0;
 	virtual std::string locString() = 0;
 	virtual size_t getWidth(){ return myWidth; }
-	virtual void genLoadAddr(std::ostream& out, Register reg) = 0;
-	virtual void genStoreAddr(std::ostream& out, Register reg) = 0;
-	virtual void genLoadVal(std::ostream& out, Register reg) = 0;
-	virtual void genStoreVal(std::ostream& out, Register reg) = 0;
+	virtual void genLoadAddr(X64Emitter& out, Register reg) = 0;
+	virtual void genStoreAddr(X64Emitter& out, Register reg) = 0;
+	virtual void genLoadVal(X64Emitter& out, Register reg) = 0;
+	virtual void genStoreVal(X64Emitter& out, Register reg) = 0;
 	static size_t width(const DataType * type){
 		if (const BasicType * basic = type->asBasic()){
 			return basic->getSize();
@@ -93,7 +106,7 @@ public:
 		}
 		return type->getSize();
 	}
-	virtual std::string getMovOp(){
+	virtual const char * getMovOp(){
 		switch(myWidth){
 			case 1: return "movb ";
 			case 8: return "movq ";
@@ -101,7 +114,12 @@ public:
 
 		throw new InternalError("Bad mov width");
 	}
-	std::string getReg(Register reg){
+	const char * getReg(Register reg){
+		//Frames don't save registers, so values only go through
+		// the caller-saved ones
+		if (RegUtils::calleeSaved(reg)){
+			throw new InternalError("callee-saved register not saved");
+		}
 		switch(myWidth){
 			case 1: return RegUtils::reg8(reg);
 			case 8: return RegUtils::reg64(reg);
@@ -110,7 +128,7 @@ public:
 	}
 	bool isFunction(){ return myIsFunction; }
 	void setIsFunction(bool isFnIn){ myIsFunction = isFnIn; }
-	virtual std::string getMemoryLoc() = 0;
+	virtual const std::string& getMemoryLoc() = 0;
 private:
 	size_t myWidth;
 	bool myIsFunction;
@@ -128,16 +146,16 @@ public:
 		return mySym->getName();
 	}
 	const SemSymbol * getSym(){ return mySym; }
-	virtual void genLoadVal(std::ostream& out, Register reg) override;
-	virtual void genStoreVal(std::ostream& out, Register reg) override;
-	virtual void genLoadAddr(std::ostream& out, Register reg) override;
-	virtual void genStoreAddr(std::ostream& out, Register reg) override{
+	virtual void genLoadVal(X64Emitter& out, Register reg) override;
+	virtual void genStoreVal(X64Emitter& out, Register reg) override;
+	virtual void genLoadAddr(X64Emitter& out, Register reg) override;
+	virtual void genStoreAddr(X64Emitter& out, Register reg) override{
 		throw new InternalError("Cannot change the addr of a symOpd");
 	}
 	virtual void setMemoryLoc(std::string loc){
 		myLoc = loc;
 	}
-	virtual std::string getMemoryLoc() override{
+	virtual const std::string& getMemoryLoc() override{
 		return myLoc;
 	}
 private:
@@ -176,18 +194,18 @@ public:
 	virtual std::string locString() override{
 		throw InternalError("Tried to get location of a constant");
 	}
-	virtual void genLoadVal(std::ostream& out, Register reg) override;
-	virtual void genStoreVal(std::ostream& out, Register reg) override{
+	virtual void genLoadVal(X64Emitter& out, Register reg) override;
+	virtual void genStoreVal(X64Emitter& out, Register reg) override{
 		throw new InternalError("Cannot change value of a literal");
 	}
-	virtual void genLoadAddr(std::ostream& out, Register reg) override{
+	virtual void genLoadAddr(X64Emitter& out, Register reg) override{
 		throw new InternalError("Cannot get addr of a literal");
 	}
-	virtual void genStoreAddr(std::ostream& out, Register reg) override{
+	virtual void genStoreAddr(X64Emitter& out, Register reg) override{
 		throw new InternalError("Cannot set the addr of a literal");
 	}
 
-	virtual std::string getMemoryLoc() override{
+	virtual const std::string& getMemoryLoc() override{
 		throw InternalError("Tried to get location of a constant");
 	}
 private:
@@ -207,17 +225,17 @@ public:
 	std::string getName(){
 		return name;
 	}
-	virtual void genLoadVal(std::ostream& out, Register reg) override;
-	virtual void genStoreVal(std::ostream& out, Register reg) override;
-	virtual void genLoadAddr(std::ostream& out, Register reg) override;
-	virtual void genStoreAddr(std::ostream& out, Register reg) override{
+	virtual void genLoadVal(X64Emitter& out, Register reg) override;
+	virtual void genStoreVal(X64Emitter& out, Register reg) override;
+	virtual void genLoadAddr(X64Emitter& out, Register reg) override;
+	virtual void genStoreAddr(X64Emitter& out, Register reg) override{
 		throw new InternalError("Cannot change the addr of a auxOpd");
 	}
 
 	virtual void setMemoryLoc(std::string loc){
 		myLoc = loc;
 	}
-	virtual std::string getMemoryLoc() override{
+	virtual const std::string& getMemoryLoc() override{
 		return myLoc;
 	}
 
@@ -236,15 +254,15 @@ public:
 	virtual std::string locString() override{
 		return "[" + getName() + "]";
 	}
-	virtual void genLoadAddr(std::ostream& out, Register reg) override;
-	virtual void genStoreAddr(std::ostream& out, Register reg) override;
-	virtual void genLoadVal(std::ostream& out, Register reg) override;
-	virtual void genStoreVal(std::ostream& out, Register reg) override;
+	virtual void genLoadAddr(X64Emitter& out, Register reg) override;
+	virtual void genStoreAddr(X64Emitter& out, Register reg) override;
+	virtual void genLoadVal(X64Emitter& out, Register reg) override;
+	virtual void genStoreVal(X64Emitter& out, Register reg) override;
 
 	virtual void setMemoryLoc(std::string loc){
 		myLoc = loc;
 	}
-	virtual std::string getMemoryLoc() override{
+	virtual const std::string& getMemoryLoc() override{
 		return myLoc;
 	}
 	virtual std::string getName(){
@@ -266,12 +284,16 @@ enum UnaryOp{
 	NEG64, NEG8, NOT64, NOT8
 };
 
-std::string binOpToX64(BinOp opr);
+const char * binOpToX64(BinOp opr);
 Register indexToReg(size_t index);
 
 class Quad{
 public:
+	//Width of the label column in a quad's text
+	static const size_t LABEL_SPACE = 12;
+
 	Quad();
+	virtual ~Quad(){ }
 	void addLabel(Label * label);
 	Label * getLabel(){ return labels.front(); }
 	void clearLabels(){ labels.clear(); }
@@ -279,11 +301,34 @@ public:
 	std::string commentStr();
 	virtual std::string toString(bool verbose=false);
 	void setComment(std::string commentIn);
-	virtual void codegenX64(std::ostream& out) = 0;
-	void codegenLabels(std::ostream& out);
+	virtual void codegenX64(X64Emitter& out) = 0;
+	void codegenLabels(X64Emitter& out);
+	//Write the quad's kind and fields in the binary IR format
+	// (labels and comment are written by the IRWriter)
+	virtual void writeIR(IRWriter& out) = 0;
+	//Short name of the quad's kind, as -stats reports it
+	virtual const char * kind() const = 0;
+	//The operands the quad reads (added to srcs) and the one
+	// it writes, if any, for the optimization passes
+	virtual void uses(std::vector<Opd *>& srcs){ }
+	virtual Opd * def(){ return nullptr; }
+	//Read to wherever the quad reads from
+	virtual void replaceUse(Opd * from, Opd * to){ }
+	//Uses its operands in ways the passes don't model (as
+	// addresses), so they must leave those operands alone
+	virtual bool opaque() const { return false; }
+	//Where the quad may jump instead of falling through, if
+	// anywhere
+	virtual Label * branchTarget(){ return nullptr; }
+	const std::list<Label *>& getLabels() const { return labels; }
+	const std::string& getComment() const { return myComment; }
+	//Slot of this quad in its procedure's QuadList
+	size_t getHandle() const { return myHandle; }
 private:
 	std::string myComment;
 	std::list<Label *> labels;
+	size_t myHandle = SIZE_MAX;
+	friend class QuadList;
 };
 
 class BinOpQuad : public Quad{
@@ -291,7 +336,12 @@ public:
 	BinOpQuad(Opd * dstIn, BinOp oprIn, Opd * src1In, Opd * src2In);
 	std::string repr() override;
 	static std::string oprString(BinOp opr);
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "binop"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	Opd * def() override;
+	void replaceUse(Opd * from, Opd * to) override;
 	Opd * getDst(){ return dst; }
 	Opd * getSrc1(){ return src1; }
 	Opd * getSrc2(){ return src2; }
@@ -307,7 +357,12 @@ class UnaryOpQuad : public Quad {
 public:
 	UnaryOpQuad(Opd * dstIn, UnaryOp opIn, Opd * srcIn);
 	std::string repr() override ;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "unaryop"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	Opd * def() override;
+	void replaceUse(Opd * from, Opd * to) override;
 	Opd * getDst(){ return dst; }
 	Opd * getSrc(){ return src; }
 	UnaryOp getOp(){ return op; }
@@ -321,7 +376,12 @@ class AssignQuad : public Quad{
 public:
 	AssignQuad(Opd * dstIn, Opd * srcIn);
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "assign"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	Opd * def() override;
+	void replaceUse(Opd * from, Opd * to) override;
 	Opd * getDst(){ return dst; }
 	Opd * getSrc(){ return src; }
 private:
@@ -336,7 +396,11 @@ public:
 	LocQuad(Opd * srcIn, Opd * tgtIn, bool srcLocIn, bool tgtLocIn)
 	: src(srcIn), tgt(tgtIn), srcIsLoc(srcLocIn), tgtIsLoc(tgtLocIn){ }
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "loc"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	bool opaque() const override { return true; }
 private:
 	Opd * src;
 	Opd * tgt;
@@ -348,7 +412,10 @@ class GotoQuad : public Quad {
 public:
 	GotoQuad(Label * tgtIn);
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "goto"; }
+	Label * branchTarget() override { return tgt; }
 	Label * getTarget(){ return tgt; }
 private:
 	Label * tgt;
@@ -360,7 +427,32 @@ public:
 	std::string repr() override;
 	Label * getTarget(){ return tgt; }
 	Opd * getCnd(){ return cnd; }
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "ifz"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	void replaceUse(Opd * from, Opd * to) override;
+	Label * branchTarget() override { return tgt; }
+private:
+	Opd * cnd;
+	Label * tgt;
+};
+
+//Jumps when the condition is true: an IFZ turned around, so
+// that the branch's likelier side can be the one that falls
+// through
+class IfnzQuad : public Quad {
+public:
+	IfnzQuad(Opd * cndIn, Label * tgtIn);
+	std::string repr() override;
+	Label * getTarget(){ return tgt; }
+	Opd * getCnd(){ return cnd; }
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "ifnz"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	void replaceUse(Opd * from, Opd * to) override;
+	Label * branchTarget() override { return tgt; }
 private:
 	Opd * cnd;
 	Label * tgt;
@@ -370,7 +462,22 @@ class NopQuad : public Quad {
 public:
 	NopQuad();
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "nop"; }
+};
+
+//Bumps one of the program's block counters (-fprofile-generate)
+class CountQuad : public Quad {
+public:
+	CountQuad(size_t counterIn);
+	std::string repr() override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "count"; }
+	size_t getCounter(){ return counter; }
+private:
+	size_t counter;
 };
 
 class WriteQuad : public Quad {
@@ -379,7 +486,11 @@ public:
 	std::string repr() override;
 	Opd * getSrc(){ return mySrc; }
 	const DataType * getType(){ return mySrcType; }
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "write"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	void replaceUse(Opd * from, Opd * to) override;
 private:
 	Opd * mySrc;
 	const DataType * mySrcType;
@@ -391,7 +502,10 @@ public:
 	std::string repr() override;
 	Opd * getDst(){ return myDst; }
 	const DataType * getType(){ return myDstType; }
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "read"; }
+	Opd * def() override;
 private:
 	Opd * myDst;
 	const DataType * myDstType;
@@ -401,7 +515,9 @@ class CallQuad : public Quad{
 public:
 	CallQuad(SemSymbol * calleeIn);
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "call"; }
 private:
 	Opd * calleeOpd;
 	SemSymbol * sym;
@@ -411,7 +527,9 @@ class EnterQuad : public Quad{
 public:
 	EnterQuad(Procedure * proc);
 	virtual std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "enter"; }
 private:
 	Procedure * myProc;
 };
@@ -420,7 +538,9 @@ class LeaveQuad : public Quad{
 public:
 	LeaveQuad(Procedure * proc);
 	virtual std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "leave"; }
 private:
 	Procedure * myProc;
 };
@@ -429,7 +549,11 @@ class SetArgQuad : public Quad{
 public:
 	SetArgQuad(size_t indexIn, Opd * opdIn, const DataType * typeIn);
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "setarg"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	void replaceUse(Opd * from, Opd * to) override;
 	Opd * getSrc(){ return opd; }
 	size_t getIndex(){ return index; }
 	const DataType * getType(){ return type; }
@@ -443,7 +567,10 @@ class GetArgQuad : public Quad{
 public:
 	GetArgQuad(size_t indexIn, Opd * opdIn);
 	std::string repr() override;
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "getarg"; }
+	Opd * def() override;
 	Opd * getDst(){ return opd; }
 private:
 	size_t index;
@@ -455,7 +582,11 @@ public:
 	SetRetQuad(Opd * opdIn);
 	std::string repr() override;
 	Opd * getSrc(){ return opd; }
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "setret"; }
+	void uses(std::vector<Opd *>& srcs) override;
+	void replaceUse(Opd * from, Opd * to) override;
 private:
 	Opd * opd;
 };
@@ -465,23 +596,91 @@ public:
 	GetRetQuad(Opd * opdIn);
 	std::string repr() override;
 	Opd * getDst(){ return opd; }
-	void codegenX64(std::ostream& out) override;
+	void codegenX64(X64Emitter& out) override;
+	void writeIR(IRWriter& out) override;
+	const char * kind() const override { return "getret"; }
+	Opd * def() override;
 private:
 	Opd * opd;
 };
 
+//The body quads of a procedure. Quads are kept in one
+// contiguous array of slots threaded into a doubly-linked
+// list by index, so a slot index is a stable handle to a
+// quad: replacing, inserting before, or erasing a quad is
+// O(1) and never moves any other quad.
+class QuadList{
+public:
+	static const size_t NONE = SIZE_MAX;
+
+	class iterator{
+	public:
+		iterator(const QuadList * listIn, size_t slotIn)
+		: list(listIn), slot(slotIn){ }
+		Quad * operator*() const { return list->slots[slot].quad; }
+		iterator& operator++(){
+			slot = list->slots[slot].next;
+			return *this;
+		}
+		bool operator!=(const iterator& other) const {
+			return slot != other.slot;
+		}
+		size_t handle() const { return slot; }
+	private:
+		const QuadList * list;
+		size_t slot;
+	};
+
+	QuadList() : head(NONE), tail(NONE), count(0){ }
+	iterator begin() const { return iterator(this, head); }
+	iterator end() const { return iterator(this, NONE); }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	Quad * back() const;
+	Quad * at(size_t handle) const;
+	//The quad after the one at handle, or nullptr at the end
+	Quad * next(size_t handle) const;
+
+	size_t push_back(Quad * quad);
+	Quad * pop_back();
+	size_t insertBefore(size_t handle, Quad * quad);
+	void replace(size_t handle, Quad * quad);
+	void erase(size_t handle);
+private:
+	struct Slot{
+		Quad * quad;
+		size_t prev;
+		size_t next;
+	};
+	size_t allocSlot(Quad * quad);
+	void unlink(size_t handle);
+
+	std::vector<Slot> slots;
+	std::vector<size_t> freeSlots;
+	size_t head;
+	size_t tail;
+	size_t count;
+};
+
+//How a procedure's frame is set up (chosen by allocLocals)
+enum FrameKind{
+	FULL_FRAME, //%rbp saved and set, %rsp lowered past the slots
+	NO_FRAME,   //A leaf: no %rbp, the slots in the red zone off %rsp
+	LAZY_FRAME  //%rbp set, %rsp lowered only on the way to a call
+};
+
 class Procedure{
 public:
 	Procedure(IRProgram * prog, std::string name);
+	//Frees the procedure's quads, labels and operands
+	~Procedure();
+	Procedure(const Procedure&) = delete;
+	Procedure& operator=(const Procedure&) = delete;
 	void addQuad(Quad * quad);
 	Quad * popQuad();
 	IRProgram * getProg();
-	std::list<SymOpd *> getFormals() { return formals; }
-	SymOpd * getFormal(size_t idx){
-		auto itr = formals.begin();
-		for (size_t i = 0; i < idx; i++, itr++);
-		return *itr;
-	}
+	const std::vector<SymOpd *>& getFormals() { return formals; }
+	SymOpd * getFormal(size_t idx){ return formals[idx]; }
 	a_lang::Label * makeLabel();
 
 	void gatherLocal(SemSymbol * sym);
@@ -489,37 +688,71 @@ public:
 	SymOpd * getSymOpd(SemSymbol * sym);
 	AuxOpd * makeTmp(size_t width);
 	AddrOpd * makeAddrOpd(size_t width);
+	//Literals are built fresh for each use; keeping them here
+	// lets them be freed along with the quads that use them
+	LitOpd * keepLit(LitOpd * lit);
 
-	std::string toString(bool verbose=false);
+	//Stream the procedure's 3AC (locals, then quads)
+	void write3AC(BufferedWriter& out, bool verbose=false);
 	std::string getName();
 
 	a_lang::Label * getLeaveLabel();
 
-	void toX64(std::ostream& out);
+	void toX64(X64Emitter& out);
 	size_t arSize() const;
 	size_t numTemps() const;
 	int getAllocBytes() const { return allocBytes; }
+	FrameKind getFrame() const { return frame; }
 
-	std::list<Quad *> * getQuads(){ return bodyQuads; }
+	QuadList * getQuads(){ return bodyQuads; }
 	EnterQuad * getEnter(){ return enter; }
 	LeaveQuad * getLeave(){ return leave; }
 	void replaceQuad(Quad * oldQuad, Quad * newQuad);
+	//The quad control reaches after quad (the leave quad
+	// after the last of the body)
+	Quad * nextQuad(Quad * quad);
+	//Replace a body quad, keeping its labels, and free it
+	void swapQuad(Quad * oldQuad, Quad * newQuad);
+	//Take a body quad out and free it. Its labels move to the
+	// next quad, so branches to it still land in the same place.
+	void removeQuad(Quad * quad);
+	//Put quad into the body just ahead of before (at the end if
+	// before is null). Branches to before still go to before.
+	void insertQuad(Quad * before, Quad * quad);
+	//Move a body quad, labels and all, to the end of the body
+	void moveToEnd(Quad * quad);
+	//Never run when profiled, so placed away from the hot code
+	void setCold(bool coldIn){ cold = coldIn; }
+	bool isCold() const { return cold; }
+	//Which of the runtime's function timers the code updates,
+	// with -fprofile-cycles
+	void setTimer(size_t timerIn){ timer = timerIn; timed = true; }
+	bool isTimed() const { return timed; }
+	size_t getTimer() const { return timer; }
 private:
 	void allocLocals();
+	friend class IRWriter;
+	friend class IRReader;
 
 	EnterQuad * enter;
 	LeaveQuad * leave;
 	Label * leaveLabel;
 
 	IRProgram * myProg;
-	std::map<SemSymbol *, SymOpd *> locals;
+	std::vector<SymOpd *> locals;
 	std::list<AuxOpd *> temps;
-	std::list<SymOpd *> formals;
+	std::vector<SymOpd *> formals;
 	std::list<AddrOpd *> addrOpds;
-	std::list<Quad *> * bodyQuads;
+	std::vector<LitOpd *> lits;
+	std::vector<Label *> labels;
+	QuadList * bodyQuads;
 	std::string myName;
 	size_t maxTmp;
 	int allocBytes;
+	FrameKind frame;
+	bool cold;
+	bool timed;
+	size_t timer;
 };
 
 class IRProgram{
@@ -532,20 +765,61 @@ public:
 		auto t = FnType::produce(argsType, BasicType::BOOL());
 		randSym = new FnSymbol("randBool", t);
 	}
+	//Frees the procedures, the global and string operands and
+	// any symbols kept with keepSym
+	~IRProgram();
+	IRProgram(const IRProgram&) = delete;
+	IRProgram& operator=(const IRProgram&) = delete;
 	Procedure * makeProc(std::string name);
 	std::list<Procedure *> * getProcs();
+	//Quads in the procedures (and global initializer) held now
+	size_t numQuads();
 	Label * makeLabel();
 	Opd * makeString(std::string val);
 	void gatherGlobal(SemSymbol * sym);
 	SymOpd * getGlobal(SemSymbol * sym);
+	//The operand of any gathered symbol (global, formal
+	// or local), looked up by symbol ID
+	SymOpd * getSymOpd(SemSymbol * sym);
+	void bindSymOpd(SemSymbol * sym, SymOpd * opd);
 	size_t opWidth(ASTNode * node);
 	const DataType * nodeType(ASTNode * node);
 	std::set<Opd *> globalSyms();
-	std::string toString(bool verbose=false);
-
-	void toX64(std::ostream& out);
+	//Stream the whole program's 3AC, one quad at a time
+	void write3AC(BufferedWriter& out, bool verbose=false);
+
+	void toX64(X64Emitter& out);
+	//Lay out and lower each procedure as toX64 would, recording
+	// its statistics instead of writing the code anywhere
+	void statsX64(CodeStats& stats);
+	//Write the globals, strings and procedures added since the
+	// last call, then free those procedures. Lets a program be
+	// emitted one declaration at a time.
+	void streamX64(X64Emitter& out);
+	//Streaming: account for a function whose code was written
+	// from a cache instead of being lowered. Its global is
+	// bound but not written again, and the label and string
+	// numbers it used are skipped.
+	void reuseProc(SemSymbol * fnSym, size_t numLabels,
+	  size_t numStrings);
+	//Lay out the block counters of a -fprofile-generate build,
+	// and the table the runtime writes ahead of their values
+	void setProfileTable(size_t numCounters, const std::string& table);
+	//Time each procedure with rdtsc, for the flat profile the
+	// runtime prints at exit
+	//Time each procedure (see ac_fn_stats), in -o and -stats alike
+	void setCycleProfile(bool on);
+	//How many labels and strings have been numbered so far
+	size_t labelsMade() const { return max_label; }
+	size_t stringsMade() const { return str_idx; }
+	//Types for the nodes being lowered
+	void setTypes(TypeAnalysis * taIn){ ta = taIn; }
 	Procedure * getInitProc(){ return init; }
 	SemSymbol * getRandSym(){ return randSym; }
+	//Symbols made by the program itself (when it is read back
+	// from binary IR) rather than by name analysis, to be freed
+	// along with it
+	SemSymbol * keepSym(SemSymbol * sym);
 private:
 	TypeAnalysis * ta;
 	size_t max_label = 0;
@@ -553,11 +827,23 @@ private:
 	std::list<Procedure *> * procs;
 	Procedure * init;
 	SemSymbol * randSym;
-	HashMap<LitOpd *, std::string> strings;
+	//Strings and globals in the order they were made, so the
+	// data comes out the same from run to run
+	std::vector<std::pair<LitOpd *, std::string>> strings;
 	std::map<SemSymbol *, SymOpd *> globals;
-
-	void datagenX64(std::ostream& out);
+	std::vector<SymOpd *> globalOrder;
+	std::vector<SymOpd *> symOpds;
+	//Globals not yet written out by streamX64
+	std::vector<SymOpd *> newGlobals;
+	std::vector<SemSymbol *> ownSyms;
+	size_t profCounters = 0;
+	std::string profTable;
+	bool cycleProfile = false;
+
+	void datagenX64(X64Emitter& out);
 	void allocGlobals();
+	friend class IRWriter;
+	friend class IRReader;
 };
 
 }
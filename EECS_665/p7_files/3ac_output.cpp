@@ -1,7 +1,21 @@
-#include "ast.hpp"
+#include "ast_walk.hpp"
 
 namespace a_lang{
 
+bool ASTNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	throw new InternalError("No 3AC for this node");
+}
+
+bool ExpNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	walk.opds.push_back(flatten(walk.proc));
+	return false;
+}
+
+bool StmtNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	to3AC(walk.proc);
+	return false;
+}
+
 IRProgram * ProgramNode::to3AC(TypeAnalysis * ta){
 	IRProgram * prog = new IRProgram(ta);
 	for (auto global : *myGlobals){
@@ -67,7 +81,7 @@ void FormalDeclNode::to3AC(Procedure * proc){
 }
 
 Opd * IntLitNode::flatten(Procedure * proc){
-	return LitOpd::buildInt(myNum);
+	return proc->keepLit(LitOpd::buildInt(myNum));
 }
 
 Opd * StrLitNode::flatten(Procedure * proc){
@@ -76,33 +90,41 @@ Opd * StrLitNode::flatten(Procedure * proc){
 }
 
 Opd * TrueNode::flatten(Procedure * proc){
-	Opd * res = new LitOpd("1", 8);
+	Opd * res = proc->keepLit(new LitOpd("1", 8));
 	return res;
 }
 
 
 Opd * FalseNode::flatten(Procedure * proc){
-	Opd * res = new LitOpd("0", 8);
+	Opd * res = proc->keepLit(new LitOpd("0", 8));
 	return res;
 }
 
-static void argsTo3AC(Procedure * proc, std::list<ExpNode *> * args){
-	std::list<std::pair<Opd *, const DataType *>> argOpds;
-	for (auto argNode : *args){
-		Opd * argOpd = argNode->flatten(proc);
-		const DataType * argType = proc->getProg()->nodeType(argNode);
-		argOpds.push_back(std::make_pair(argOpd, argType));
+Opd * CallExpNode::flatten(Procedure * proc){
+	FlattenWalk walk(proc);
+	walk.run(this);
+	return walk.popOpd();
+}
+
+bool CallExpNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	if (f.step == 0){ f.kids = walk.queue(myArgs); }
+	if (f.step < myArgs->size()){
+		return walk.visit(walk.kid(f, f.step));
 	}
+
+	//All the args are flat now, their results on top of the
+	// stack in order
+	Procedure * proc = walk.proc;
+	size_t firstArg = walk.opds.size() - myArgs->size();
 	size_t argIdx = 1;
-	for (auto argOpd : argOpds){
-		Quad * argQuad = new SetArgQuad(argIdx, argOpd.first, argOpd.second);
+	for (auto argNode : *myArgs){
+		Opd * argOpd = walk.opds[firstArg + argIdx - 1];
+		const DataType * argType = proc->getProg()->nodeType(argNode);
+		Quad * argQuad = new SetArgQuad(argIdx, argOpd, argType);
 		proc->addQuad(argQuad);
 		argIdx++;
 	}
-}
-
-Opd * CallExpNode::flatten(Procedure * proc){
-	argsTo3AC(proc, myArgs);
+	walk.opds.resize(firstArg);
 
 	SemSymbol * idSym = myCallee->getSymbol();
 	Quad * callQuad = new CallQuad(idSym);
@@ -111,17 +133,49 @@ Opd * CallExpNode::flatten(Procedure * proc){
 	const FnType * calleeType = idSym->getDataType()->asFn();
 	const DataType * retType = calleeType->getReturnType();
 	if (retType->isVoid()){
-		return nullptr;
+		walk.opds.push_back(nullptr);
 	} else {
 		Opd * retVal = proc->makeTmp(Opd::width(retType));
 		Quad * getRet = new GetRetQuad(retVal);
 		proc->addQuad(getRet);
-		return retVal;
+		walk.opds.push_back(retVal);
 	}
+	return false;
 }
 
-Opd * NegNode::flatten(Procedure * proc){
-	Opd * child = myExp->flatten(proc);
+Opd * UnaryExpNode::flatten(Procedure * proc){
+	FlattenWalk walk(proc);
+	walk.run(this);
+	return walk.popOpd();
+}
+
+bool UnaryExpNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	if (f.step == 0){ return walk.visit(myExp); }
+	Opd * child = walk.popOpd();
+	walk.opds.push_back(flattenOp(walk.proc, child));
+	return false;
+}
+
+Opd * BinaryExpNode::flatten(Procedure * proc){
+	FlattenWalk walk(proc);
+	walk.run(this);
+	return walk.popOpd();
+}
+
+bool BinaryExpNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	switch (f.step){
+	case 0: return walk.visit(myExp1);
+	case 1: return walk.visit(myExp2);
+	default: {
+		Opd * rhs = walk.popOpd();
+		Opd * lhs = walk.popOpd();
+		walk.opds.push_back(flattenOp(walk.proc, lhs, rhs));
+		return false;
+	}
+	}
+}
+
+Opd * NegNode::flattenOp(Procedure * proc, Opd * child){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * dst = proc->makeTmp(width);
 	UnaryOp opr = UnaryOp::NEG64;
@@ -130,8 +184,7 @@ Opd * NegNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * NotNode::flatten(Procedure * proc){
-	Opd * child = myExp->flatten(proc);
+Opd * NotNode::flattenOp(Procedure * proc, Opd * child){
 	size_t width = proc->getProg()->opWidth(myExp);
 	Opd * dst = proc->makeTmp(width);
 	UnaryOp opr = UnaryOp::NOT64;
@@ -143,9 +196,7 @@ Opd * NotNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * PlusNode::flatten(Procedure * proc){
-	Opd * childL = myExp1->flatten(proc);
-	Opd * childR = myExp2->flatten(proc);
+Opd * PlusNode::flattenOp(Procedure * proc, Opd * childL, Opd * childR){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * dst = proc->makeTmp(width);
 	BinOp opr = BinOp::ADD64;
@@ -155,9 +206,7 @@ Opd * PlusNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * MinusNode::flatten(Procedure * proc){
-	Opd * childL = myExp1->flatten(proc);
-	Opd * childR = myExp2->flatten(proc);
+Opd * MinusNode::flattenOp(Procedure * proc, Opd * childL, Opd * childR){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * dst = proc->makeTmp(width);
 	BinOp opr = BinOp::SUB64;
@@ -167,9 +216,7 @@ Opd * MinusNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * TimesNode::flatten(Procedure * proc){
-	Opd * childL = myExp1->flatten(proc);
-	Opd * childR = myExp2->flatten(proc);
+Opd * TimesNode::flattenOp(Procedure * proc, Opd * childL, Opd * childR){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * dst = proc->makeTmp(width);
 	BinOp opr = BinOp::MULT64;
@@ -179,9 +226,7 @@ Opd * TimesNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * DivideNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * DivideNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * dst = proc->makeTmp(width);
 	BinOp opr = BinOp::DIV64;
@@ -191,9 +236,7 @@ Opd * DivideNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * AndNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * AndNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * opRes = proc->makeTmp(width);
 	BinOp opr = BinOp::AND64;
@@ -203,9 +246,7 @@ Opd * AndNode::flatten(Procedure * proc){
 	return opRes;
 }
 
-Opd * OrNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * OrNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this);
 	Opd * opRes = proc->makeTmp(width);
 	BinOp opr = BinOp::OR64;
@@ -215,9 +256,7 @@ Opd * OrNode::flatten(Procedure * proc){
 	return opRes;
 }
 
-Opd * EqualsNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * EqualsNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -228,9 +267,7 @@ Opd * EqualsNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * NotEqualsNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * NotEqualsNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -241,9 +278,7 @@ Opd * NotEqualsNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * GreaterNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * GreaterNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -254,9 +289,7 @@ Opd * GreaterNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * GreaterEqNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * GreaterEqNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -267,9 +300,7 @@ Opd * GreaterEqNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * LessNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * LessNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -280,9 +311,7 @@ Opd * LessNode::flatten(Procedure * proc){
 	return dst;
 }
 
-Opd * LessEqNode::flatten(Procedure * proc){
-	Opd * op1 = this->myExp1->flatten(proc);
-	Opd * op2 = this->myExp2->flatten(proc);
+Opd * LessEqNode::flattenOp(Procedure * proc, Opd * op1, Opd * op2){
 	size_t width = proc->getProg()->opWidth(this->myExp1);
 	size_t resWidth = Opd::width(BasicType::BOOL());
 	Opd * dst = proc->makeTmp(resWidth);
@@ -317,7 +346,7 @@ void PostIncStmtNode::to3AC(Procedure * proc){
 	size_t width = proc->getProg()->opWidth(this->myLoc);
 	BinOp opr = BinOp::ADD64;
 	if (width == 1){ opr = BinOp::ADD8; }
-	LitOpd * litOpd = new LitOpd("1", width);
+	LitOpd * litOpd = proc->keepLit(new LitOpd("1", width));
 	BinOpQuad * quad = new BinOpQuad(child, opr, child, litOpd);
 	proc->addQuad(quad);
 }
@@ -338,7 +367,7 @@ void PostDecStmtNode::to3AC(Procedure * proc){
 	size_t width = proc->getProg()->opWidth(this->myLoc);
 	BinOp opr = BinOp::SUB64;
 	if (width == 1){ opr = BinOp::SUB8; }
-	LitOpd * litOpd = new LitOpd("1", width);
+	LitOpd * litOpd = proc->keepLit(new LitOpd("1", width));
 	BinOpQuad * quad = new BinOpQuad(child, opr, child, litOpd);
 	proc->addQuad(quad);
 }
@@ -360,67 +389,125 @@ void ToConsoleStmtNode::to3AC(Procedure * proc){
 }
 
 void IfStmtNode::to3AC(Procedure * proc){
-	Opd * cond = myCond->flatten(proc);
-	Label * afterLabel = proc->makeLabel();
-	Quad * afterNop = new NopQuad();
-	afterNop->addLabel(afterLabel);
+	FlattenWalk(proc).run(this);
+}
 
-	proc->addQuad(new IfzQuad(cond, afterLabel));
-	for (auto stmt : *myBody){
-		stmt->to3AC(proc);
+bool IfStmtNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	Procedure * proc = walk.proc;
+	if (f.step == 0){
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
 	}
-	proc->addQuad(afterNop);
+	if (f.step == 1){
+		Opd * cond = walk.popOpd();
+		Label * afterLabel = proc->makeLabel();
+		Quad * afterNop = new NopQuad();
+		afterNop->addLabel(afterLabel);
+		walk.quads.push_back(afterNop);
+
+		proc->addQuad(new IfzQuad(cond, afterLabel));
+	}
+	size_t i = f.step - 1;
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i));
+	}
+	proc->addQuad(walk.quads.back());
+	walk.quads.pop_back();
+	return false;
 }
 
 void IfElseStmtNode::to3AC(Procedure * proc){
-	Label * elseLabel = proc->makeLabel();
-	Quad * elseNop = new NopQuad();
-	elseNop->addLabel(elseLabel);
-	Label * afterLabel = proc->makeLabel();
-	Quad * afterNop = new NopQuad();
-	afterNop->addLabel(afterLabel);
-
-	Opd * cond = myCond->flatten(proc);
-
-	Quad * jmpFalse = new IfzQuad(cond, elseLabel);
-	proc->addQuad(jmpFalse);
-	for (auto stmt : *myBodyTrue){
-		stmt->to3AC(proc);
+	FlattenWalk(proc).run(this);
+}
+
+bool IfElseStmtNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	Procedure * proc = walk.proc;
+	if (f.step == 0){
+		Label * elseLabel = proc->makeLabel();
+		Quad * elseNop = new NopQuad();
+		elseNop->addLabel(elseLabel);
+		Label * afterLabel = proc->makeLabel();
+		Quad * afterNop = new NopQuad();
+		afterNop->addLabel(afterLabel);
+		walk.quads.push_back(afterNop);
+		walk.quads.push_back(elseNop);
+		walk.labels.push_back(afterLabel);
+		walk.labels.push_back(elseLabel);
+
+		f.kids = walk.queue(myBodyTrue);
+		walk.queue(myBodyFalse);
+		return walk.visit(myCond);
+	}
+	if (f.step == 1){
+		Opd * cond = walk.popOpd();
+		Label * elseLabel = walk.labels.back();
+		walk.labels.pop_back();
+		Quad * jmpFalse = new IfzQuad(cond, elseLabel);
+		proc->addQuad(jmpFalse);
 	}
 
-	Quad * skipFall = new GotoQuad(afterLabel);
-	proc->addQuad(skipFall);
-
-	proc->addQuad(elseNop);
+	size_t i = f.step - 1;
+	size_t numTrue = myBodyTrue->size();
+	if (i < numTrue){
+		return walk.visit(walk.kid(f, i));
+	}
+	if (i == numTrue){
+		Quad * skipFall = new GotoQuad(walk.labels.back());
+		walk.labels.pop_back();
+		proc->addQuad(skipFall);
 
-	for (auto stmt : *myBodyFalse){
-		stmt->to3AC(proc);
+		proc->addQuad(walk.quads.back());
+		walk.quads.pop_back();
+	}
+	if (i < numTrue + myBodyFalse->size()){
+		return walk.visit(walk.kid(f, i));
 	}
 
-	proc->addQuad(afterNop);
+	proc->addQuad(walk.quads.back());
+	walk.quads.pop_back();
+	return false;
 }
 
 void WhileStmtNode::to3AC(Procedure * proc){
-	Quad * headNop = new NopQuad();
-	Label * headLabel = proc->makeLabel();
-	headNop->addLabel(headLabel);
-
-	Label * afterLabel = proc->makeLabel();
-	Quad * afterQuad = new NopQuad();
-	afterQuad->addLabel(afterLabel);
-
-	proc->addQuad(headNop);
-	Opd * cond = myCond->flatten(proc);
-	Quad * jmpFalse = new IfzQuad(cond, afterLabel);
-	proc->addQuad(jmpFalse);
+	FlattenWalk(proc).run(this);
+}
+
+bool WhileStmtNode::lowerStep(FlattenWalk& walk, WalkFrame& f){
+	Procedure * proc = walk.proc;
+	if (f.step == 0){
+		Quad * headNop = new NopQuad();
+		Label * headLabel = proc->makeLabel();
+		headNop->addLabel(headLabel);
+
+		Label * afterLabel = proc->makeLabel();
+		Quad * afterQuad = new NopQuad();
+		afterQuad->addLabel(afterLabel);
+		walk.quads.push_back(afterQuad);
+		walk.labels.push_back(headLabel);
+		walk.labels.push_back(afterLabel);
+
+		proc->addQuad(headNop);
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
+	}
+	if (f.step == 1){
+		Opd * cond = walk.popOpd();
+		Quad * jmpFalse = new IfzQuad(cond, walk.labels.back());
+		walk.labels.pop_back();
+		proc->addQuad(jmpFalse);
+	}
 
-	for (auto stmt : *myBody){
-		stmt->to3AC(proc);
+	size_t i = f.step - 1;
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i));
 	}
 
-	Quad * loopBack = new GotoQuad(headLabel);
+	Quad * loopBack = new GotoQuad(walk.labels.back());
+	walk.labels.pop_back();
 	proc->addQuad(loopBack);
-	proc->addQuad(afterQuad);
+	proc->addQuad(walk.quads.back());
+	walk.quads.pop_back();
+	return false;
 }
 
 void MaybeStmtNode::to3AC(Procedure * proc){
@@ -466,10 +553,8 @@ void CallStmtNode::to3AC(Procedure * proc){
 	// was unnecessary. Remove it from the procedure.
 	if (res != nullptr){
 		//A void call will not generate a getout
-		Quad * last = proc->popQuad();
+		delete proc->popQuad();
 	}
-	//Should probably delete the last quad, but
-	// we've leaked so much memory why start worrying now?
 }
 
 void ReturnStmtNode::to3AC(Procedure * proc){
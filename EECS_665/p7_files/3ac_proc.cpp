@@ -1,14 +1,17 @@
 #include "3ac.hpp"
-#include <algorithm>
 
 namespace a_lang{
 
 Procedure::Procedure(IRProgram * prog, std::string name)
 : myProg(prog), myName(name){
 	maxTmp = 0;
+	frame = FULL_FRAME;
+	cold = false;
+	timed = false;
+	timer = 0;
 	enter = new EnterQuad(this);
 	leave = new LeaveQuad(this);
-	bodyQuads = new std::list<Quad *>();
+	bodyQuads = new QuadList();
 	if (myName.compare("main") == 0){
 		enter->addLabel(new Label("main"));
 	} else {
@@ -16,6 +19,28 @@ Procedure::Procedure(IRProgram * prog, std::string name)
 	}
 	leaveLabel = myProg->makeLabel();
 	leave->addLabel(leaveLabel);
+	labels.push_back(enter->getLabel());
+	labels.push_back(leaveLabel);
+}
+
+Procedure::~Procedure(){
+	for (auto quad : *bodyQuads){ delete quad; }
+	delete bodyQuads;
+	delete enter;
+	delete leave;
+	for (Label * label : labels){ delete label; }
+	for (LitOpd * lit : lits){ delete lit; }
+	//Later procedures mustn't find this one's operands
+	for (SymOpd * opd : formals){
+		myProg->bindSymOpd(opd->mySym, nullptr);
+		delete opd;
+	}
+	for (SymOpd * opd : locals){
+		myProg->bindSymOpd(opd->mySym, nullptr);
+		delete opd;
+	}
+	for (AuxOpd * opd : temps){ delete opd; }
+	for (AddrOpd * opd : addrOpds){ delete opd; }
 }
 
 std::string Procedure::getName(){
@@ -28,44 +53,40 @@ Label * Procedure::getLeaveLabel(){
 
 IRProgram * Procedure::getProg(){ return myProg; }
 
-std::string Procedure::toString(bool verbose){
-	std::string res = "";
-
-	res += "[BEGIN " + this->getName() + " LOCALS]\n";
+void Procedure::write3AC(BufferedWriter& out, bool verbose){
+	out << "[BEGIN " << this->getName() << " LOCALS]\n";
 	for (const auto formal : this->formals){
-		res += formal->getName() + " (formal arg of "
-			+ std::to_string(formal->getWidth())
-			+ " bytes)\n";
+		out << formal->getName() << " (formal arg of "
+			<< formal->getWidth() << " bytes)\n";
 	}
 
 	for (auto local : this->locals){
-		res += local.second->getName() + " (local var of "
-			+ std::to_string(local.second->getWidth())
-			+ " bytes)\n";
+		out << local->getName() << " (local var of "
+			<< local->getWidth() << " bytes)\n";
 	}
 
 	for (auto tmp : temps){
-		res += tmp->locString() + " (tmp var of "
-			+ std::to_string(tmp->getWidth())
-			+ " bytes)\n";
+		out << tmp->locString() << " (tmp var of "
+			<< tmp->getWidth() << " bytes)\n";
 	}
 	for (auto loc : this->addrOpds){
-		res += loc->locString() + " (tmp loc of "
-			+ std::to_string(loc->getWidth())
-			+ " bytes)\n";
+		out << loc->locString() << " (tmp loc of "
+			<< loc->getWidth() << " bytes)\n";
 	}
-	res += "[END " + this->getName() + " LOCALS]\n";
+	out << "[END " << this->getName() << " LOCALS]\n";
 
-	res += enter->toString(verbose) + "\n";
+	//Only one quad's text is ever materialized at a time
+	out << enter->toString(verbose) << "\n";
 	for (auto quad : *bodyQuads){
-		res += quad->toString(verbose) + "\n";
+		out << quad->toString(verbose) << "\n";
 	}
-	res += leave->toString(verbose) + "\n";
-	return res;
+	out << leave->toString(verbose) << "\n";
 }
 
 Label * Procedure::makeLabel(){
-	return myProg->makeLabel();
+	Label * label = myProg->makeLabel();
+	labels.push_back(label);
+	return label;
 }
 
 void Procedure::addQuad(Quad * quad){
@@ -79,34 +100,63 @@ Quad * Procedure::popQuad(){
 }
 
 void Procedure::replaceQuad(Quad * oldQuad, Quad * newQuad){
-	auto itr = std::find(bodyQuads->begin(), bodyQuads->end(), oldQuad);
-	itr = bodyQuads->erase(itr);
-	bodyQuads->insert(itr, newQuad);
+	bodyQuads->replace(oldQuad->getHandle(), newQuad);
+}
+
+Quad * Procedure::nextQuad(Quad * quad){
+	Quad * next = bodyQuads->next(quad->getHandle());
+	return next == nullptr ? leave : next;
+}
+
+static void moveLabels(Quad * from, Quad * to){
+	for (Label * label : from->getLabels()){ to->addLabel(label); }
+	from->clearLabels();
+}
+
+void Procedure::swapQuad(Quad * oldQuad, Quad * newQuad){
+	moveLabels(oldQuad, newQuad);
+	newQuad->setComment(oldQuad->getComment());
+	replaceQuad(oldQuad, newQuad);
+	delete oldQuad;
+}
+
+void Procedure::removeQuad(Quad * quad){
+	moveLabels(quad, nextQuad(quad));
+	bodyQuads->erase(quad->getHandle());
+	delete quad;
+}
+
+void Procedure::insertQuad(Quad * before, Quad * quad){
+	if (before == nullptr){
+		bodyQuads->push_back(quad);
+	} else {
+		bodyQuads->insertBefore(before->getHandle(), quad);
+	}
+}
+
+void Procedure::moveToEnd(Quad * quad){
+	bodyQuads->erase(quad->getHandle());
+	bodyQuads->push_back(quad);
 }
 
 void Procedure::gatherLocal(SemSymbol * sym){
 	size_t width = Opd::width(sym->getDataType());
-	locals[sym] = new SymOpd(sym, width);
+	SymOpd * opd = new SymOpd(sym, width);
+	locals.push_back(opd);
+	myProg->bindSymOpd(sym, opd);
 }
 
 void Procedure::gatherFormal(SemSymbol * sym){
 	size_t width = Opd::width(sym->getDataType());
-	formals.push_back(new SymOpd(sym, width));
+	SymOpd * opd = new SymOpd(sym, width);
+	formals.push_back(opd);
+	myProg->bindSymOpd(sym, opd);
 }
 
 SymOpd * Procedure::getSymOpd(SemSymbol * sym){
-	for(auto formalSeek : formals){
-		if (formalSeek->getSym() == sym){
-			return formalSeek;
-		}
-	}
-
-	auto localFound = locals.find(sym);
-	if (localFound != locals.end()){
-		return localFound->second;
-	}
-
-	return this->getProg()->getGlobal(sym);
+	//Formals, locals and globals are all bound in the
+	// program's table, so this is a single index
+	return this->getProg()->getSymOpd(sym);
 }
 
 AuxOpd * Procedure::makeTmp(size_t width){
@@ -127,6 +177,11 @@ AddrOpd * Procedure::makeAddrOpd(size_t width){
 	return res;
 }
 
+LitOpd * Procedure::keepLit(LitOpd * lit){
+	lits.push_back(lit);
+	return lit;
+}
+
 size_t Procedure::numTemps() const{
 	return this->temps.size();
 }
@@ -134,7 +189,7 @@ size_t Procedure::numTemps() const{
 size_t Procedure::arSize() const{
 	size_t size = 0;
 	for (auto local : locals){
-		size += local.second->getWidth();
+		size += local->getWidth();
 	}
 	for (auto tmp : temps){
 		size += tmp->getWidth();
@@ -4,6 +4,21 @@
 
 namespace a_lang {
 
+IRProgram::~IRProgram(){
+	for (Procedure * proc : *procs){ delete proc; }
+	delete procs;
+	delete init;
+	for (auto entry : strings){ delete entry.first; }
+	for (SymOpd * opd : globalOrder){ delete opd; }
+	for (SemSymbol * sym : ownSyms){ delete sym; }
+	delete randSym;
+}
+
+SemSymbol * IRProgram::keepSym(SemSymbol * sym){
+	ownSyms.push_back(sym);
+	return sym;
+}
+
 Procedure * IRProgram::makeProc(std::string name){
 	Procedure * proc = new Procedure(this, name);
 	procs->push_back(proc);
@@ -14,6 +29,15 @@ std::list<Procedure *> * IRProgram::getProcs(){
 	return procs;
 }
 
+size_t IRProgram::numQuads(){
+	//Each procedure's enter and leave, plus its body
+	size_t count = init->getQuads()->size() + 2;
+	for (Procedure * proc : *procs){
+		count += proc->getQuads()->size() + 2;
+	}
+	return count;
+}
+
 const DataType * IRProgram::nodeType(ASTNode * node){
 	return ta->nodeType(node);
 }
@@ -38,40 +62,54 @@ void IRProgram::gatherGlobal(SemSymbol * sym){
 	size_t width = Opd::width(sym->getDataType());
 	SymOpd * res = new SymOpd(sym, width);
 	globals[sym] = res;
+	globalOrder.push_back(res);
+	newGlobals.push_back(res);
+	bindSymOpd(sym, res);
+}
+
+void IRProgram::bindSymOpd(SemSymbol * sym, SymOpd * opd){
+	size_t id = sym->getID();
+	if (id >= symOpds.size()){
+		symOpds.resize(id + 1, nullptr);
+	}
+	symOpds[id] = opd;
+}
+
+SymOpd * IRProgram::getSymOpd(SemSymbol * sym){
+	size_t id = sym->getID();
+	if (id >= symOpds.size()){ return nullptr; }
+	return symOpds[id];
 }
 
 Opd * IRProgram::makeString(std::string val){
 	std::string name = "str_" + std::to_string(str_idx++);
 	LitOpd * opd = new LitOpd(name, 8);
-	strings[opd] = val;
+	strings.emplace_back(opd, val);
 	return opd;
 }
 
-std::string IRProgram::toString(bool verbose){
-	std::string res = "";
-	res += "[BEGIN GLOBALS]\n";
-	for (auto entry : globals){
-		res += entry.second->getName() + "\n";
+void IRProgram::write3AC(BufferedWriter& out, bool verbose){
+	out << "[BEGIN GLOBALS]\n";
+	for (SymOpd * opd : globalOrder){
+		out << opd->getName() << "\n";
 	}
 	for (auto entry : strings){
-		res += entry.first->valString();
-		res += " " + entry.second;
-		res += "\n";
+		out << entry.first->valString()
+			<< " " << entry.second << "\n";
 	}
 
-	res += "[END GLOBALS]\n";
-	res += init->toString(verbose);
+	out << "[END GLOBALS]\n";
+	init->write3AC(out, verbose);
 
 	for (Procedure * proc : *procs){
-		res += proc->toString(verbose);
+		proc->write3AC(out, verbose);
 	}
-	return res;
 }
 
 std::set<Opd *> IRProgram::globalSyms(){
 	std::set<Opd *> result;
-	for (auto gItr : globals){
-		result.insert(gItr.second);
+	for (SymOpd * opd : globalOrder){
+		result.insert(opd);
 	}
 	return result;
 }
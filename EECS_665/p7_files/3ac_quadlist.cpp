@@ -0,0 +1,92 @@
+#include "3ac.hpp"
+
+namespace a_lang{
+
+size_t QuadList::allocSlot(Quad * quad){
+	size_t handle;
+	if (freeSlots.empty()){
+		handle = slots.size();
+		slots.push_back(Slot{quad, NONE, NONE});
+	} else {
+		handle = freeSlots.back();
+		freeSlots.pop_back();
+		slots[handle] = Slot{quad, NONE, NONE};
+	}
+	quad->myHandle = handle;
+	count++;
+	return handle;
+}
+
+void QuadList::unlink(size_t handle){
+	Slot& slot = slots[handle];
+	if (slot.prev == NONE){ head = slot.next; }
+	else { slots[slot.prev].next = slot.next; }
+	if (slot.next == NONE){ tail = slot.prev; }
+	else { slots[slot.next].prev = slot.prev; }
+	slot.quad->myHandle = NONE;
+	slot.quad = nullptr;
+	freeSlots.push_back(handle);
+	count--;
+}
+
+Quad * QuadList::back() const{
+	if (tail == NONE){
+		throw new InternalError("back of empty quad list");
+	}
+	return slots[tail].quad;
+}
+
+Quad * QuadList::at(size_t handle) const{
+	if (handle >= slots.size() || slots[handle].quad == nullptr){
+		throw new InternalError("stale quad handle");
+	}
+	return slots[handle].quad;
+}
+
+Quad * QuadList::next(size_t handle) const{
+	at(handle);
+	size_t following = slots[handle].next;
+	return following == NONE ? nullptr : slots[following].quad;
+}
+
+size_t QuadList::push_back(Quad * quad){
+	size_t handle = allocSlot(quad);
+	slots[handle].prev = tail;
+	if (tail == NONE){ head = handle; }
+	else { slots[tail].next = handle; }
+	tail = handle;
+	return handle;
+}
+
+Quad * QuadList::pop_back(){
+	Quad * last = back();
+	unlink(tail);
+	return last;
+}
+
+size_t QuadList::insertBefore(size_t handle, Quad * quad){
+	if (handle == NONE){ return push_back(quad); }
+	at(handle);
+	size_t added = allocSlot(quad);
+	size_t prev = slots[handle].prev;
+	slots[added].prev = prev;
+	slots[added].next = handle;
+	slots[handle].prev = added;
+	if (prev == NONE){ head = added; }
+	else { slots[prev].next = added; }
+	return added;
+}
+
+void QuadList::replace(size_t handle, Quad * quad){
+	Quad * old = at(handle);
+	old->myHandle = NONE;
+	slots[handle].quad = quad;
+	quad->myHandle = handle;
+}
+
+void QuadList::erase(size_t handle){
+	at(handle);
+	unlink(handle);
+}
+
+}
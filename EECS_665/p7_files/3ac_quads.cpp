@@ -28,7 +28,7 @@ std::string Quad::toString(bool verbose){
 
 	auto first = true;
 
-	size_t labelSpace = 12;
+	size_t labelSpace = LABEL_SPACE;
 	for (auto label : labels){
 		if (first){ first = false; }
 		else { res += ","; }
@@ -193,6 +193,24 @@ std::string IfzQuad::repr(){
 	return res;
 }
 
+IfnzQuad::IfnzQuad(Opd * cndIn, Label * tgtIn)
+: Quad(), cnd(cndIn), tgt(tgtIn){ }
+
+std::string IfnzQuad::repr(){
+	std::string res = "IFNZ ";
+	res += cnd->valString();
+	res += " GOTO ";
+	res += tgt->toString();
+	return res;
+}
+
+CountQuad::CountQuad(size_t counterIn)
+: Quad(), counter(counterIn){ }
+
+std::string CountQuad::repr(){
+	return "COUNT " + std::to_string(counter);
+}
+
 NopQuad::NopQuad()
 : Quad() { }
 
@@ -251,4 +269,69 @@ std::string LocQuad::repr(){
 	return res;
 }
 
+
+//Operands, for the optimization passes
+
+static void swapOpd(Opd *& opd, Opd * from, Opd * to){
+	if (opd == from){ opd = to; }
+}
+
+void BinOpQuad::uses(std::vector<Opd *>& srcs){
+	srcs.push_back(src1);
+	srcs.push_back(src2);
+}
+Opd * BinOpQuad::def(){ return dst; }
+void BinOpQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(src1, from, to);
+	swapOpd(src2, from, to);
+}
+
+void UnaryOpQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(src); }
+Opd * UnaryOpQuad::def(){ return dst; }
+void UnaryOpQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(src, from, to);
+}
+
+void AssignQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(src); }
+Opd * AssignQuad::def(){ return dst; }
+void AssignQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(src, from, to);
+}
+
+void LocQuad::uses(std::vector<Opd *>& srcs){
+	srcs.push_back(src);
+	srcs.push_back(tgt);
+}
+
+void IfzQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(cnd); }
+void IfzQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(cnd, from, to);
+}
+
+void IfnzQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(cnd); }
+void IfnzQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(cnd, from, to);
+}
+
+void WriteQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(mySrc); }
+void WriteQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(mySrc, from, to);
+}
+
+Opd * ReadQuad::def(){ return myDst; }
+
+void SetArgQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(opd); }
+void SetArgQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(opd, from, to);
+}
+
+Opd * GetArgQuad::def(){ return opd; }
+
+void SetRetQuad::uses(std::vector<Opd *>& srcs){ srcs.push_back(opd); }
+void SetRetQuad::replaceUse(Opd * from, Opd * to){
+	swapOpd(opd, from, to);
+}
+
+Opd * GetRetQuad::def(){ return opd; }
+
 }
@@ -32,6 +32,7 @@
 
 %parse-param { a_lang::Scanner &scanner }
 %parse-param { a_lang::ProgramNode** root}
+%parse-param { a_lang::DeclSink * sink}
 %code {
    // C std code for utility functions
    #include <iostream>
@@ -47,59 +48,68 @@
   // from a global function
   #undef yylex
   #define yylex scanner.yylex
+
+  //Terminals carry their index in the scanner's token buffer
+  #define TOKPOS(tok) scanner.tokens().pos(tok)
+  #define TOKTEXT(tok) scanner.tokens().text(tok)
 }
 
 //%define parse.assert
 
+//Node IDs are dense per parse, starting from 0
+%initial-action {
+	ASTNode::resetIDs();
+}
+
 /* Terminals */
 
 
 %token                     END   0 "end file"
-%token	<a_lang::Token *>       AND
-%token	<a_lang::Token *>       ASSIGN
-%token	<a_lang::Token *>       ARROW
-%token	<a_lang::Token *>       BOOL
-%token	<a_lang::Token *>       COLON
-%token	<a_lang::Token *>       COMMA
-%token	<a_lang::Token *>       CUSTOM
-%token	<a_lang::Token *>       DASH
-%token	<a_lang::Token *>       ELSE
-%token	<a_lang::Token *>       EH
-%token	<a_lang::Token *>       EQUALS
-%token	<a_lang::Token *>       FALSE
-%token	<a_lang::Token *>       FROMCONSOLE
-%token	<a_lang::Token *>       GREATER
-%token	<a_lang::Token *>       GREATEREQ
-%token	<a_lang::IDToken *>     ID
-%token	<a_lang::Token *>       IF
-%token	<a_lang::Token *>       INT
-%token	<a_lang::IntLitToken *> INTLITERAL
-%token	<a_lang::Token *>       IMMUTABLE
-%token	<a_lang::Token *>       LCURLY
-%token	<a_lang::Token *>       LESS
-%token	<a_lang::Token *>       LESSEQ
-%token	<a_lang::Token *>       LPAREN
-%token	<a_lang::Token *>       MAYBE
-%token	<a_lang::Token *>       MEANS
-%token	<a_lang::Token *>       NOT
-%token	<a_lang::Token *>       NOTEQUALS
-%token	<a_lang::Token *>       OR
-%token	<a_lang::Token *>       OTHERWISE
-%token	<a_lang::Token *>       CROSS
-%token	<a_lang::Token *>       POSTDEC
-%token	<a_lang::Token *>       POSTINC
-%token	<a_lang::Token *>       RETURN
-%token	<a_lang::Token *>       RCURLY
-%token	<a_lang::Token *>       REF
-%token	<a_lang::Token *>       RPAREN
-%token	<a_lang::Token *>       SEMICOL
-%token	<a_lang::Token *>       SLASH
-%token	<a_lang::Token *>       STAR
-%token	<a_lang::StrToken *>    STRINGLITERAL
-%token	<a_lang::Token *>       TOCONSOLE
-%token	<a_lang::Token *>       TRUE
-%token	<a_lang::Token *>       VOID
-%token	<a_lang::Token *>       WHILE
+%token	<size_t>                AND
+%token	<size_t>                ASSIGN
+%token	<size_t>                ARROW
+%token	<size_t>                BOOL
+%token	<size_t>                COLON
+%token	<size_t>                COMMA
+%token	<size_t>                CUSTOM
+%token	<size_t>                DASH
+%token	<size_t>                ELSE
+%token	<size_t>                EH
+%token	<size_t>                EQUALS
+%token	<size_t>                FALSE
+%token	<size_t>                FROMCONSOLE
+%token	<size_t>                GREATER
+%token	<size_t>                GREATEREQ
+%token	<size_t>                ID
+%token	<size_t>                IF
+%token	<size_t>                INT
+%token	<size_t>                INTLITERAL
+%token	<size_t>                IMMUTABLE
+%token	<size_t>                LCURLY
+%token	<size_t>                LESS
+%token	<size_t>                LESSEQ
+%token	<size_t>                LPAREN
+%token	<size_t>                MAYBE
+%token	<size_t>                MEANS
+%token	<size_t>                NOT
+%token	<size_t>                NOTEQUALS
+%token	<size_t>                OR
+%token	<size_t>                OTHERWISE
+%token	<size_t>                CROSS
+%token	<size_t>                POSTDEC
+%token	<size_t>                POSTINC
+%token	<size_t>                RETURN
+%token	<size_t>                RCURLY
+%token	<size_t>                REF
+%token	<size_t>                RPAREN
+%token	<size_t>                SEMICOL
+%token	<size_t>                SLASH
+%token	<size_t>                STAR
+%token	<size_t>                STRINGLITERAL
+%token	<size_t>                TOCONSOLE
+%token	<size_t>                TRUE
+%token	<size_t>                VOID
+%token	<size_t>                WHILE
 
 %type <a_lang::ProgramNode *> program
 %type <std::list<a_lang::DeclNode *> *> globals
@@ -146,7 +156,10 @@ globals		: globals decl
 		  {
 		  $$ = $1;
 		  DeclNode * declNode = $2;
-		  $$->push_back(declNode);
+		  //A sink takes each declaration as it is finished, so
+		  // the program never has to be held all at once
+		  if (sink != nullptr){ sink->declare(declNode); }
+		  else { $$->push_back(declNode); }
 		  }
 		| /* epsilon */
 		  {
@@ -164,18 +177,18 @@ decl		: varDecl SEMICOL
 
 varDecl		: name COLON type
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new VarDeclNode(p,$1, $3, nullptr);
 		  }
 		| name COLON type ASSIGN exp
 		  {
-		  Position * p = new Position($1->pos(), $5->pos());
+		  Position p(*$1->pos(), *$5->pos());
 		  $$ = new VarDeclNode(p,$1, $3, $5);
 		  }
 
 type		: IMMUTABLE primType
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new ImmutableTypeNode(p, $2);
 		  }
 		| primType
@@ -185,20 +198,20 @@ type		: IMMUTABLE primType
 
 primType	: INT
 		  {
-		  $$ = new IntTypeNode($1->pos());
+		  $$ = new IntTypeNode(TOKPOS($1));
 		  }
 		| BOOL
 		  {
-		  $$ = new BoolTypeNode($1->pos());
+		  $$ = new BoolTypeNode(TOKPOS($1));
 		  }
 		| VOID
 		  {
-		  $$ = new VoidTypeNode($1->pos());
+		  $$ = new VoidTypeNode(TOKPOS($1));
 		  }
 
 fnDecl 		: name COLON LPAREN maybeFormals RPAREN ARROW type LCURLY stmtList RCURLY
 		  {
-		  auto pos = new Position($1->pos(), $10->pos());
+		  Position pos(*$1->pos(), TOKPOS($10));
 		  $$ = new FnDeclNode(pos, $1, $4, $7, $9);
 		  }
 
@@ -224,7 +237,7 @@ formalList	: formalDecl
 
 formalDecl	: name COLON type
 		  {
-		  auto pos = new Position($1->pos(), $2->pos());
+		  Position pos(*$1->pos(), TOKPOS($2));
 		  $$ = new FormalDeclNode(pos, $1, $3);
 		  }
 
@@ -245,17 +258,17 @@ stmtList	: /* epsilon */
 
 blockStmt	: WHILE LPAREN exp RPAREN LCURLY stmtList RCURLY
 		  {
-		  const Position * p = new Position($1->pos(), $7->pos());
+		  Position p(TOKPOS($1), TOKPOS($7));
 		  $$ = new WhileStmtNode(p, $3, $6);
 		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY
 		  {
-		  const Position * p = new Position($1->pos(), $7->pos());
+		  Position p(TOKPOS($1), TOKPOS($7));
 		  $$ = new IfStmtNode(p, $3, $6);
 		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY ELSE LCURLY stmtList RCURLY
 		  {
-		  const Position * p = new Position($1->pos(), $11->pos());
+		  Position p(TOKPOS($1), TOKPOS($11));
 		  $$ = new IfElseStmtNode(p, $3, $6, $10);
 		  }
 
@@ -265,117 +278,117 @@ stmt		: varDecl
 		  }
 		| loc ASSIGN exp
 		  {
-		  const auto p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new AssignStmtNode(p, $1, $3); 
 		  }
 		| callExp
 		  {
-		  $$ = new CallStmtNode($1->pos(), $1);
+		  $$ = new CallStmtNode(*$1->pos(), $1);
 		  }
 		| loc POSTDEC
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(*$1->pos(), TOKPOS($2));
 		  $$ = new PostDecStmtNode(p, $1);
 		  }
 		| loc POSTINC
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(*$1->pos(), TOKPOS($2));
 		  $$ = new PostIncStmtNode(p, $1);
 		  }
 		| TOCONSOLE exp
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new ToConsoleStmtNode(p, $2);
 		  }
 		| FROMCONSOLE loc
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new FromConsoleStmtNode(p, $2);
 		  }
 		| MAYBE loc MEANS exp OTHERWISE exp
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new MaybeStmtNode(p, $2, $4, $6);
 		  }
 		| RETURN exp
 		  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new ReturnStmtNode(p, $2);
 		  }
 		| RETURN
 		  {
-		  const Position * p = $1->pos();
+		  Position p = TOKPOS($1);
 		  $$ = new ReturnStmtNode(p, nullptr);
 		  }
 
 exp		: exp DASH exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new MinusNode(p, $1, $3);
 		  }
 		| exp CROSS exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new PlusNode(p, $1, $3);
 		  }
 		| exp STAR exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new TimesNode(p, $1, $3);
 		  }
 		| exp SLASH exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new DivideNode(p, $1, $3);
 		  }
 		| exp AND exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new AndNode(p, $1, $3);
 		  }
 		| exp OR exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new OrNode(p, $1, $3);
 		  }
 		| exp EQUALS exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new EqualsNode(p, $1, $3);
 		  }
 		| exp NOTEQUALS exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new NotEqualsNode(p, $1, $3);
 		  }
 		| exp GREATER exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new GreaterNode(p, $1, $3);
 		  }
 		| exp GREATEREQ exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new GreaterEqNode(p, $1, $3);
 		  }
 		| exp LESS exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new LessNode(p, $1, $3);
 		  }
 		| exp LESSEQ exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), *$3->pos());
 		  $$ = new LessEqNode(p, $1, $3);
 		  }
 		| NOT exp
 	  	  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new NotNode(p, $2);
 		  }
 		| DASH term
 	  	  {
-		  const Position * p = new Position($1->pos(), $2->pos());
+		  Position p(TOKPOS($1), *$2->pos());
 		  $$ = new NegNode(p, $2);
 		  }
 		| term
@@ -384,14 +397,14 @@ exp		: exp DASH exp
 
 callExp		: loc LPAREN RPAREN
 		  {
-		  const Position * p = new Position($1->pos(), $3->pos());
+		  Position p(*$1->pos(), TOKPOS($3));
 		  std::list<ExpNode *> * noargs =
 		    new std::list<ExpNode *>();
 		  $$ = new CallExpNode(p, $1, noargs);
 		  }
 		| loc LPAREN actualsList RPAREN
 		  {
-		  const Position * p = new Position($1->pos(), $4->pos());
+		  Position p(*$1->pos(), TOKPOS($4));
 		  $$ = new CallExpNode(p, $1, $3);
 		  }
 
@@ -411,15 +424,15 @@ actualsList	: exp
 term 		: loc
 		  { $$ = $1; }
 		| INTLITERAL 
-		  { $$ = new IntLitNode($1->pos(), $1->num()); }
+		  { $$ = new IntLitNode(TOKPOS($1), scanner.tokens().intValue($1)); }
 		| STRINGLITERAL 
-		  { $$ = new StrLitNode($1->pos(), $1->str()); }
+		  { $$ = new StrLitNode(TOKPOS($1), TOKTEXT($1)); }
 		| TRUE
-		  { $$ = new TrueNode($1->pos()); }
+		  { $$ = new TrueNode(TOKPOS($1)); }
 		| FALSE
-		  { $$ = new FalseNode($1->pos()); }
+		  { $$ = new FalseNode(TOKPOS($1)); }
 		| EH
-		  { $$ = new EhNode($1->pos()); }
+		  { $$ = new EhNode(TOKPOS($1)); }
 		| LPAREN exp RPAREN
 		  { $$ = $2; }
 		| callExp
@@ -432,7 +445,7 @@ loc		: name
 
 name		: ID
 		  {
-		  $$ = new IDNode($1->pos(), $1->value());
+		  $$ = new IDNode(TOKPOS($1), TOKTEXT($1));
 		  }
 	
 %%
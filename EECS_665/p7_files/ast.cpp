@@ -1,11 +1,141 @@
-#include "ast.hpp"
+#include "ast_walk.hpp"
+
+size_t a_lang::ASTNode::nextID = 0;
 
 a_lang::ProgramNode::ProgramNode(std::list<DeclNode *> * globalsIn)
-: ASTNode(new Position(0,0,0,0)), myGlobals(globalsIn){
+: ASTNode(Position()), myGlobals(globalsIn),
+  myNodeCount(ASTNode::numIDs()){
 	if (!globalsIn->empty()){
-		myPos = new Position(
-			myGlobals->front()->pos(),
-			myGlobals->back()->pos()
+		myPos = Position(
+			*myGlobals->front()->pos(),
+			*myGlobals->back()->pos()
 		);
 	}
 }
+
+void a_lang::ASTWalk::run(ASTNode * root, int indent, bool nested){
+	visit(root, indent, nested);
+	pending.mark = pool.size();
+	stack.push_back(pending);
+	while (!stack.empty()){
+		WalkFrame& top = stack.back();
+		bool descend = step(top);
+		top.step++;
+		if (descend){
+			pending.mark = pool.size();
+			stack.push_back(pending);
+			continue;
+		}
+		WalkFrame done = stack.back();
+		stack.pop_back();
+		pool.resize(done.mark);
+		finished(stack.empty() ? nullptr : &stack.back(), done);
+	}
+}
+
+bool a_lang::ASTWalk::visit(ASTNode * kid, int indent, bool nested){
+	pending.node = kid;
+	pending.step = 0;
+	pending.kids = 0;
+	pending.indent = indent;
+	pending.nested = nested;
+	pending.ok = true;
+	return true;
+}
+
+void a_lang::ASTNode::destroy(ASTNode * root){
+	std::vector<ASTNode *> work;
+	if (root != nullptr){ work.push_back(root); }
+	while (!work.empty()){
+		ASTNode * node = work.back();
+		work.pop_back();
+		node->releaseKids(work);
+		delete node;
+	}
+}
+
+void a_lang::ProgramNode::releaseKids(std::vector<ASTNode *>& kids){
+	releaseList(myGlobals, kids);
+}
+
+void a_lang::VarDeclNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myID);
+	kids.push_back(myType);
+	if (myInit != nullptr){ kids.push_back(myInit); }
+}
+
+void a_lang::FnDeclNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myID);
+	kids.push_back(myRetType);
+	releaseList(myFormals, kids);
+	releaseList(myBody, kids);
+}
+
+void a_lang::AssignStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myDst);
+	kids.push_back(mySrc);
+}
+
+void a_lang::MaybeStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myDst);
+	kids.push_back(mySrc1);
+	kids.push_back(mySrc2);
+}
+
+void a_lang::FromConsoleStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myDst);
+}
+
+void a_lang::ToConsoleStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(mySrc);
+}
+
+void a_lang::PostDecStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myLoc);
+}
+
+void a_lang::PostIncStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myLoc);
+}
+
+void a_lang::IfStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myCond);
+	releaseList(myBody, kids);
+}
+
+void a_lang::IfElseStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myCond);
+	releaseList(myBodyTrue, kids);
+	releaseList(myBodyFalse, kids);
+}
+
+void a_lang::WhileStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myCond);
+	releaseList(myBody, kids);
+}
+
+void a_lang::ReturnStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	if (myExp != nullptr){ kids.push_back(myExp); }
+}
+
+void a_lang::CallExpNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myCallee);
+	releaseList(myArgs, kids);
+}
+
+void a_lang::BinaryExpNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myExp1);
+	kids.push_back(myExp2);
+}
+
+void a_lang::UnaryExpNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myExp);
+}
+
+void a_lang::ImmutableTypeNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(mySub);
+}
+
+void a_lang::CallStmtNode::releaseKids(std::vector<ASTNode *>& kids){
+	kids.push_back(myCallExp);
+}
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <string.h>
 #include <list>
+#include <vector>
 #include "tokens.hpp"
 #include "types.hpp"
 #include "3ac.hpp"
@@ -14,13 +15,21 @@ namespace a_lang {
 
 class TypeAnalysis;
 
+struct WalkFrame;
+class UnparseWalk;
+class NameWalk;
+class TypeWalk;
+class FlattenWalk;
+
 class Opd;
 
 class SymbolTable;
+class ScopeTable;
 class SemSymbol;
 
 class DeclNode;
 class VarDeclNode;
+class FnDeclNode;
 class StmtNode;
 class FormalDeclNode;
 class TypeNode;
@@ -29,16 +38,60 @@ class IDNode;
 
 class ASTNode{
 public:
-	ASTNode(const Position * pos) : myPos(pos){ }
+	ASTNode(Position pos) : myPos(pos), myID(nextID++){ }
 	virtual void unparse(std::ostream&, int) = 0;
-	const Position * pos() { return myPos; };
+	const Position * pos() { return &myPos; };
 	std::string posStr(){ return pos()->span(); }
 	virtual bool nameAnalysis(SymbolTable *) = 0;
+	//Resumable slices of each pass, used by walks over code
+	// that can nest deeply (see ast_walk.hpp). By default a
+	// node does the whole pass in one step.
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f);
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f);
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f);
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f);
 	//Note that there is no ASTNode::typeAnalysis. To allow
 	// for different type signatures, type analysis is
 	// implemented as needed in various subclasses
+
+	//Each node gets a dense ID in creation (i.e. parse) order,
+	// so analyses can keep per-node results in a flat vector
+	// indexed by ID instead of a map keyed by node pointer
+	size_t getID() const { return myID; }
+	static size_t numIDs(){ return nextID; }
+	static void resetIDs(){ nextID = 0; }
+
+	virtual ~ASTNode(){ }
+	//Free a whole subtree. Each node hands its children to a
+	// work list before it is deleted, so freeing a deeply
+	// nested expression doesn't recurse.
+	static void destroy(ASTNode * root);
 protected:
-	const Position * myPos = nullptr;
+	//Move this node's children into kids, and free any lists
+	// that held them
+	virtual void releaseKids(std::vector<ASTNode *>& kids){ }
+	template <typename T>
+	static void releaseList(std::list<T *> *& list,
+	  std::vector<ASTNode *>& kids){
+		if (list == nullptr){ return; }
+		for (T * elt : *list){ kids.push_back(elt); }
+		delete list;
+		list = nullptr;
+	}
+
+	Position myPos;
+private:
+	const size_t myID;
+	static size_t nextID;
+};
+
+//Receives each top-level declaration as soon as the parser has
+// built it, instead of the parser collecting them all into the
+// ProgramNode
+class DeclSink{
+public:
+	virtual ~DeclSink(){ }
+	virtual void declare(DeclNode * decl) = 0;
 };
 
 class ProgramNode : public ASTNode{
@@ -47,26 +100,38 @@ public:
 	void unparse(std::ostream&, int) override;
 	virtual bool nameAnalysis(SymbolTable *) override;
 	virtual void typeAnalysis(TypeAnalysis *);
+	//Declare the globals and function signatures in order,
+	// then analyse the function bodies on up to jobs threads
+	bool nameAnalysis(SymbolTable * symTab, size_t jobs);
+	void typeAnalysis(TypeAnalysis * typing, size_t jobs);
 	IRProgram * to3AC(TypeAnalysis * ta);
+	//Number of node IDs handed out while building this tree
+	size_t nodeCount() const { return myNodeCount; }
 	virtual ~ProgramNode(){ }
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	std::list<DeclNode *> * myGlobals;
+	size_t myNodeCount;
 };
 
 class ExpNode : public ASTNode{
 protected:
-	ExpNode(const Position * p) : ASTNode(p){ }
+	ExpNode(Position p) : ASTNode(p){ }
 public:
 	virtual void unparseNested(std::ostream& out);
 	//virtual void unparse(std::ostream& out, int indent) override = 0;
 	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) = 0;
 	virtual Opd * flatten(Procedure * proc) = 0;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
 };
 
 class LocNode : public ExpNode{
 public:
-	LocNode(const Position * p)
+	LocNode(Position p)
 	: ExpNode(p), mySymbol(nullptr){}
 	void attachSymbol(SemSymbol * symbolIn);
 	SemSymbol * getSymbol() { return mySymbol; }
@@ -79,7 +144,7 @@ private:
 
 class IDNode : public LocNode{
 public:
-	IDNode(const Position * p, std::string nameIn)
+	IDNode(Position p, std::string nameIn)
 	: LocNode(p), name(nameIn){}
 	std::string getName(){ return name; }
 	void unparse(std::ostream& out, int indent) override;
@@ -93,7 +158,7 @@ private:
 
 class TypeNode : public ASTNode{
 public:
-	TypeNode(const Position * p) : ASTNode(p){ }
+	TypeNode(Position p) : ASTNode(p){ }
 	void unparse(std::ostream&, int) override = 0;
 	virtual const DataType * getType() const = 0;
 	virtual bool nameAnalysis(SymbolTable *) override;
@@ -102,17 +167,20 @@ public:
 
 class StmtNode : public ASTNode{
 public:
-	StmtNode(const Position * p) : ASTNode(p){ }
+	StmtNode(Position p) : ASTNode(p){ }
 	virtual void unparse(std::ostream& out, int indent) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) = 0;
 	virtual void to3AC(Procedure * proc) = 0;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
 };
 
 class DeclNode : public StmtNode{
 public:
-	DeclNode(const Position * p) : StmtNode(p){ }
+	DeclNode(Position p) : StmtNode(p){ }
 	void unparse(std::ostream& out, int indent) override =0;
 	virtual std::string getName() = 0;
+	virtual FnDeclNode * asFnDecl(){ return nullptr; }
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
 	virtual void to3AC(IRProgram * prog) = 0;
 	virtual void to3AC(Procedure * proc) override = 0;
@@ -120,7 +188,7 @@ public:
 
 class VarDeclNode : public DeclNode{
 public:
-	VarDeclNode(const Position * p, IDNode * inID,
+	VarDeclNode(Position p, IDNode * inID,
 	TypeNode * inType, ExpNode * inInit)
 	: DeclNode(p), myID(inID), myType(inType), myInit(inInit){
 		if (myType == nullptr){
@@ -137,6 +205,8 @@ public:
 	void typeAnalysis(TypeAnalysis * typing) override;
 	virtual void to3AC(Procedure * proc) override;
 	virtual void to3AC(IRProgram * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	IDNode * myID;
 	TypeNode * myType;
@@ -145,7 +215,7 @@ private:
 
 class FormalDeclNode : public VarDeclNode{
 public:
-	FormalDeclNode(const Position * p, IDNode * id, TypeNode * type)
+	FormalDeclNode(Position p, IDNode * id, TypeNode * type)
 	: VarDeclNode(p, id, type, nullptr){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual void to3AC(Procedure * proc) override;
@@ -154,15 +224,16 @@ public:
 
 class FnDeclNode : public DeclNode{
 public:
-	FnDeclNode(const Position * p,
+	FnDeclNode(Position p,
 	  IDNode * inID,
 	  std::list<FormalDeclNode *> * inFormals,
 	  TypeNode * inRetType,
 	  std::list<StmtNode *> * inBody)
 	: DeclNode(p), myID(inID),
 	  myFormals(inFormals), myRetType(inRetType),
-	  myBody(inBody){
+	  myBody(inBody), myScope(nullptr){
 	}
+	virtual FnDeclNode * asFnDecl() override { return this; }
 	IDNode * ID() const { return myID; }
 	virtual std::string getName() override { 
 		return myID->getName(); 
@@ -176,23 +247,37 @@ public:
 	void unparse(std::ostream& out, int indent) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	//The two halves of each analysis. The signature half runs
+	// in the enclosing scope; the body half only reads the
+	// global scope, so bodies can be analysed in parallel.
+	bool nameSignature(SymbolTable * symTab);
+	bool nameBody(SymbolTable * symTab);
+	void typeSignature(TypeAnalysis * typing);
+	void typeBody(TypeAnalysis * typing);
+	//The scope holding the formals, once nameSignature has run
+	ScopeTable * scope() const { return myScope; }
 	void to3AC(IRProgram * prog) override;
 	void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	IDNode * myID;
 	std::list<FormalDeclNode *> * myFormals;
 	TypeNode * myRetType;
 	std::list<StmtNode *> * myBody;
+	ScopeTable * myScope;
 };
 
 class AssignStmtNode : public StmtNode{
 public:
-	AssignStmtNode(const Position * p, LocNode * inDst, ExpNode * inSrc)
+	AssignStmtNode(Position p, LocNode * inDst, ExpNode * inSrc)
 	: StmtNode(p), myDst(inDst), mySrc(inSrc){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myDst;
 	ExpNode * mySrc;
@@ -200,12 +285,14 @@ private:
 
 class MaybeStmtNode : public StmtNode{
 public:
-	MaybeStmtNode(const Position * p, LocNode * inDst, ExpNode * inSrc1, ExpNode * inSrc2)
+	MaybeStmtNode(Position p, LocNode * inDst, ExpNode * inSrc1, ExpNode * inSrc2)
 	: StmtNode(p), myDst(inDst), mySrc1(inSrc1), mySrc2(inSrc2){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myDst;
 	ExpNode * mySrc1;
@@ -214,61 +301,75 @@ private:
 
 class FromConsoleStmtNode : public StmtNode{
 public:
-	FromConsoleStmtNode(const Position * p, LocNode * inDst)
+	FromConsoleStmtNode(Position p, LocNode * inDst)
 	: StmtNode(p), myDst(inDst){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myDst;
 };
 
 class ToConsoleStmtNode : public StmtNode{
 public:
-	ToConsoleStmtNode(const Position * p, ExpNode * inSrc)
+	ToConsoleStmtNode(Position p, ExpNode * inSrc)
 	: StmtNode(p), mySrc(inSrc){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	ExpNode * mySrc;
 };
 
 class PostDecStmtNode : public StmtNode{
 public:
-	PostDecStmtNode(const Position * p, LocNode * inLoc)
+	PostDecStmtNode(Position p, LocNode * inLoc)
 	: StmtNode(p), myLoc(inLoc){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myLoc;
 };
 
 class PostIncStmtNode : public StmtNode{
 public:
-	PostIncStmtNode(const Position * p, LocNode * inLoc)
+	PostIncStmtNode(Position p, LocNode * inLoc)
 	: StmtNode(p), myLoc(inLoc){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myLoc;
 };
 
 class IfStmtNode : public StmtNode{
 public:
-	IfStmtNode(const Position * p, ExpNode * condIn,
+	IfStmtNode(Position p, ExpNode * condIn,
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -276,7 +377,7 @@ private:
 
 class IfElseStmtNode : public StmtNode{
 public:
-	IfElseStmtNode(const Position * p, ExpNode * condIn,
+	IfElseStmtNode(Position p, ExpNode * condIn,
 	  std::list<StmtNode *> * bodyTrueIn,
 	  std::list<StmtNode *> * bodyFalseIn)
 	: StmtNode(p), myCond(condIn),
@@ -285,6 +386,12 @@ public:
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBodyTrue;
@@ -293,13 +400,19 @@ private:
 
 class WhileStmtNode : public StmtNode{
 public:
-	WhileStmtNode(const Position * p, ExpNode * condIn,
+	WhileStmtNode(Position p, ExpNode * condIn,
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * prog) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -307,19 +420,21 @@ private:
 
 class ReturnStmtNode : public StmtNode{
 public:
-	ReturnStmtNode(const Position * p, ExpNode * exp)
+	ReturnStmtNode(Position p, ExpNode * exp)
 	: StmtNode(p), myExp(exp){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * proc) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	ExpNode * myExp;
 };
 
 class CallExpNode : public ExpNode{
 public:
-	CallExpNode(const Position * p, LocNode * inCallee,
+	CallExpNode(Position p, LocNode * inCallee,
 	  std::list<ExpNode *> * inArgs)
 	: ExpNode(p), myCallee(inCallee), myArgs(inArgs){ }
 	void unparse(std::ostream& out, int indent) override;
@@ -329,6 +444,12 @@ public:
 	DataType * getRetType();
 
 	virtual Opd * flatten(Procedure * proc) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	LocNode * myCallee;
 	std::list<ExpNode *> * myArgs;
@@ -336,165 +457,189 @@ private:
 
 class BinaryExpNode : public ExpNode{
 public:
-	BinaryExpNode(const Position * p, ExpNode * lhs, ExpNode * rhs)
+	BinaryExpNode(Position p, ExpNode * lhs, ExpNode * rhs)
 	: ExpNode(p), myExp1(lhs), myExp2(rhs) { }
+	void unparse(std::ostream& out, int indent) override;
+	void unparseNested(std::ostream& out) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
-	virtual void typeAnalysis(TypeAnalysis *) override = 0;
-	virtual Opd * flatten(Procedure * prog) override = 0;
+	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual Opd * flatten(Procedure * proc) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
 protected:
+	//Which rules an operator's operands and result follow
+	enum class OpTyping{ MATH, LOGIC, EQ, REL };
+	virtual const char * opString() const = 0;
+	virtual OpTyping opTyping() const = 0;
+	//Emit the operation itself once both operands are flat
+	virtual Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) = 0;
+	const DataType * typeOpd(TypeAnalysis * typing, ExpNode * opd);
+	void typeResult(TypeAnalysis * typing,
+	  const DataType * lhsType, const DataType * rhsType);
+	void releaseKids(std::vector<ASTNode *>& kids) override;
+
 	ExpNode * myExp1;
 	ExpNode * myExp2;
-	void binaryLogicTyping(TypeAnalysis * typing);
-	void binaryEqTyping(TypeAnalysis * typing);
-	void binaryRelTyping(TypeAnalysis * typing);
-	void binaryMathTyping(TypeAnalysis * typing);
 };
 
 class PlusNode : public BinaryExpNode{
 public:
-	PlusNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	PlusNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "+"; }
+	OpTyping opTyping() const override { return OpTyping::MATH; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class MinusNode : public BinaryExpNode{
 public:
-	MinusNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	MinusNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "-"; }
+	OpTyping opTyping() const override { return OpTyping::MATH; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class TimesNode : public BinaryExpNode{
 public:
-	TimesNode(const Position * p, ExpNode * e1In, ExpNode * e2In)
+	TimesNode(Position p, ExpNode * e1In, ExpNode * e2In)
 	: BinaryExpNode(p, e1In, e2In){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "*"; }
+	OpTyping opTyping() const override { return OpTyping::MATH; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class DivideNode : public BinaryExpNode{
 public:
-	DivideNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	DivideNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "/"; }
+	OpTyping opTyping() const override { return OpTyping::MATH; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class AndNode : public BinaryExpNode{
 public:
-	AndNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	AndNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "and"; }
+	OpTyping opTyping() const override { return OpTyping::LOGIC; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class OrNode : public BinaryExpNode{
 public:
-	OrNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	OrNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "or"; }
+	OpTyping opTyping() const override { return OpTyping::LOGIC; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class EqualsNode : public BinaryExpNode{
 public:
-	EqualsNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	EqualsNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "=="; }
+	OpTyping opTyping() const override { return OpTyping::EQ; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class NotEqualsNode : public BinaryExpNode{
 public:
-	NotEqualsNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	NotEqualsNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "!="; }
+	OpTyping opTyping() const override { return OpTyping::EQ; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class LessNode : public BinaryExpNode{
 public:
-	LessNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	LessNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	const char * opString() const override { return "<"; }
+	OpTyping opTyping() const override { return OpTyping::REL; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class LessEqNode : public BinaryExpNode{
 public:
-	LessEqNode(const Position * pos, ExpNode * e1, ExpNode * e2)
+	LessEqNode(Position pos, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(pos, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return "<="; }
+	OpTyping opTyping() const override { return OpTyping::REL; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class GreaterNode : public BinaryExpNode{
 public:
-	GreaterNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	GreaterNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	const char * opString() const override { return ">"; }
+	OpTyping opTyping() const override { return OpTyping::REL; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class GreaterEqNode : public BinaryExpNode{
 public:
-	GreaterEqNode(const Position * p, ExpNode * e1, ExpNode * e2)
+	GreaterEqNode(Position p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	const char * opString() const override { return ">="; }
+	OpTyping opTyping() const override { return OpTyping::REL; }
+	Opd * flattenOp(Procedure * proc, Opd * lhs, Opd * rhs) override;
 };
 
 class UnaryExpNode : public ExpNode {
 public:
-	UnaryExpNode(const Position * p, ExpNode * expIn)
+	UnaryExpNode(Position p, ExpNode * expIn)
 	: ExpNode(p){
 		this->myExp = expIn;
 	}
-	virtual void unparse(std::ostream& out, int indent) override = 0;
-	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
-	virtual void typeAnalysis(TypeAnalysis *) override = 0;
-	virtual Opd * flatten(Procedure * prog) override = 0;
+	void unparse(std::ostream& out, int indent) override;
+	void unparseNested(std::ostream& out) override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual Opd * flatten(Procedure * proc) override;
+	virtual bool unparseStep(UnparseWalk& walk, WalkFrame& f) override;
+	virtual bool nameStep(NameWalk& walk, WalkFrame& f) override;
+	virtual bool typeStep(TypeWalk& walk, WalkFrame& f) override;
+	virtual bool lowerStep(FlattenWalk& walk, WalkFrame& f) override;
 protected:
+	virtual const char * opString() const = 0;
+	//Type the node once its operand has been typed
+	virtual void typeResult(TypeAnalysis * typing) = 0;
+	virtual Opd * flattenOp(Procedure * proc, Opd * child) = 0;
+	void releaseKids(std::vector<ASTNode *>& kids) override;
+
 	ExpNode * myExp;
 };
 
 class NegNode : public UnaryExpNode{
 public:
-	NegNode(const Position * p, ExpNode * exp)
+	NegNode(Position p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
-	void unparse(std::ostream& out, int indent) override;
-	bool nameAnalysis(SymbolTable * symTab) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+protected:
+	const char * opString() const override { return "-"; }
+	void typeResult(TypeAnalysis * typing) override;
+	Opd * flattenOp(Procedure * proc, Opd * child) override;
 };
 
 class NotNode : public UnaryExpNode{
 public:
-	NotNode(const Position * p, ExpNode * exp)
+	NotNode(Position p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
-	void unparse(std::ostream& out, int indent) override;
-	bool nameAnalysis(SymbolTable * symTab) override;
-	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+protected:
+	const char * opString() const override { return "!"; }
+	void typeResult(TypeAnalysis * typing) override;
+	Opd * flattenOp(Procedure * proc, Opd * child) override;
 };
 
 class VoidTypeNode : public TypeNode{
 public:
-	VoidTypeNode(const Position * p) : TypeNode(p){}
+	VoidTypeNode(Position p) : TypeNode(p){}
 	void unparse(std::ostream& out, int indent) override;
 	virtual const DataType * getType() const override {
 		return BasicType::VOID();
@@ -503,34 +648,36 @@ public:
 
 class ImmutableTypeNode : public TypeNode{
 public:
-	ImmutableTypeNode(const Position * p, TypeNode * inSub)
+	ImmutableTypeNode(Position p, TypeNode * inSub)
 	: TypeNode(p), mySub(inSub){}
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual const DataType * getType() const override {
 		return ImmutableType::produce(mySub->getType());
 	};
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	TypeNode * mySub;
 };
 
 class IntTypeNode : public TypeNode{
 public:
-	IntTypeNode(const Position * p): TypeNode(p){}
+	IntTypeNode(Position p): TypeNode(p){}
 	void unparse(std::ostream& out, int indent) override;
 	virtual const DataType * getType() const override;
 };
 
 class BoolTypeNode : public TypeNode{
 public:
-	BoolTypeNode(const Position * p): TypeNode(p) { }
+	BoolTypeNode(Position p): TypeNode(p) { }
 	void unparse(std::ostream& out, int indent) override;
 	virtual const DataType * getType() const override;
 };
 
 class IntLitNode : public ExpNode{
 public:
-	IntLitNode(const Position * p, const int numIn)
+	IntLitNode(Position p, const int numIn)
 	: ExpNode(p), myNum(numIn){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
@@ -545,7 +692,7 @@ private:
 
 class StrLitNode : public ExpNode{
 public:
-	StrLitNode(const Position * p, const std::string strIn)
+	StrLitNode(Position p, const std::string strIn)
 	: ExpNode(p), myStr(strIn){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
@@ -560,7 +707,7 @@ private:
 
 class TrueNode : public ExpNode{
 public:
-	TrueNode(const Position * p): ExpNode(p){ }
+	TrueNode(Position p): ExpNode(p){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
 	}
@@ -572,7 +719,7 @@ public:
 
 class FalseNode : public ExpNode{
 public:
-	FalseNode(const Position * p): ExpNode(p){ }
+	FalseNode(Position p): ExpNode(p){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
 	}
@@ -584,7 +731,7 @@ public:
 
 class EhNode : public ExpNode{
 public:
-	EhNode(const Position * p): ExpNode(p){ }
+	EhNode(Position p): ExpNode(p){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
 	}
@@ -598,12 +745,14 @@ public:
 
 class CallStmtNode : public StmtNode{
 public:
-	CallStmtNode(const Position * p, CallExpNode * expIn)
+	CallStmtNode(Position p, CallExpNode * expIn)
 	: StmtNode(p), myCallExp(expIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 	virtual void to3AC(Procedure * proc) override;
+protected:
+	void releaseKids(std::vector<ASTNode *>& kids) override;
 private:
 	CallExpNode * myCallExp;
 };
@@ -0,0 +1,136 @@
+#ifndef A_LANG_AST_WALK_HPP
+#define A_LANG_AST_WALK_HPP
+
+#include <list>
+#include <ostream>
+#include <vector>
+#include "ast.hpp"
+
+namespace a_lang{
+
+//One node on an ASTWalk's stack
+struct WalkFrame{
+	ASTNode * node;
+	//How many times the node's step has already run
+	size_t step;
+	//Where the node's queued children start in the walk's pool
+	size_t kids;
+	//Size of the pool when this frame was pushed
+	size_t mark;
+	int indent;
+	//Unparse: print the node as an operand of another
+	bool nested;
+	//Name analysis: no errors so far in this subtree. Type
+	// analysis: the statement's condition was good.
+	bool ok;
+};
+
+//Walks over code that can nest arbitrarily deep (expressions,
+// and statement blocks inside if/while) keep their own stack
+// of frames instead of recursing, so nesting depth is bounded
+// by memory rather than by the C++ stack.
+//
+// A pass resumes the node on top of the stack through its
+// step function: the step does the node's work up to the next
+// child it needs walked, hands that child to visit() and
+// returns true, or returns false once the node is finished.
+// When the child is finished the parent's step runs again with
+// f.step one higher. Nodes that can't nest (IDs, literals,
+// simple statements) just do the whole pass in their first
+// step, exactly as the recursive pass would.
+class ASTWalk{
+public:
+	virtual ~ASTWalk(){ }
+	void run(ASTNode * root, int indent = 0, bool nested = false);
+
+	//Called from a step: walk kid next, then resume the caller
+	bool visit(ASTNode * kid, int indent = 0, bool nested = false);
+
+	//Copy a node's child list where its steps can index it in
+	// constant time. Returns the index of the first child.
+	template <typename T>
+	size_t queue(std::list<T *> * list){
+		size_t first = pool.size();
+		for (T * elt : *list){ pool.push_back(elt); }
+		return first;
+	}
+	ASTNode * kid(const WalkFrame& f, size_t i) const {
+		return pool[f.kids + i];
+	}
+protected:
+	virtual bool step(WalkFrame& f) = 0;
+	//A node just finished. parent is null for the root.
+	virtual void finished(WalkFrame * parent, const WalkFrame& child){ }
+private:
+	std::vector<WalkFrame> stack;
+	std::vector<ASTNode *> pool;
+	WalkFrame pending;
+};
+
+class UnparseWalk : public ASTWalk{
+public:
+	UnparseWalk(std::ostream& outIn) : out(outIn){ }
+	std::ostream& out;
+protected:
+	virtual bool step(WalkFrame& f) override {
+		return f.node->unparseStep(*this, f);
+	}
+};
+
+class NameWalk : public ASTWalk{
+public:
+	NameWalk(SymbolTable * symTabIn) : symTab(symTabIn){ }
+	SymbolTable * const symTab;
+	//Whether the root's subtree had no name errors
+	bool ok() const { return result; }
+protected:
+	virtual bool step(WalkFrame& f) override {
+		return f.node->nameStep(*this, f);
+	}
+	virtual void finished(WalkFrame * parent, const WalkFrame& child) override {
+		if (parent == nullptr){ result = child.ok; }
+		else { parent->ok = child.ok && parent->ok; }
+	}
+private:
+	bool result = true;
+};
+
+class TypeWalk : public ASTWalk{
+public:
+	TypeWalk(TypeAnalysis * typingIn) : typing(typingIn){ }
+	TypeAnalysis * const typing;
+	//What binary operators learned about their left operand,
+	// kept until the right one has been typed
+	std::vector<const DataType *> lhsTypes;
+protected:
+	virtual bool step(WalkFrame& f) override {
+		return f.node->typeStep(*this, f);
+	}
+};
+
+//Flattens expressions and lowers statements to 3AC
+class FlattenWalk : public ASTWalk{
+public:
+	FlattenWalk(Procedure * procIn) : proc(procIn){ }
+	Procedure * const proc;
+	//Results of flattened expressions not yet used
+	std::vector<Opd *> opds;
+	//Labels and quads a statement made before walking its
+	// children and places after them
+	std::vector<Label *> labels;
+	std::vector<Quad *> quads;
+
+	Opd * popOpd(){
+		Opd * opd = opds.back();
+		opds.pop_back();
+		return opd;
+	}
+protected:
+	virtual bool step(WalkFrame& f) override {
+		return f.node->lowerStep(*this, f);
+	}
+};
+
+}
+
+#endif
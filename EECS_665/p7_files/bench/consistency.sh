@@ -0,0 +1,98 @@
+#!/bin/sh
+# Check that every way of getting a program to assembly gives the
+# same code: batch -o, -stream, a cold and then a warm -cache, and
+# -emit-ir followed by -load-ir. The program is generated from a
+# fixed seed and compiled under ACFLAGS (e.g. -O2; not the profile
+# flags, which don't stream).
+#
+# -stream writes each declaration's data just ahead of its code,
+# so it is compared with batch output once the data and the code
+# are pulled apart. The other outputs must match byte for byte.
+# Cache entries made to look as if an older ac wrote them must
+# all miss.
+
+AC=${AC:-../ac}
+GEN=${GEN:-./gen_alang}
+WORK=${WORK:-out}/consistency
+
+fail(){
+	echo "consistency: $*" >&2
+	exit 1
+}
+
+# compile <output> <args>: run ac with ACFLAGS, output to <output>
+compile(){
+	dest=$1
+	shift
+	# shellcheck disable=SC2086
+	$AC "$@" $ACFLAGS -o "$WORK/$dest" || fail "ac $* failed"
+}
+
+# same <a> <b>: the two outputs must be identical
+same(){
+	if ! cmp -s "$WORK/$1" "$WORK/$2"; then
+		diff "$WORK/$1" "$WORK/$2" | head -20 >&2
+		fail "$1 and $2 differ"
+	fi
+}
+
+# split <asm>: write its data lines to <asm>.data and the rest,
+# less blank lines and section switches, to <asm>.code
+split(){
+	awk -v data="$WORK/$1.data" -v code="$WORK/$1.code" '
+		/^$/ || /^\.(data|text|globl main)$/ { next }
+		/^[A-Za-z_][A-Za-z0-9_]*: \.(quad|byte|asciz) / || /^\.align / {
+			print > data
+			next
+		}
+		{ print > code }' "$WORK/$1"
+}
+
+# stale <sed script> <who>: edit every cache entry's header with
+# the script, then check a run misses (rewrites) every one
+stale(){
+	for entry in "$WORK"/cache/*.fn; do
+		sed -i "$1" "$entry"
+	done
+	touch -t 200001010000 "$WORK"/cache/*.fn
+	compile stale.s "$WORK/prog.a" -cache "$WORK/cache"
+	same cold.s stale.s
+	if [ -n "$(find "$WORK/cache" -name '*.fn' ! -newermt 2000-01-02)" ]; then
+		fail "entries written by $2 were reused"
+	fi
+}
+
+rm -rf "$WORK"
+mkdir -p "$WORK"
+$GEN -seed 2 -fns 40 > "$WORK/prog.a" || fail "gen_alang failed"
+
+compile batch.s "$WORK/prog.a"
+compile stream.s "$WORK/prog.a" -stream
+split batch.s
+split stream.s
+same batch.s.data stream.s.data
+same batch.s.code stream.s.code
+
+# Age the entries once they are written, so any the warm run
+# writes again (a miss) show up as newer
+compile cold.s "$WORK/prog.a" -cache "$WORK/cache"
+same stream.s cold.s
+ls "$WORK"/cache/*.fn > /dev/null 2>&1 || fail "the cold run cached nothing"
+touch -t 200001010000 "$WORK"/cache/*.fn
+compile warm.s "$WORK/prog.a" -cache "$WORK/cache"
+same cold.s warm.s
+if [ -n "$(find "$WORK/cache" -name '*.fn' -newermt 2000-01-02)" ]; then
+	fail "the warm run missed the cache"
+fi
+# An entry from before the build line (cache version 6), and one
+# from another build of ac
+stale '1s/.*/a_lang fn cache 6/; 2d' "an older cache version"
+stale '2s/.*/build 0/' "another build of ac"
+
+# shellcheck disable=SC2086
+$AC "$WORK/prog.a" $ACFLAGS -emit-ir "$WORK/prog.ir" \
+	|| fail "ac -emit-ir failed"
+compile loaded.s "$WORK/prog.ir" -load-ir
+same batch.s loaded.s
+
+echo "consistency: batch, -stream, -cache and -load-ir agree${ACFLAGS:+ ($ACFLAGS)}"
@@ -0,0 +1,319 @@
+//Writes a synthetic a_lang program to stdout, for measuring how
+// the compiler scales. The program is chosen by a seed and a few
+// size knobs, so the same command line always gives the same
+// program and timings can be compared from commit to commit.
+//
+// Every program passes name and type analysis. Functions only
+// call functions declared before them and loops count up to a
+// small bound, so the programs also terminate when run (though
+// calls nest, so big ones can run for a long time); make check
+// runs a small one to be sure.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace{
+
+struct Knobs{
+	uint64_t seed = 1;
+	//Functions besides main
+	size_t fns = 20;
+	//Statements in each block
+	size_t stmts = 12;
+	//How deeply ifs and whiles nest
+	size_t stmtDepth = 2;
+	//How deeply expressions nest
+	size_t exprDepth = 3;
+	//Locals declared at the top of each function
+	size_t ids = 6;
+	//Global ints
+	size_t globals = 4;
+	//String literals written out, spread over the functions
+	size_t strings = 0;
+};
+
+struct Fn{
+	std::string name;
+	size_t numFormals;
+};
+
+class Generator{
+public:
+	Generator(const Knobs& knobsIn)
+	: knobs(knobsIn), state(knobsIn.seed * 2862933555777941757ULL + 1),
+	  stringsLeft(knobsIn.strings), loops(0){ }
+
+	void program(){
+		for (size_t i = 0; i < knobs.globals; i++){
+			out << "g" << i << " : int;\n";
+		}
+		out << "\n";
+		for (size_t i = 0; i < knobs.fns; i++){
+			function("f" + std::to_string(i), pick(4), i);
+		}
+		main();
+		std::cout << out.str();
+	}
+private:
+	//splitmix64: small, fast and the same everywhere
+	uint64_t next(){
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	size_t pick(size_t bound){
+		return bound == 0 ? 0 : static_cast<size_t>(next() % bound);
+	}
+
+	void indent(size_t depth){
+		for (size_t i = 0; i <= depth; i++){ out << "\t"; }
+	}
+
+	std::string intVar(){
+		size_t choice = pick(knobs.ids + numFormals + knobs.globals);
+		if (choice < knobs.ids){ return "v" + std::to_string(choice); }
+		choice -= knobs.ids;
+		if (choice < numFormals){ return "a" + std::to_string(choice); }
+		return "g" + std::to_string(choice - numFormals);
+	}
+
+	//Only locals are assigned, so globals and formals keep
+	// loops' bounds and callers' values as they were
+	std::string localVar(){
+		return "v" + std::to_string(pick(knobs.ids));
+	}
+
+	void intExp(size_t depth){
+		if (depth == 0 || pick(4) == 0){
+			switch (pick(3)){
+			case 0: out << pick(1000); return;
+			case 1: out << intVar(); return;
+			default:
+				//Calls count as a level, so arguments can't nest
+				// calls without bound
+				if (depth == 0 || numCallable == 0){
+					out << intVar();
+					return;
+				}
+				call(depth - 1);
+				return;
+			}
+		}
+		switch (pick(5)){
+		case 0:
+			out << "-";
+			term(depth);
+			return;
+		case 1:
+			//A literal divisor from 1 to 9 can't be zero (or -1,
+			// which overflows on the most negative dividend)
+			term(depth);
+			out << " / " << pick(9) + 1;
+			return;
+		default: {
+			static const char * const ops[] = {" + ", " - ", " * "};
+			term(depth);
+			out << ops[pick(3)];
+			term(depth);
+			return;
+		}
+		}
+	}
+
+	void term(size_t depth){
+		out << "(";
+		intExp(depth - 1);
+		out << ")";
+	}
+
+	void boolExp(size_t depth){
+		if (depth == 0 || pick(3) == 0){
+			static const char * const cmps[] = {
+				" < ", " <= ", " > ", " >= ", " == ", " != "};
+			intExp(0);
+			out << cmps[pick(6)];
+			intExp(0);
+			return;
+		}
+		switch (pick(3)){
+		case 0:
+			out << "!(";
+			boolExp(depth - 1);
+			out << ")";
+			return;
+		default:
+			out << "(";
+			boolExp(depth - 1);
+			out << (pick(2) == 0 ? ") and (" : ") or (");
+			boolExp(depth - 1);
+			out << ")";
+			return;
+		}
+	}
+
+	void call(size_t depth){
+		const Fn& fn = fns[pick(numCallable)];
+		out << fn.name << "(";
+		for (size_t i = 0; i < fn.numFormals; i++){
+			if (i > 0){ out << ", "; }
+			intExp(depth);
+		}
+		out << ")";
+	}
+
+	void block(size_t depth){
+		for (size_t i = 0; i < knobs.stmts; i++){ stmt(depth); }
+	}
+
+	void stmt(size_t depth){
+		size_t kind = pick(depth < knobs.stmtDepth ? 8 : 6);
+		if (kind == 5 && stringsLeft == 0){ kind = 0; }
+		indent(depth);
+		switch (kind){
+		case 0: case 1: case 2:
+			out << localVar() << " = ";
+			intExp(knobs.exprDepth);
+			out << ";\n";
+			return;
+		case 3:
+			out << localVar() << (pick(2) == 0 ? "++" : "--") << ";\n";
+			return;
+		case 4:
+			out << "toconsole ";
+			intExp(knobs.exprDepth);
+			out << ";\n";
+			return;
+		case 5:
+			stringsLeft--;
+			out << "toconsole \"s" << stringsLeft << "\\n\";\n";
+			return;
+		case 6:
+			out << "if (";
+			boolExp(knobs.exprDepth);
+			out << ") {\n";
+			block(depth + 1);
+			if (pick(2) == 0){
+				indent(depth);
+				out << "} else {\n";
+				block(depth + 1);
+			}
+			indent(depth);
+			out << "}\n";
+			return;
+		default: {
+			//A counter of its own keeps the loop short
+			std::string counter = "c" + std::to_string(loops++);
+			out << counter << " : int = 0;\n";
+			indent(depth);
+			out << "while (" << counter << " < " << pick(5) + 1
+				<< ") {\n";
+			indent(depth + 1);
+			out << counter << "++;\n";
+			block(depth + 1);
+			indent(depth);
+			out << "}\n";
+			return;
+		}
+		}
+	}
+
+	void locals(){
+		for (size_t i = 0; i < knobs.ids; i++){
+			out << "\tv" << i << " : int = " << pick(100) << ";\n";
+		}
+		loops = 0;
+	}
+
+	void function(const std::string& name, size_t formals, size_t callable){
+		out << name << " : (";
+		for (size_t i = 0; i < formals; i++){
+			if (i > 0){ out << ", "; }
+			out << "a" << i << " : int";
+		}
+		out << ") -> int {\n";
+		numFormals = formals;
+		numCallable = callable;
+		locals();
+		block(0);
+		out << "\treturn ";
+		intExp(knobs.exprDepth);
+		out << ";\n}\n\n";
+		fns.push_back(Fn{name, formals});
+	}
+
+	void main(){
+		out << "main : () -> int {\n";
+		numFormals = 0;
+		numCallable = fns.size();
+		locals();
+		block(0);
+		out << "\treturn 0;\n}\n";
+	}
+
+	Knobs knobs;
+	uint64_t state;
+	size_t stringsLeft;
+	size_t loops;
+	size_t numFormals = 0;
+	size_t numCallable = 0;
+	std::vector<Fn> fns;
+	std::ostringstream out;
+};
+
+void usageAndDie(){
+	std::cerr << "Usage: gen_alang <options> > prog.a\n"
+	<< " [-seed <N>]: Choose the program (default 1)\n"
+	<< " [-fns <N>]: Functions besides main (default 20)\n"
+	<< " [-stmts <N>]: Statements per block (default 12)\n"
+	<< " [-stmt-depth <N>]: Nesting of ifs and whiles (default 2)\n"
+	<< " [-expr-depth <N>]: Nesting of expressions (default 3)\n"
+	<< " [-ids <N>]: Locals per function (default 6)\n"
+	<< " [-globals <N>]: Global ints (default 4)\n"
+	<< " [-strings <N>]: String literals in the program (default 0)\n"
+	;
+	exit(1);
+}
+
+}
+
+int main(const int argc, const char **argv){
+	Knobs knobs;
+	for (int i = 1; i < argc; i++){
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * flag = argv[i];
+		uint64_t val = strtoull(argv[++i], nullptr, 10);
+		size_t num = static_cast<size_t>(val);
+		if (strcmp(flag, "-seed") == 0){
+			knobs.seed = val;
+		} else if (strcmp(flag, "-fns") == 0){
+			knobs.fns = num;
+		} else if (strcmp(flag, "-stmts") == 0){
+			knobs.stmts = num;
+		} else if (strcmp(flag, "-stmt-depth") == 0){
+			knobs.stmtDepth = num;
+		} else if (strcmp(flag, "-expr-depth") == 0){
+			knobs.exprDepth = num;
+		} else if (strcmp(flag, "-ids") == 0){
+			knobs.ids = num;
+		} else if (strcmp(flag, "-globals") == 0){
+			knobs.globals = num;
+		} else if (strcmp(flag, "-strings") == 0){
+			knobs.strings = num;
+		} else {
+			std::cerr << "Unrecognized argument: " << flag << std::endl;
+			usageAndDie();
+		}
+	}
+	//Every function has at least one local to assign
+	if (knobs.ids == 0){ knobs.ids = 1; }
+	Generator gen(knobs);
+	gen.program();
+	return 0;
+}
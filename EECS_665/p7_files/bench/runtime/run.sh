@@ -0,0 +1,61 @@
+#!/bin/sh
+# Runtime benchmark: run each program REPS times and report the
+# median wall time, with cycles and instructions from perf where
+# it can count them, and the size of the program's own code
+# (the .text of its object, leaving out the runtime library).
+#
+# A line per program is appended to RESULTS, tagged with the
+# commit and the ACFLAGS the programs were built with, so backend
+# changes and optimization levels can be compared run to run.
+
+REPS=${REPS:-5}
+RESULTS=${RESULTS:-results.tsv}
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+COMMIT="$COMMIT${ACFLAGS:+ $ACFLAGS}"
+if [ ! -f "$RESULTS" ]; then
+	printf "commit\tprogram\twall_ms\tcycles\tinstructions\ttext_bytes\n" \
+		> "$RESULTS"
+fi
+
+# perf needs both the tool and a PMU that will count for us
+PERF=no
+if command -v perf > /dev/null 2>&1 \
+  && perf stat -x, -e cycles,instructions true > /dev/null 2>&1; then
+	PERF=yes
+fi
+
+printf "%-12s %10s %15s %15s %10s\n" \
+	program "wall ms" cycles instructions "text B"
+for prog in "$@"; do
+	runs=""
+	rep=1
+	while [ "$rep" -le "$REPS" ]; do
+		start=$(date +%s%N)
+		if ! "./$prog.prog" < "$prog.in" > /dev/null; then
+			echo "$prog failed" >&2
+			exit 1
+		fi
+		end=$(date +%s%N)
+		runs="$runs $(( (end - start) / 1000 ))"
+		rep=$((rep + 1))
+	done
+	wall=$(echo $runs | tr ' ' '\n' | sort -n | \
+		awk -v reps="$REPS" 'NR == int((reps + 1) / 2) { printf "%.2f", $1 / 1000 }')
+
+	cycles=n/a
+	insns=n/a
+	if [ "$PERF" = yes ]; then
+		counts=$(perf stat -x, -e cycles,instructions \
+			"./$prog.prog" < "$prog.in" 2>&1 > /dev/null)
+		cycles=$(echo "$counts" | awk -F, '$3 ~ /^cycles/ { print $1 }')
+		insns=$(echo "$counts" | awk -F, '$3 ~ /^instructions/ { print $1 }')
+	fi
+
+	text=$(size -A "$prog.o" | awk '$1 == ".text" { print $2 }')
+
+	printf "%-12s %10s %15s %15s %10s\n" \
+		"$prog" "$wall" "$cycles" "$insns" "$text"
+	printf "%s\t%s\t%s\t%s\t%s\t%s\n" \
+		"$COMMIT" "$prog" "$wall" "$cycles" "$insns" "$text" >> "$RESULTS"
+done
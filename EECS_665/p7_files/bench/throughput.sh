@@ -0,0 +1,71 @@
+#!/bin/sh
+# Compile-throughput benchmark: generate programs of a few sizes
+# and report how fast each phase of ../ac gets through them
+# (tokens/s, AST nodes/s, quads/s, asm bytes/s). Each size is
+# compiled REPS times and the median rate kept. The programs
+# come from fixed seeds, so runs on different commits compare.
+#
+# A line per size and phase is appended to RESULTS, tagged
+# with the commit and any ACFLAGS (e.g. -O2), for comparing later.
+
+AC=${AC:-../ac}
+GEN=${GEN:-./gen_alang}
+REPS=${REPS:-3}
+RESULTS=${RESULTS:-results.tsv}
+WORK=${WORK:-out}
+# name:generator flags, smallest first
+SIZES=${SIZES:-"small:-fns 25 medium:-fns 100 large:-fns 400"}
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+COMMIT="$COMMIT${ACFLAGS:+ $ACFLAGS}"
+mkdir -p "$WORK"
+if [ ! -f "$RESULTS" ]; then
+	printf "commit\tsize\tphase\tunit\titems\twall_ms\titems_per_sec\n" > "$RESULTS"
+fi
+
+printf "%-8s %-14s %-7s %12s %10s %14s\n" \
+	size phase unit items "wall ms" "items/s"
+
+# The sizes are separated by spaces and their flags by dashes
+echo "$SIZES" | sed 's/ \([a-z]*:\)/\n\1/g' | while IFS=: read -r name flags; do
+	prog="$WORK/$name.a"
+	# shellcheck disable=SC2086
+	$GEN -seed 1 $flags > "$prog" || exit 1
+	rep=1
+	while [ "$rep" -le "$REPS" ]; do
+		# shellcheck disable=SC2086
+		if ! $AC "$prog" $ACFLAGS -o "$WORK/$name.s" \
+		  -time-passes-json "$WORK/$name.$rep.json"; then
+			echo "ac failed on $prog" >&2
+			exit 1
+		fi
+		rep=$((rep + 1))
+	done
+
+	# One phase a line in the JSON, in pipeline order; keep the
+	# phases that report items, then each one's median rep
+	TAB=$(printf '\t')
+	awk -F'"' '
+		/"unit"/ {
+			for (i = 1; i < NF; i++){
+				if ($i == "wall_ms"){ wall = $(i + 1) }
+				if ($i == "unit"){ unit = $(i + 2) }
+				if ($i == "items"){ items = $(i + 1) }
+				if ($i == "items_per_sec"){ rate = $(i + 1) }
+			}
+			gsub(/[:, ]/, "", wall); gsub(/[:, ]/, "", items)
+			gsub(/[:, }]/, "", rate)
+			print FNR "\t" $4 "\t" unit "\t" items "\t" wall "\t" rate
+		}' "$WORK/$name".*.json | sort -t "$TAB" -k1,1n -k6,6n | awk -F'\t' \
+		-v reps="$REPS" -v size="$name" -v commit="$COMMIT" \
+		-v results="$RESULTS" '
+		{
+			n[$1]++
+			if (n[$1] != int((reps + 1) / 2)){ next }
+			printf "%-8s %-14s %-7s %12d %10.2f %14.0f\n", \
+				size, $2, $3, $4, $5, $6
+			printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\n", commit, size, \
+				$2, $3, $4, $5, $6 >> results
+		}'
+	rm -f "$WORK/$name".*.json
+done
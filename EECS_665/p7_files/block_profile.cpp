@@ -0,0 +1,223 @@
+#include <fstream>
+#include <iostream>
+#include "block_profile.hpp"
+#include "cfg.hpp"
+
+namespace a_lang{
+
+static const char * const PROFILE_MAGIC = "ac-profile";
+static const unsigned PROFILE_VERSION = 1;
+
+//A hash of the procedure's quads and where its labels are,
+// which fixes its blocks. A profile taken of other code is no
+// use, and is told apart by this.
+static uint64_t shapeOf(Procedure * proc){
+	uint64_t hash = 14695981039346656037ULL;
+	auto mix = [&hash](const char * text){
+		for (const char * c = text; *c != '\0'; c++){
+			hash ^= static_cast<unsigned char>(*c);
+			hash *= 1099511628211ULL;
+		}
+	};
+	for (Quad * quad : *proc->getQuads()){
+		mix(quad->getLabels().empty() ? " " : ":");
+		mix(quad->kind());
+	}
+	return hash;
+}
+
+static void moveLabels(Quad * from, Quad * to){
+	for (Label * label : from->getLabels()){ to->addLabel(label); }
+	from->clearLabels();
+}
+
+void BlockProfile::instrument(IRProgram * prog){
+	std::string table = std::string(PROFILE_MAGIC) + " "
+		+ std::to_string(PROFILE_VERSION) + "\n";
+	size_t counters = 0;
+	for (Procedure * proc : *prog->getProcs()){
+		uint64_t shape = shapeOf(proc);
+		size_t first = counters;
+		ControlFlowGraph cfg(proc);
+		for (const ControlFlowGraph::Block& block : cfg.getBlocks()){
+			//Branches into the block now count it on the way in
+			Quad * head = block.quads.front();
+			CountQuad * count = new CountQuad(counters++);
+			moveLabels(head, count);
+			proc->insertQuad(head, count);
+		}
+		table += "proc " + proc->getName() + " " + std::to_string(shape)
+			+ " " + std::to_string(first)
+			+ " " + std::to_string(counters - first) + "\n";
+	}
+	prog->setProfileTable(counters, table);
+}
+
+static BlockProfile * unusable(const char * path, const char * why){
+	std::cerr << "Can't use profile " << path << ": " << why << "\n";
+	return nullptr;
+}
+
+BlockProfile * BlockProfile::load(const char * path){
+	std::ifstream in(path);
+	if (!in.good()){ return unusable(path, "can't open it"); }
+	std::string word;
+	unsigned version = 0;
+	in >> word >> version;
+	if (word != PROFILE_MAGIC){ return unusable(path, "not a profile"); }
+	if (version != PROFILE_VERSION){
+		return unusable(path, "written by another version");
+	}
+
+	struct Entry{
+		std::string name;
+		uint64_t shape;
+		size_t first;
+		size_t num;
+	};
+	std::vector<Entry> entries;
+	while (in >> word && word == "proc"){
+		Entry entry;
+		in >> entry.name >> entry.shape >> entry.first >> entry.num;
+		if (!in){ return unusable(path, "bad procedure line"); }
+		entries.push_back(entry);
+	}
+	size_t numCounts = 0;
+	if (word != "counts" || !(in >> numCounts)){
+		return unusable(path, "no counts (did the program finish?)");
+	}
+	std::vector<uint64_t> counts(numCounts);
+	for (uint64_t& count : counts){
+		if (!(in >> count)){ return unusable(path, "counts cut short"); }
+	}
+
+	BlockProfile * profile = new BlockProfile();
+	for (const Entry& entry : entries){
+		if (entry.first > numCounts || entry.num > numCounts - entry.first){
+			delete profile;
+			return unusable(path, "counter out of range");
+		}
+		ProcCounts& procCounts = profile->procs[entry.name];
+		procCounts.shape = entry.shape;
+		auto begin = counts.begin() + static_cast<std::ptrdiff_t>(entry.first);
+		procCounts.blocks.assign(begin,
+			begin + static_cast<std::ptrdiff_t>(entry.num));
+	}
+	return profile;
+}
+
+const std::vector<uint64_t> * BlockProfile::countsOf(Procedure * proc) const{
+	auto found = procs.find(proc->getName());
+	if (found == procs.end()){ return nullptr; }
+	if (found->second.shape != shapeOf(proc)){
+		std::cerr << "Profile of " << proc->getName()
+			<< " is out of date; not using it\n";
+		return nullptr;
+	}
+	return &found->second.blocks;
+}
+
+void BlockProfile::apply(IRProgram * prog) const{
+	for (Procedure * proc : *prog->getProcs()){
+		const std::vector<uint64_t> * counts = countsOf(proc);
+		if (counts == nullptr || counts->empty()){ continue; }
+		if ((*counts)[0] == 0){
+			proc->setCold(true);
+			continue;
+		}
+		layOut(proc, *counts);
+	}
+}
+
+//A label at the top of a block (or the leave quad, for EXIT),
+// making one if it has none
+static Label * labelAt(Procedure * proc, const ControlFlowGraph& cfg,
+  size_t block){
+	if (block == ControlFlowGraph::EXIT){ return proc->getLeaveLabel(); }
+	Quad * head = cfg.getBlocks()[block].quads.front();
+	if (head->getLabels().empty()){ head->addLabel(proc->makeLabel()); }
+	return head->getLabels().front();
+}
+
+static bool startsWith(Procedure * proc, const ControlFlowGraph& cfg,
+  size_t block, Label * label){
+	Quad * head = block == ControlFlowGraph::EXIT ? proc->getLeave()
+		: cfg.getBlocks()[block].quads.front();
+	for (Label * has : head->getLabels()){
+		if (has == label){ return true; }
+	}
+	return false;
+}
+
+void BlockProfile::layOut(Procedure * proc,
+  const std::vector<uint64_t>& counts){
+	const ControlFlowGraph cfg(proc);
+	const std::vector<ControlFlowGraph::Block>& blocks = cfg.getBlocks();
+	if (blocks.size() != counts.size()){ return; }
+
+	//Hot blocks keep their order, then the cold ones follow in
+	// theirs. The entry block stays first whatever its count.
+	std::vector<size_t> order;
+	std::vector<size_t> coldBlocks;
+	for (size_t idx = 0; idx < blocks.size(); idx++){
+		if (idx > 0 && counts[idx] == 0){ coldBlocks.push_back(idx); }
+		else { order.push_back(idx); }
+	}
+	if (coldBlocks.empty()){ return; }
+	order.insert(order.end(), coldBlocks.begin(), coldBlocks.end());
+
+	//A block that fell through into its old neighbour now has to
+	// get there some other way: by turning its branch around, if
+	// where that went is next now, or else with a jump. Each
+	// block's quads are still those of the CFG until every fix
+	// is chosen.
+	std::vector<Label *> jumpTo(blocks.size(), nullptr);
+	std::vector<bool> invert(blocks.size(), false);
+	for (size_t pos = 0; pos < order.size(); pos++){
+		size_t idx = order[pos];
+		size_t after = pos + 1 < order.size() ? order[pos + 1]
+			: ControlFlowGraph::EXIT;
+		size_t fallsTo = idx + 1 < blocks.size() ? idx + 1
+			: ControlFlowGraph::EXIT;
+		Quad * last = blocks[idx].quads.back();
+		if (dynamic_cast<GotoQuad *>(last) != nullptr){ continue; }
+		if (fallsTo == after){ continue; }
+
+		jumpTo[idx] = labelAt(proc, cfg, fallsTo);
+		IfzQuad * branch = dynamic_cast<IfzQuad *>(last);
+		invert[idx] = branch != nullptr
+			&& startsWith(proc, cfg, after, branch->getTarget());
+	}
+
+	//Where each block starts and ends once fixed (a branch turned
+	// around is a new quad, and may be the whole block)
+	std::vector<Quad *> heads(blocks.size(), nullptr);
+	std::vector<Quad *> tails(blocks.size(), nullptr);
+	for (size_t idx = 0; idx < blocks.size(); idx++){
+		heads[idx] = blocks[idx].quads.front();
+		tails[idx] = blocks[idx].quads.back();
+		if (jumpTo[idx] == nullptr){ continue; }
+		if (invert[idx]){
+			IfzQuad * branch = static_cast<IfzQuad *>(tails[idx]);
+			tails[idx] = new IfnzQuad(branch->getCnd(), jumpTo[idx]);
+			if (heads[idx] == branch){ heads[idx] = tails[idx]; }
+			proc->swapQuad(branch, tails[idx]);
+			continue;
+		}
+		Quad * jump = new GotoQuad(jumpTo[idx]);
+		proc->insertQuad(proc->getQuads()->next(tails[idx]->getHandle()), jump);
+		tails[idx] = jump;
+	}
+
+	for (size_t idx : coldBlocks){
+		Quad * quad = heads[idx];
+		while (true){
+			Quad * next = proc->getQuads()->next(quad->getHandle());
+			proc->moveToEnd(quad);
+			if (quad == tails[idx]){ break; }
+			quad = next;
+		}
+	}
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef A_LANG_BLOCK_PROFILE_HPP
+#define A_LANG_BLOCK_PROFILE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//How often each basic block of each procedure ran, as written
+// by a program built with -fprofile-generate. Blocks are those
+// of the lowered 3AC, before any optimization passes, so the
+// same source always numbers them the same way; a procedure
+// whose 3AC has changed since the profile was taken is left
+// alone.
+//
+// The file the program writes is the table the compiler laid
+// out (a line per procedure: name, shape, first counter and
+// number of counters), then the counters:
+//  ac-profile 1
+//  proc main 1234 0 5
+//  counts 5
+//  1
+//  ...
+class BlockProfile{
+public:
+	//Add a counter to the top of each block of each procedure,
+	// and the table of them to the program's data
+	static void instrument(IRProgram * prog);
+	//Read a profile, or say why it can't be used and return null
+	static BlockProfile * load(const char * path);
+
+	//Lay each profiled procedure out for its profile: blocks
+	// that never ran move to the end of the procedure (with
+	// branches turned around so the hot side falls through),
+	// and procedures that never ran go to the cold text section
+	void apply(IRProgram * prog) const;
+private:
+	struct ProcCounts{
+		uint64_t shape;
+		std::vector<uint64_t> blocks;
+	};
+	//Counts for proc's blocks, or null if there are none that
+	// fit the procedure as it is now
+	const std::vector<uint64_t> * countsOf(Procedure * proc) const;
+	static void layOut(Procedure * proc, const std::vector<uint64_t>& counts);
+
+	std::map<std::string, ProcCounts> procs;
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include <string.h>
+#include "buffered_writer.hpp"
+
+namespace a_lang{
+
+//Two ASCII digits for each value 0-99, so integers can be
+// formatted two digits per division
+static const char digitPairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static size_t formatUnsigned(char * out, unsigned long long num){
+	char tmp[24];
+	char * end = tmp + sizeof(tmp);
+	char * p = end;
+	while (num >= 100){
+		size_t idx = static_cast<size_t>(num % 100) * 2;
+		num /= 100;
+		*--p = digitPairs[idx + 1];
+		*--p = digitPairs[idx];
+	}
+	if (num >= 10){
+		size_t idx = static_cast<size_t>(num) * 2;
+		*--p = digitPairs[idx + 1];
+		*--p = digitPairs[idx];
+	} else {
+		*--p = static_cast<char>('0' + num);
+	}
+	size_t len = static_cast<size_t>(end - p);
+	memcpy(out, p, len);
+	return len;
+}
+
+BufferedWriter::BufferedWriter(std::ostream& sinkIn, size_t capacityIn)
+: sink(sinkIn), buf(capacityIn), used(0), flushed(0){
+}
+
+BufferedWriter::~BufferedWriter(){
+	flush();
+}
+
+void BufferedWriter::flush(){
+	if (used > 0){
+		sink.write(buf.data(), static_cast<std::streamsize>(used));
+		flushed += used;
+		used = 0;
+	}
+	sink.flush();
+}
+
+void BufferedWriter::write(const char * data, size_t len){
+	if (used + len > buf.size()){
+		flush();
+		if (len > buf.size()){
+			sink.write(data, static_cast<std::streamsize>(len));
+			flushed += len;
+			return;
+		}
+	}
+	memcpy(buf.data() + used, data, len);
+	used += len;
+}
+
+BufferedWriter& BufferedWriter::operator<<(const char * str){
+	write(str, strlen(str));
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(const std::string& str){
+	write(str.data(), str.size());
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(char c){
+	if (used == buf.size()){ flush(); }
+	buf[used++] = c;
+	return *this;
+}
+
+void BufferedWriter::writeSigned(long long num){
+	if (used + 24 > buf.size()){ flush(); }
+	used += formatInt(buf.data() + used, num);
+}
+
+void BufferedWriter::writeUnsigned(unsigned long long num){
+	if (used + 24 > buf.size()){ flush(); }
+	used += formatUnsigned(buf.data() + used, num);
+}
+
+size_t BufferedWriter::formatInt(char * out, long long num){
+	if (num < 0){
+		out[0] = '-';
+		unsigned long long mag = 0ULL - static_cast<unsigned long long>(num);
+		return 1 + formatUnsigned(out + 1, mag);
+	}
+	return formatUnsigned(out, static_cast<unsigned long long>(num));
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef A_LANG_BUFFERED_WRITER_HPP
+#define A_LANG_BUFFERED_WRITER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace a_lang{
+
+//Buffered text writer used for the compiler's large outputs
+// (3AC and x64). Text is gathered in one large contiguous
+// buffer and handed to the underlying stream in big chunks,
+// instead of paying for std::ostream formatting on every
+// small piece. Integers are formatted by hand straight into
+// the buffer, so writing never allocates.
+class BufferedWriter{
+public:
+	static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+	BufferedWriter(std::ostream& sinkIn,
+	  size_t capacityIn = DEFAULT_CAPACITY);
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+	virtual ~BufferedWriter();
+
+	BufferedWriter& operator<<(const char * str);
+	BufferedWriter& operator<<(const std::string& str);
+	BufferedWriter& operator<<(char c);
+
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value
+	  && std::is_signed<T>::value
+	  && !std::is_same<T, char>::value, BufferedWriter&>::type
+	operator<<(T num){
+		writeSigned(num);
+		return *this;
+	}
+
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value
+	  && std::is_unsigned<T>::value
+	  && !std::is_same<T, bool>::value, BufferedWriter&>::type
+	operator<<(T num){
+		writeUnsigned(num);
+		return *this;
+	}
+
+	void write(const char * data, size_t len);
+	void writeSigned(long long num);
+	void writeUnsigned(unsigned long long num);
+	//Hand everything buffered so far to the stream
+	void flush();
+	//Bytes written so far, flushed or not
+	size_t written() const { return flushed + used; }
+
+	//Format num into out (which must hold at least 21
+	// chars) and return the number of chars written
+	static size_t formatInt(char * out, long long num);
+private:
+	std::ostream& sink;
+	std::vector<char> buf;
+	size_t used;
+	size_t flushed;
+};
+
+}
+
+#endif
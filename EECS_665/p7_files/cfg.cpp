@@ -0,0 +1,61 @@
+#include "cfg.hpp"
+
+namespace a_lang{
+
+const size_t ControlFlowGraph::EXIT;
+
+ControlFlowGraph::ControlFlowGraph(Procedure * proc){
+	//Split the body into blocks, noting which labels start each
+	HashMap<Label *, size_t> labelBlocks;
+	bool endsBlock = true;
+	for (Quad * quad : *proc->getQuads()){
+		if (endsBlock || !quad->getLabels().empty()){
+			blocks.push_back(Block());
+		}
+		for (Label * label : quad->getLabels()){
+			labelBlocks[label] = blocks.size() - 1;
+		}
+		blocks.back().quads.push_back(quad);
+		endsBlock = quad->branchTarget() != nullptr;
+	}
+
+	//Anything not labelled in the body (the leave label, or a
+	// label the passes have dropped) is the exit
+	for (size_t idx = 0; idx < blocks.size(); idx++){
+		Block& block = blocks[idx];
+		Quad * last = block.quads.back();
+		Label * target = last->branchTarget();
+		bool fallsThrough = dynamic_cast<GotoQuad *>(last) == nullptr;
+		if (target != nullptr){
+			auto found = labelBlocks.find(target);
+			block.succs.push_back(
+				found == labelBlocks.end() ? EXIT : found->second);
+		}
+		if (fallsThrough){
+			block.succs.push_back(idx + 1 < blocks.size() ? idx + 1 : EXIT);
+		}
+		for (size_t succ : block.succs){
+			if (succ != EXIT){ blocks[succ].preds.push_back(idx); }
+		}
+	}
+}
+
+std::vector<bool> ControlFlowGraph::reachable() const{
+	std::vector<bool> seen(blocks.size(), false);
+	if (blocks.empty()){ return seen; }
+	std::vector<size_t> work(1, 0);
+	seen[0] = true;
+	while (!work.empty()){
+		size_t idx = work.back();
+		work.pop_back();
+		for (size_t succ : blocks[idx].succs){
+			if (succ != EXIT && !seen[succ]){
+				seen[succ] = true;
+				work.push_back(succ);
+			}
+		}
+	}
+	return seen;
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef A_LANG_CFG_HPP
+#define A_LANG_CFG_HPP
+
+#include <vector>
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//The basic blocks of a procedure's body and the edges between
+// them. A block starts at a labelled quad or after a branch and
+// runs to the next branch; the leave quad is the exit, outside
+// every block.
+class ControlFlowGraph{
+public:
+	//The successor that stands for the procedure's exit
+	static const size_t EXIT = SIZE_MAX;
+
+	struct Block{
+		std::vector<Quad *> quads;
+		std::vector<size_t> succs;
+		std::vector<size_t> preds;
+	};
+
+	ControlFlowGraph(Procedure * proc);
+
+	//Block 0 is the entry (when the body isn't empty)
+	const std::vector<Block>& getBlocks() const { return blocks; }
+	size_t numBlocks() const { return blocks.size(); }
+	//Which blocks control can reach from the entry
+	std::vector<bool> reachable() const;
+private:
+	std::vector<Block> blocks;
+};
+
+}
+
+#endif
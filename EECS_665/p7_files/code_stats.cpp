@@ -0,0 +1,140 @@
+#include <string.h>
+#include "code_stats.hpp"
+#include "3ac.hpp"
+
+namespace a_lang{
+
+const char * const CodeStats::SCHEMA = "ac-stats";
+
+ProcStats& CodeStats::get(const std::string& name){
+	for (ProcStats& stats : procs){
+		if (stats.name == name){ return stats; }
+	}
+	procs.push_back(ProcStats());
+	procs.back().name = name;
+	return procs.back();
+}
+
+ProcStats& CodeStats::addProc(Procedure * proc, const std::string& x64){
+	ProcStats& stats = get(proc->getName());
+	stats.quads[proc->getEnter()->kind()]++;
+	for (Quad * quad : *proc->getQuads()){
+		stats.quads[quad->kind()]++;
+	}
+	stats.quads[proc->getLeave()->kind()]++;
+	stats.temps = proc->numTemps();
+	stats.frameBytes = proc->getAllocBytes();
+	countX64(stats, x64);
+	return stats;
+}
+
+static bool isSlot(const char * begin, const char * end){
+	static const char rbp[] = "(%rbp)";
+	static const char rsp[] = "(%rsp)";
+	size_t len = sizeof(rbp) - 1;
+	return static_cast<size_t>(end - begin) >= len
+		&& (memcmp(end - len, rbp, len) == 0
+		|| memcmp(end - len, rsp, len) == 0);
+}
+
+static const char * skipSpace(const char * at, const char * end){
+	while (at < end && (*at == ' ' || *at == '\t')){ at++; }
+	return at;
+}
+
+//Counts AT&T syntax as the code generator writes it: one
+// instruction a line, perhaps after labels, with the
+// destination operand last. A slot that is the only operand
+// (as in pushq) or is compared is read; lea only takes the
+// slot's address, so it is neither.
+void CodeStats::countX64(ProcStats& stats, const std::string& x64){
+	const char * line = x64.data();
+	const char * textEnd = line + x64.size();
+	while (line < textEnd){
+		const char * end = static_cast<const char *>(
+			memchr(line, '\n', static_cast<size_t>(textEnd - line)));
+		if (end == nullptr){ end = textEnd; }
+		const char * at = skipSpace(line, end);
+		line = end + 1;
+
+		//Labels end in a colon, and the last one shares a line
+		// with the instruction it labels
+		const char * word = at;
+		while (word < end && *word != ' ' && *word != '\t'){ word++; }
+		while (word > at && word[-1] == ':'){
+			at = skipSpace(word, end);
+			word = at;
+			while (word < end && *word != ' ' && *word != '\t'){ word++; }
+		}
+		if (at == end || *at == '#' || *at == '.'){ continue; }
+
+		stats.insns++;
+		std::string op(at, word);
+		if (op.compare(0, 3, "lea") == 0){ continue; }
+		bool readsAll = op.compare(0, 3, "cmp") == 0
+			|| op.compare(0, 4, "test") == 0;
+
+		//Split the operands at commas outside parentheses
+		std::vector<std::pair<const char *, const char *>> opds;
+		const char * opd = skipSpace(word, end);
+		int depth = 0;
+		for (const char * c = opd; c <= end; c++){
+			if (c < end && *c == '('){ depth++; }
+			if (c < end && *c == ')'){ depth--; }
+			if (c == end || (*c == ',' && depth == 0)){
+				const char * opdEnd = c;
+				while (opdEnd > opd && opdEnd[-1] == ' '){ opdEnd--; }
+				if (opdEnd > opd){ opds.push_back({opd, opdEnd}); }
+				opd = skipSpace(c + 1, end);
+			}
+		}
+		for (size_t i = 0; i < opds.size(); i++){
+			if (!isSlot(opds[i].first, opds[i].second)){ continue; }
+			bool dest = i + 1 == opds.size() && opds.size() > 1;
+			if (dest && !readsAll){
+				stats.slotStores++;
+			} else {
+				stats.slotLoads++;
+			}
+		}
+	}
+}
+
+void CodeStats::writeJSON(std::ostream& out) const{
+	out << "{\n  \"schema\": \"" << SCHEMA << "\",\n  \"version\": 1,\n"
+		<< "  \"procedures\": [";
+	bool firstProc = true;
+	for (const ProcStats& stats : procs){
+		out << (firstProc ? "\n" : ",\n");
+		firstProc = false;
+		//Procedure names are identifiers, so need no escaping
+		out << "    {\"name\": \"" << stats.name << "\",\n"
+			<< "     \"quads\": {";
+		bool first = true;
+		size_t total = 0;
+		for (auto pair : stats.quads){
+			out << (first ? "" : ", ") << "\"" << pair.first << "\": "
+				<< pair.second;
+			first = false;
+			total += pair.second;
+		}
+		out << "},\n"
+			<< "     \"quad_count\": " << total
+			<< ", \"temps\": " << stats.temps
+			<< ", \"frame_bytes\": " << stats.frameBytes << ",\n"
+			<< "     \"x64\": {\"insns\": " << stats.insns
+			<< ", \"slot_loads\": " << stats.slotLoads
+			<< ", \"slot_stores\": " << stats.slotStores << "},\n"
+			<< "     \"counters\": {";
+		first = true;
+		for (auto pair : stats.counters){
+			out << (first ? "" : ", ") << "\"" << pair.first << "\": "
+				<< pair.second;
+			first = false;
+		}
+		out << "}}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+}
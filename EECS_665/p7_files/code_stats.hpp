@@ -0,0 +1,52 @@
+#ifndef A_LANG_CODE_STATS_HPP
+#define A_LANG_CODE_STATS_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace a_lang{
+
+class Procedure;
+
+//What one procedure looks like as 3AC and as x64 (-stats)
+struct ProcStats{
+	std::string name;
+	//Quads (enter and leave included) by Quad::kind
+	std::map<std::string, size_t> quads;
+	//Temps made by makeTmp
+	size_t temps = 0;
+	//Stack frame size chosen by allocLocals
+	long long frameBytes = 0;
+	//Instructions emitted, and how many of them read or write
+	// a frame slot (off %rbp, or %rsp where there is no %rbp)
+	size_t insns = 0;
+	size_t slotLoads = 0;
+	size_t slotStores = 0;
+	//Anything else a pass wants to report, under its own name
+	std::map<std::string, long long> counters;
+};
+
+//Per-procedure statistics for a whole program, written as JSON.
+// The schema is stable: existing fields keep their meaning,
+// and new numbers go in a procedure's counters object (or as
+// new fields), so consumers can ignore what they don't know.
+class CodeStats{
+public:
+	static const char * const SCHEMA;
+
+	//Record proc, whose code (already laid out by toX64) is x64
+	ProcStats& addProc(Procedure * proc, const std::string& x64);
+	//The stats for the procedure called name, made if need be
+	ProcStats& get(const std::string& name);
+	void writeJSON(std::ostream& out) const;
+private:
+	static void countX64(ProcStats& stats, const std::string& x64);
+
+	std::vector<ProcStats> procs;
+};
+
+}
+
+#endif
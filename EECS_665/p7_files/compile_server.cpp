@@ -0,0 +1,280 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "compile_server.hpp"
+
+namespace a_lang{
+
+//Bounds on a request, so a bad client can't make the server
+// allocate without limit
+static const uint32_t MAX_ARGS = 1 << 12;
+static const uint32_t MAX_ARG_LEN = 1 << 16;
+//The server compiles one request at a time, so a client gets
+// this long to send its whole request, and the reply waits
+// this long at most for room to write, before it is dropped
+static const int CLIENT_TIMEOUT_MS = 5000;
+//For recvAll: wait as long as it takes
+static const int64_t NO_DEADLINE = -1;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int){
+	stopRequested = 1;
+}
+
+static bool sendAll(int fd, const char * data, size_t len){
+	while (len > 0){
+		ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR){ continue; }
+		if (sent <= 0){ return false; }
+		data += sent;
+		len -= static_cast<size_t>(sent);
+	}
+	return true;
+}
+
+static int64_t nowMs(){
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+//Fails once deadline (from nowMs) passes, unless it is NO_DEADLINE
+static bool recvAll(int fd, char * data, size_t len, int64_t deadline){
+	while (len > 0){
+		if (deadline != NO_DEADLINE){
+			int64_t left = deadline - nowMs();
+			if (left <= 0){ return false; }
+			pollfd wait = {fd, POLLIN, 0};
+			int ready = poll(&wait, 1, static_cast<int>(left));
+			if (ready < 0 && errno == EINTR){ continue; }
+			if (ready <= 0){ return false; }
+		}
+		ssize_t got = recv(fd, data, len, 0);
+		if (got < 0 && errno == EINTR){ continue; }
+		if (got <= 0){ return false; }
+		data += got;
+		len -= static_cast<size_t>(got);
+	}
+	return true;
+}
+
+static bool sendNum(int fd, uint32_t val){
+	return sendAll(fd, reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+static bool recvNum(int fd, uint32_t& val, int64_t deadline){
+	return recvAll(fd, reinterpret_cast<char *>(&val), sizeof(val),
+		deadline);
+}
+
+static bool sendStr(int fd, const std::string& str){
+	return sendNum(fd, static_cast<uint32_t>(str.size()))
+		&& sendAll(fd, str.data(), str.size());
+}
+
+static bool recvStr(int fd, std::string& str, uint32_t maxLen,
+  int64_t deadline){
+	uint32_t len;
+	if (!recvNum(fd, len, deadline) || len > maxLen){ return false; }
+	str.resize(len);
+	return len == 0 || recvAll(fd, &str[0], len, deadline);
+}
+
+static bool socketAddr(const std::string& path, sockaddr_un& addr){
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)){ return false; }
+	memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+static int connectTo(const std::string& path){
+	sockaddr_un addr;
+	if (!socketAddr(path, addr)){ return -1; }
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0){ return -1; }
+	if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+CompileServer::CompileServer(const std::string& pathIn, Handler handlerIn,
+  std::function<void()> cleanupIn)
+: path(pathIn), handler(handlerIn), cleanup(cleanupIn), sock(-1){ }
+
+CompileServer::~CompileServer(){
+	if (sock >= 0){
+		close(sock);
+		unlink(path.c_str());
+	}
+}
+
+bool CompileServer::listen(){
+	sockaddr_un addr;
+	if (!socketAddr(path, addr)){
+		std::cerr << "Socket path too long: " << path << "\n";
+		return false;
+	}
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0){
+		std::cerr << "Cannot create socket: " << strerror(errno) << "\n";
+		return false;
+	}
+	sockaddr * raw = reinterpret_cast<sockaddr *>(&addr);
+	bool bound = bind(sock, raw, sizeof(addr)) == 0;
+	if (!bound && errno == EADDRINUSE){
+		//Left behind by a server that didn't shut down cleanly,
+		// unless something still answers on it
+		int other = connectTo(path);
+		if (other >= 0){
+			close(other);
+			std::cerr << "A server is already listening on " << path << "\n";
+			close(sock);
+			sock = -1;
+			return false;
+		}
+		unlink(path.c_str());
+		bound = bind(sock, raw, sizeof(addr)) == 0;
+	}
+	if (!bound){
+		std::cerr << "Cannot bind " << path << ": " << strerror(errno) << "\n";
+		close(sock);
+		sock = -1;
+		return false;
+	}
+	if (::listen(sock, 64) != 0){
+		std::cerr << "Cannot listen on " << path << ": "
+			<< strerror(errno) << "\n";
+		close(sock);
+		sock = -1;
+		return false;
+	}
+	return true;
+}
+
+int CompileServer::serve(){
+	if (!listen()){ return 1; }
+
+	//No SA_RESTART, so a signal wakes accept up to stop
+	struct sigaction stop;
+	memset(&stop, 0, sizeof(stop));
+	stop.sa_handler = requestStop;
+	sigemptyset(&stop.sa_mask);
+	sigaction(SIGINT, &stop, nullptr);
+	sigaction(SIGTERM, &stop, nullptr);
+
+	while (!stopRequested){
+		int conn = accept(sock, nullptr, nullptr);
+		if (conn < 0){
+			if (errno == EINTR){ continue; }
+			std::cerr << "accept failed: " << strerror(errno) << "\n";
+			return 1;
+		}
+		handle(conn);
+		close(conn);
+		if (cleanup){ cleanup(); }
+	}
+	return 0;
+}
+
+void CompileServer::handle(int conn){
+	//A client that stalls is dropped rather than holding up
+	// the requests queued behind it
+	int64_t deadline = nowMs() + CLIENT_TIMEOUT_MS;
+	timeval sendWait = {CLIENT_TIMEOUT_MS / 1000,
+		CLIENT_TIMEOUT_MS % 1000 * 1000};
+	setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &sendWait, sizeof(sendWait));
+
+	uint32_t count;
+	if (!recvNum(conn, count, deadline) || count == 0 || count > MAX_ARGS){
+		return;
+	}
+	std::string cwd;
+	if (!recvStr(conn, cwd, MAX_ARG_LEN, deadline)){ return; }
+	std::vector<std::string> args(count - 1);
+	for (std::string& arg : args){
+		if (!recvStr(conn, arg, MAX_ARG_LEN, deadline)){ return; }
+	}
+
+	//Relative paths are the client's
+	int home = open(".", O_RDONLY | O_DIRECTORY);
+	std::ostringstream outText;
+	std::ostringstream errText;
+	std::streambuf * oldOut = std::cout.rdbuf(outText.rdbuf());
+	std::streambuf * oldErr = std::cerr.rdbuf(errText.rdbuf());
+	int status = 1;
+	if (chdir(cwd.c_str()) != 0){
+		std::cerr << "Cannot enter " << cwd << "\n";
+	} else {
+		try {
+			status = handler(args);
+		} catch (...){
+			std::cerr << "InternalError: unexpected exception\n";
+			status = 1;
+		}
+	}
+	std::cout.flush();
+	std::cerr.flush();
+	std::cout.rdbuf(oldOut);
+	std::cerr.rdbuf(oldErr);
+	if (home >= 0){
+		if (fchdir(home) != 0){
+			std::cerr << "Cannot return to the server's directory\n";
+		}
+		close(home);
+	}
+
+	//A client that has gone away just misses its reply
+	if (sendNum(conn, static_cast<uint32_t>(status))){
+		if (sendStr(conn, outText.str())){ sendStr(conn, errText.str()); }
+	}
+}
+
+bool CompileServer::request(const std::string& path,
+  const std::vector<std::string>& args, int& status){
+	int fd = connectTo(path);
+	if (fd < 0){ return false; }
+
+	char * cwd = getcwd(nullptr, 0);
+	bool sent = cwd != nullptr
+		&& sendNum(fd, static_cast<uint32_t>(args.size() + 1))
+		&& sendStr(fd, cwd);
+	free(cwd);
+	for (size_t i = 0; sent && i < args.size(); i++){
+		sent = sendStr(fd, args[i]);
+	}
+
+	uint32_t result;
+	std::string outText;
+	std::string errText;
+	//The compile itself may take a while
+	bool replied = sent && recvNum(fd, result, NO_DEADLINE)
+		&& recvStr(fd, outText, UINT32_MAX, NO_DEADLINE)
+		&& recvStr(fd, errText, UINT32_MAX, NO_DEADLINE);
+	close(fd);
+	if (!replied){
+		std::cerr << "Lost the connection to the server on " << path << "\n";
+		status = 1;
+		return true;
+	}
+	std::cout << outText << std::flush;
+	std::cerr << errText << std::flush;
+	status = static_cast<int>(result);
+	return true;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef A_LANG_COMPILE_SERVER_HPP
+#define A_LANG_COMPILE_SERVER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace a_lang{
+
+//A long-running compiler that takes requests on a Unix socket,
+// so each compile skips process startup and finds the type
+// tables, allocator and function cache already warm.
+//
+// A request is the client's working directory and its command
+// line; the reply is the exit status and whatever the compile
+// wrote to stdout and stderr. Requests are served one at a
+// time, in the client's directory.
+class CompileServer{
+public:
+	//Runs one compile: the arguments as main would see them
+	// (minus the program name) to an exit status. Anything it
+	// prints to std::cout or std::cerr goes back to the client.
+	using Handler = std::function<int(const std::vector<std::string>&)>;
+
+	//cleanupIn, if given, runs after each reply has been sent,
+	// so tidying up after a compile doesn't hold up its client
+	CompileServer(const std::string& pathIn, Handler handlerIn,
+	  std::function<void()> cleanupIn = nullptr);
+	~CompileServer();
+	CompileServer(const CompileServer&) = delete;
+	CompileServer& operator=(const CompileServer&) = delete;
+
+	//Serve until SIGINT or SIGTERM. Returns the exit status.
+	int serve();
+
+	//Send a compile to the server at path and print its output.
+	// Returns false, having printed nothing, if no server is
+	// listening there.
+	static bool request(const std::string& path,
+	  const std::vector<std::string>& args, int& status);
+private:
+	bool listen();
+	void handle(int conn);
+
+	std::string path;
+	Handler handler;
+	std::function<void()> cleanup;
+	int sock;
+};
+
+}
+
+#endif
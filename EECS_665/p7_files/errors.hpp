@@ -54,7 +54,26 @@ public:
 		const Position * pos,
 		const char * msg
 	){
-		std::cerr << "FATAL " 
+		fatal(sink(), pos, msg);
+	}
+
+	//Where the calling thread's reports go (stderr unless set).
+	// Passes that run on worker threads point this at a buffer
+	// and print the buffers in source order afterwards.
+	static void setSink(std::ostream * out){
+		sinkPtr() = out;
+	}
+	static std::ostream& sink(){
+		std::ostream * out = sinkPtr();
+		return out == nullptr ? std::cerr : *out;
+	}
+
+	static void fatal(
+		std::ostream& out,
+		const Position * pos,
+		const char * msg
+	){
+		out << "FATAL " 
 		<< pos->span()
 		<< ": " 
 		<< msg  << std::endl;
@@ -66,6 +85,11 @@ public:
 	){
 		fatal(pos,msg.c_str());
 	}
+private:
+	static std::ostream *& sinkPtr(){
+		static thread_local std::ostream * out = nullptr;
+		return out;
+	}
 };
 
 }
@@ -0,0 +1,436 @@
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "fast_scanner.hpp"
+
+namespace a_lang{
+
+using TokenKind = a_lang::Parser::token;
+
+//Returned by the helpers when a lexeme was consumed but
+// (as with a bad string literal) produced no token
+static const int NO_TOKEN = -1;
+
+/* ------------------------ Keywords ------------------------ */
+
+struct Keyword{
+	const char * text;
+	size_t len;
+	int kind;
+};
+
+//Every keyword lands in its own slot under this hash, so a
+// lookup is one probe plus a compare
+static const size_t KEYWORD_SLOTS = 64;
+
+static size_t keywordHash(const char * s, size_t len){
+	size_t first = static_cast<unsigned char>(s[0]);
+	size_t last = static_cast<unsigned char>(s[len - 1]);
+	return (first + last + (len << 4)) & (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable{
+	Keyword slots[KEYWORD_SLOTS];
+};
+
+static KeywordTable buildKeywordTable(){
+	static const Keyword keywords[] = {
+		{"bool", 4, TokenKind::BOOL},
+		{"else", 4, TokenKind::ELSE},
+		{"false", 5, TokenKind::FALSE},
+		{"fromconsole", 11, TokenKind::FROMCONSOLE},
+		{"if", 2, TokenKind::IF},
+		{"int", 3, TokenKind::INT},
+		{"immutable", 9, TokenKind::IMMUTABLE},
+		{"return", 6, TokenKind::RETURN},
+		{"toconsole", 9, TokenKind::TOCONSOLE},
+		{"true", 4, TokenKind::TRUE},
+		{"void", 4, TokenKind::VOID},
+		{"means", 5, TokenKind::MEANS},
+		{"maybe", 5, TokenKind::MAYBE},
+		{"otherwise", 9, TokenKind::OTHERWISE},
+		{"while", 5, TokenKind::WHILE},
+		{"and", 3, TokenKind::AND},
+		{"or", 2, TokenKind::OR},
+	};
+	KeywordTable table;
+	for (size_t i = 0; i < KEYWORD_SLOTS; i++){
+		table.slots[i] = Keyword{nullptr, 0, NO_TOKEN};
+	}
+	for (const Keyword& kw : keywords){
+		Keyword& slot = table.slots[keywordHash(kw.text, kw.len)];
+		if (slot.text != nullptr){
+			throw new InternalError("Keyword hash is not perfect");
+		}
+		slot = kw;
+	}
+	return table;
+}
+
+static int keywordKind(const char * s, size_t len){
+	static const KeywordTable table = buildKeywordTable();
+	const Keyword& slot = table.slots[keywordHash(s, len)];
+	if (slot.len == len && memcmp(slot.text, s, len) == 0){
+		return slot.kind;
+	}
+	return NO_TOKEN;
+}
+
+/* -------------------- Character runs --------------------- */
+
+static bool isDigit(char c){
+	return c >= '0' && c <= '9';
+}
+
+static bool isIdentStart(char c){
+	char lower = static_cast<char>(c | 0x20);
+	return (lower >= 'a' && lower <= 'z') || c == '_';
+}
+
+static bool isIdentChar(char c){
+	return isIdentStart(c) || isDigit(c);
+}
+
+#if defined(__SSE2__)
+static __m128i load16(const char * p){
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+//Bit i is set iff byte i of v is in [lo, hi]
+static __m128i inRange(__m128i v, char lo, char hi){
+	__m128i above = _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1)));
+	__m128i below = _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1)));
+	return _mm_and_si128(above, below);
+}
+
+static unsigned maskOf(__m128i v){
+	return static_cast<unsigned>(_mm_movemask_epi8(v));
+}
+
+static const unsigned ALL16 = 0xFFFF;
+#endif
+
+//Each helper returns the first position in [p, end) that
+// does not belong to the run. While at least 16 bytes remain
+// the run is classified a vector at a time; the tail (which
+// may not be safe to over-read) is finished byte by byte.
+static const char * skipBlanks(const char * p, const char * end){
+#if defined(__SSE2__)
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	while (end - p >= 16){
+		__m128i v = load16(p);
+		unsigned in = maskOf(_mm_or_si128(
+			_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)));
+		if (in != ALL16){ return p + __builtin_ctz(~in); }
+		p += 16;
+	}
+#endif
+	while (p < end && (*p == ' ' || *p == '\t')){ p++; }
+	return p;
+}
+
+static const char * skipIdentChars(const char * p, const char * end){
+#if defined(__SSE2__)
+	const __m128i under = _mm_set1_epi8('_');
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	while (end - p >= 16){
+		__m128i v = load16(p);
+		__m128i alpha = inRange(_mm_or_si128(v, caseBit), 'a', 'z');
+		__m128i digit = inRange(v, '0', '9');
+		unsigned in = maskOf(_mm_or_si128(_mm_or_si128(alpha, digit),
+			_mm_cmpeq_epi8(v, under)));
+		if (in != ALL16){ return p + __builtin_ctz(~in); }
+		p += 16;
+	}
+#endif
+	while (p < end && isIdentChar(*p)){ p++; }
+	return p;
+}
+
+static const char * skipDigits(const char * p, const char * end){
+#if defined(__SSE2__)
+	while (end - p >= 16){
+		unsigned in = maskOf(inRange(load16(p), '0', '9'));
+		if (in != ALL16){ return p + __builtin_ctz(~in); }
+		p += 16;
+	}
+#endif
+	while (p < end && isDigit(*p)){ p++; }
+	return p;
+}
+
+//Skip ordinary string literal characters, stopping at
+// anything that needs a closer look: '"', '\\' or newline
+static const char * skipStrChars(const char * p, const char * end){
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i slash = _mm_set1_epi8('\\');
+	const __m128i newline = _mm_set1_epi8('\n');
+	while (end - p >= 16){
+		__m128i v = load16(p);
+		unsigned stop = maskOf(_mm_or_si128(_mm_or_si128(
+			_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+			_mm_cmpeq_epi8(v, newline)));
+		if (stop != 0){ return p + __builtin_ctz(stop); }
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '"' && *p != '\\' && *p != '\n'){ p++; }
+	return p;
+}
+
+//Comments run to the end of the line; memchr is already
+// vectorized by the C library
+static const char * skipToLineEnd(const char * p, const char * end){
+	const void * nl = memchr(p, '\n', static_cast<size_t>(end - p));
+	if (nl == nullptr){ return end; }
+	return static_cast<const char *>(nl);
+}
+
+/* ------------------------ Scanner ------------------------ */
+
+FastScanner::FastScanner(const char * path, TokenBuffer * tokensIn)
+: Scanner(nullptr, tokensIn), myBuf(nullptr), myCur(nullptr), myEnd(nullptr){
+	myTokens->mapSource(path);
+	myBuf = myTokens->source();
+	myCur = myBuf;
+	myEnd = myBuf + myTokens->sourceSize();
+}
+
+FastScanner::FastScanner(TokenBuffer * tokensIn, const char * source,
+  size_t begin, size_t end)
+: Scanner(nullptr, tokensIn), myBuf(source), myCur(source + begin),
+  myEnd(source + end){
+}
+
+FastScanner::~FastScanner(){
+}
+
+//Chunks smaller than this aren't worth a thread
+static const size_t MIN_CHUNK = 1 << 20;
+
+void FastScanner::lexParallel(const char * path, TokenBuffer * tokens,
+  size_t jobs){
+	tokens->mapSource(path);
+	const char * src = tokens->source();
+	size_t size = tokens->sourceSize();
+
+	//Cut just past a newline near each even split point
+	size_t chunks = std::max<size_t>(1, std::min(jobs, size / MIN_CHUNK));
+	std::vector<size_t> cuts(1, 0);
+	for (size_t i = 1; i < chunks; i++){
+		size_t target = std::max(size / chunks * i, cuts.back());
+		const void * nl = memchr(src + target, '\n', size - target);
+		if (nl == nullptr){ break; }
+		cuts.push_back(static_cast<size_t>(
+			static_cast<const char *>(nl) - src) + 1);
+	}
+	cuts.push_back(size);
+	chunks = cuts.size() - 1;
+
+	//Run work(0..chunks-1), chunk 0 on this thread
+	auto runChunks = [chunks](const auto& work){
+		std::vector<std::thread> workers;
+		for (size_t c = 1; c < chunks; c++){
+			workers.emplace_back(work, c);
+		}
+		work(0);
+		for (std::thread& worker : workers){ worker.join(); }
+	};
+
+	//Workers print error positions, so the line table has to
+	// be complete before they start
+	tokens->indexLines();
+
+	std::vector<std::unique_ptr<TokenBuffer>> parts;
+	std::vector<std::unique_ptr<std::ostringstream>> errs;
+	for (size_t c = 0; c < chunks; c++){
+		parts.emplace_back(new TokenBuffer());
+		errs.emplace_back(new std::ostringstream());
+	}
+	runChunks([&](size_t c){
+		FastScanner scanner(parts[c].get(), src, cuts[c], cuts[c + 1]);
+		scanner.redirectErrors(*errs[c]);
+		while (scanner.lexToken() != TokenKind::END){ }
+	});
+
+	size_t total = 1;
+	for (auto& part : parts){ total += part->size(); }
+	tokens->reserve(total);
+	for (size_t c = 0; c < chunks; c++){
+		tokens->append(*parts[c]);
+		std::cerr << errs[c]->str();
+	}
+	tokens->add(TokenKind::END, size, 0, 0);
+}
+
+int FastScanner::lexToken(){
+	while (myCur < myEnd){
+		const char * start = myCur;
+		myMatchStart = static_cast<size_t>(start - myBuf);
+		const char c = *start;
+		const char next = (start + 1 < myEnd) ? start[1] : '\0';
+
+		if (c == ' ' || c == '\t'){
+			myCur = skipBlanks(start, myEnd);
+			continue;
+		}
+		if (c == '\n' || (c == '\r' && next == '\n')){
+			myCur += (c == '\n') ? 1 : 2;
+			continue;
+		}
+		if (c == '#'){
+			/* Comment. No token */
+			myCur = skipToLineEnd(start, myEnd);
+			continue;
+		}
+
+		if (isIdentStart(c)){
+			myCur = skipIdentChars(start + 1, myEnd);
+			size_t len = static_cast<size_t>(myCur - start);
+			//eh? is the one keyword that isn't an identifier
+			if (len == 2 && c == 'e' && next == 'h'
+			  && myCur < myEnd && *myCur == '?'){
+				myCur = start;
+				return bare(TokenKind::EH, 3);
+			}
+			int kind = keywordKind(start, len);
+			if (kind != NO_TOKEN){
+				myCur = start;
+				return bare(kind, len);
+			}
+			return addToken(TokenKind::ID, len, 0);
+		}
+		if (isDigit(c)){
+			return lexIntLit(start);
+		}
+		if (c == '"'){
+			int kind = lexStrLit(start);
+			if (kind != NO_TOKEN){ return kind; }
+			continue;
+		}
+
+		switch (c){
+		case '-':
+			if (next == '>'){ return bare(TokenKind::ARROW, 2); }
+			if (next == '-'){ return bare(TokenKind::POSTDEC, 2); }
+			return bare(TokenKind::DASH, 1);
+		case '+':
+			if (next == '+'){ return bare(TokenKind::POSTINC, 2); }
+			return bare(TokenKind::CROSS, 1);
+		case '=':
+			if (next == '='){ return bare(TokenKind::EQUALS, 2); }
+			return bare(TokenKind::ASSIGN, 1);
+		case '>':
+			if (next == '='){ return bare(TokenKind::GREATEREQ, 2); }
+			return bare(TokenKind::GREATER, 1);
+		case '<':
+			if (next == '='){ return bare(TokenKind::LESSEQ, 2); }
+			return bare(TokenKind::LESS, 1);
+		case '!':
+			if (next == '='){ return bare(TokenKind::NOTEQUALS, 2); }
+			return bare(TokenKind::NOT, 1);
+		case ':': return bare(TokenKind::COLON, 1);
+		case ',': return bare(TokenKind::COMMA, 1);
+		case '{': return bare(TokenKind::LCURLY, 1);
+		case '}': return bare(TokenKind::RCURLY, 1);
+		case '(': return bare(TokenKind::LPAREN, 1);
+		case ')': return bare(TokenKind::RPAREN, 1);
+		case ';': return bare(TokenKind::SEMICOL, 1);
+		case '/': return bare(TokenKind::SLASH, 1);
+		case '*': return bare(TokenKind::STAR, 1);
+		case '&': return bare(TokenKind::REF, 1);
+		default:
+			lexIllegal(start);
+		}
+	}
+	return addEnd();
+}
+
+//Digits are accumulated in the same pass that checks for
+// overflow: leading zeros are skipped, and more than 10
+// significant digits or a value above INT_MAX overflows
+int FastScanner::lexIntLit(const char * start){
+	myCur = skipDigits(start, myEnd);
+	size_t len = static_cast<size_t>(myCur - start);
+
+	unsigned long long val = 0;
+	size_t sigDigits = 0;
+	for (const char * p = start; p < myCur; p++){
+		if (sigDigits == 0 && *p == '0'){ continue; }
+		sigDigits++;
+		if (sigDigits <= 10){
+			val = val * 10 + static_cast<unsigned long long>(*p - '0');
+		}
+	}
+
+	int intVal = static_cast<int>(val);
+	if (sigDigits > 10 || val > INT_MAX){
+		errIntOverflow(matchPos(len));
+		intVal = 0;
+	}
+	return addToken(TokenKind::INTLITERAL, len, intVal);
+}
+
+//Mirrors the string rules of a.l: a literal ends at a closing
+// quote, at a newline, or at a backslash with nothing to
+// escape; any escape other than \n \t \" \\ makes it bad
+int FastScanner::lexStrLit(const char * start){
+	const char * p = start + 1;
+	bool badEsc = false;
+	bool closed = false;
+	while (true){
+		p = skipStrChars(p, myEnd);
+		if (p == myEnd || *p == '\n'){
+			break;
+		}
+		if (*p == '"'){
+			p++;
+			closed = true;
+			break;
+		}
+		//Backslash: a trailing one is kept in the lexeme
+		if (p + 1 == myEnd || p[1] == '\n'){
+			p++;
+			badEsc = true;
+			break;
+		}
+		char escapee = p[1];
+		if (escapee != 'n' && escapee != 't'
+		  && escapee != '"' && escapee != '\\'){
+			badEsc = true;
+		}
+		p += 2;
+	}
+
+	size_t len = static_cast<size_t>(p - start);
+	myCur = p;
+	if (closed && !badEsc){
+		return addToken(TokenKind::STRINGLITERAL, len, 0);
+	}
+
+	if (closed){
+		errStrEsc(matchPos(len));
+	} else if (badEsc){
+		errStrEscAndUnterm(matchPos(len));
+	} else {
+		errStrUnterm(matchPos(len));
+	}
+	return NO_TOKEN;
+}
+
+int FastScanner::lexIllegal(const char * start){
+	errIllegal(matchPos(1), std::string(start, 1));
+	myCur = start + 1;
+	return NO_TOKEN;
+}
+
+}
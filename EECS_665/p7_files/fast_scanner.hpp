@@ -0,0 +1,50 @@
+#ifndef __A_LANG_FAST_SCANNER_HPP__
+#define __A_LANG_FAST_SCANNER_HPP__ 1
+
+#include "scanner.hpp"
+
+namespace a_lang {
+
+//A hand-written alternative to the flex scanner in a.l. It
+// produces exactly the same tokens and error reports, and
+// fills the token buffer through the same virtual lexToken.
+// The source file is mmapped (by the buffer, so its tokens
+// can point into it) rather than read through an istream,
+// runs of whitespace, comment text, identifier and digit
+// characters are skipped 16 bytes at a time with SSE2, and
+// keywords are recognized with a perfect hash.
+class FastScanner : public Scanner {
+public:
+   FastScanner(const char * path, TokenBuffer * tokensIn);
+   //Lex only source[begin, end). Token offsets are still
+   // relative to source.
+   FastScanner(TokenBuffer * tokensIn, const char * source,
+     size_t begin, size_t end);
+   virtual ~FastScanner();
+
+   virtual int lexToken() override;
+
+   //Fill tokens from the file at path using up to jobs threads.
+   // Tokens never span a newline, so the file is cut into
+   // line-aligned chunks that are lexed independently and then
+   // stitched back together in order.
+   static void lexParallel(const char * path, TokenBuffer * tokens,
+     size_t jobs);
+
+private:
+   int bare(int kind, size_t len){
+	myCur += len;
+	return addToken(kind, len, 0);
+   }
+   int lexIntLit(const char * start);
+   int lexStrLit(const char * start);
+   int lexIllegal(const char * start);
+
+   const char * myBuf;
+   const char * myCur;
+   const char * myEnd;
+};
+
+} /* end namespace */
+
+#endif /* END __A_LANG_FAST_SCANNER_HPP__ */
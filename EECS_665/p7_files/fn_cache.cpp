@@ -0,0 +1,281 @@
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <link.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "fn_cache.hpp"
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//Bump when the entry layout changes. Entries also name the
+// build of ac that wrote them (see buildID), so code from any
+// other compiler stops matching without a bump.
+static const char * const CACHE_VERSION = "a_lang fn cache 7";
+
+static const char HEX[] = "0123456789abcdef";
+
+//Find the executable's NT_GNU_BUILD_ID note, which the linker
+// makes by hashing its output
+static int findBuildID(dl_phdr_info * info, size_t, void * data){
+	std::string& id = *static_cast<std::string *>(data);
+	for (size_t i = 0; i < info->dlpi_phnum; i++){
+		const ElfW(Phdr)& seg = info->dlpi_phdr[i];
+		if (seg.p_type != PT_NOTE){ continue; }
+		const char * at = reinterpret_cast<const char *>(
+			info->dlpi_addr + seg.p_vaddr);
+		const char * end = at + seg.p_memsz;
+		while (at + sizeof(ElfW(Nhdr)) <= end){
+			const ElfW(Nhdr) * note
+				= reinterpret_cast<const ElfW(Nhdr) *>(at);
+			const char * name = at + sizeof(ElfW(Nhdr));
+			const char * desc = name + ((note->n_namesz + 3) & ~3u);
+			if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4
+			  && memcmp(name, "GNU", 4) == 0){
+				for (size_t b = 0; b < note->n_descsz; b++){
+					unsigned char byte = static_cast<unsigned char>(desc[b]);
+					id += HEX[byte >> 4];
+					id += HEX[byte & 0xf];
+				}
+				return 1;
+			}
+			at = desc + ((note->n_descsz + 3) & ~3u);
+		}
+	}
+	//The executable is listed first, and it's the only one wanted
+	return 1;
+}
+
+const std::string& FnCache::buildID(){
+	static const std::string id = [](){
+		std::string res;
+		dl_iterate_phdr(findBuildID, &res);
+		if (!res.empty()){ return res; }
+		//Linked without a build ID: hash the binary itself
+		std::ifstream exe("/proc/self/exe", std::ios::binary);
+		std::ostringstream bytes;
+		bytes << exe.rdbuf();
+		char name[32];
+		snprintf(name, sizeof(name), "exe-%016llx",
+			static_cast<unsigned long long>(hash(bytes.str())));
+		return std::string(name);
+	}();
+	return id;
+}
+
+FnCache::FnCache(const std::string& dirIn) : dir(dirIn), memoBytes(0){
+	//Fine if it already exists; a bad directory just means
+	// every store fails and every lookup misses
+	mkdir(dir.c_str(), 0777);
+}
+
+uint64_t FnCache::hash(const std::string& key){
+	//FNV-1a
+	uint64_t h = 14695981039346656037ull;
+	for (char c : key){
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+std::string FnCache::path(const std::string& key) const{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.fn",
+		static_cast<unsigned long long>(hash(key)));
+	return dir + "/" + name;
+}
+
+static bool readSized(std::istream& in, const char * tag,
+  std::string& out){
+	std::string word;
+	size_t len;
+	if (!(in >> word >> len) || word != tag || in.get() != '\n'){
+		return false;
+	}
+	out.resize(len);
+	if (len > 0){ in.read(&out[0], static_cast<std::streamsize>(len)); }
+	return static_cast<size_t>(in.gcount()) == len || len == 0;
+}
+
+static bool readPair(std::istream& in, const char * tag,
+  size_t& first, size_t& second){
+	std::string word;
+	return (in >> word >> first >> second) && word == tag;
+}
+
+void FnCache::remember(const std::string& key, const Entry& entry) const{
+	size_t bytes = key.size() + entry.text.size();
+	if (memoBytes + bytes > MEMO_LIMIT){
+		memo.clear();
+		memoBytes = 0;
+	}
+	if (memo.insert(std::make_pair(key, entry)).second){
+		memoBytes += bytes;
+	}
+}
+
+bool FnCache::lookup(const std::string& key, Entry& entry) const{
+	auto found = memo.find(key);
+	if (found != memo.end()){
+		entry = found->second;
+		return true;
+	}
+	if (!readEntry(key, entry)){ return false; }
+	remember(key, entry);
+	return true;
+}
+
+bool FnCache::readEntry(const std::string& key, Entry& entry) const{
+	std::ifstream in(path(key), std::ios::binary);
+	if (!in.good()){ return false; }
+
+	std::string version;
+	if (!std::getline(in, version) || version != CACHE_VERSION){
+		return false;
+	}
+	std::string build;
+	if (!std::getline(in, build) || build != "build " + buildID()){
+		return false;
+	}
+	std::string stored;
+	if (!readSized(in, "key", stored) || stored != key){
+		return false;
+	}
+	if (!readPair(in, "labels", entry.labelBase, entry.numLabels)){
+		return false;
+	}
+	if (!readPair(in, "strings", entry.strBase, entry.numStrings)){
+		return false;
+	}
+	in >> std::ws;
+	return readSized(in, "asm", entry.text);
+}
+
+void FnCache::store(const std::string& key, const Entry& entry) const{
+	remember(key, entry);
+	std::string dest = path(key);
+	//Write to a private file and rename it into place, so a
+	// concurrent build never reads half an entry
+	std::string tmp = dest + ".tmp" + std::to_string(getpid());
+	std::ofstream out(tmp, std::ios::binary);
+	if (!out.good()){ return; }
+	out << CACHE_VERSION << "\n"
+		<< "build " << buildID() << "\n"
+		<< "key " << key.size() << "\n" << key << "\n"
+		<< "labels " << entry.labelBase << " " << entry.numLabels << "\n"
+		<< "strings " << entry.strBase << " " << entry.numStrings << "\n"
+		<< "asm " << entry.text.size() << "\n" << entry.text;
+	out.close();
+	if (!out.good() || rename(tmp.c_str(), dest.c_str()) != 0){
+		std::remove(tmp.c_str());
+	}
+}
+
+bool FnCache::cacheable(const char * src, size_t len){
+	std::string text(src, len);
+	return text.find("lbl_") == std::string::npos
+		&& text.find("str_") == std::string::npos;
+}
+
+static bool isIdentChar(char c){
+	return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+//Shift the lbl_N and str_N names in text, leaving quoted
+// strings alone
+static std::string shiftNames(const std::string& text,
+  long long labelShift, long long strShift){
+	std::string res;
+	res.reserve(text.size());
+	bool quoted = false;
+	size_t i = 0;
+	while (i < text.size()){
+		char c = text[i];
+		if (c == '"' && (i == 0 || text[i - 1] != '\\')){
+			quoted = !quoted;
+		}
+
+		bool isLabel = text.compare(i, 4, "lbl_") == 0;
+		bool isString = text.compare(i, 4, "str_") == 0;
+		if (quoted || !(isLabel || isString)
+		  || (i > 0 && isIdentChar(text[i - 1]))
+		  || i + 4 >= text.size()
+		  || !isdigit(static_cast<unsigned char>(text[i + 4]))){
+			res += c;
+			i++;
+			continue;
+		}
+
+		size_t end = i + 4;
+		long long num = 0;
+		while (end < text.size()
+		  && isdigit(static_cast<unsigned char>(text[end]))){
+			num = num * 10 + (text[end] - '0');
+			end++;
+		}
+		num += isLabel ? labelShift : strShift;
+		res.append(text, i, 4);
+		res += std::to_string(num);
+		i = end;
+	}
+	return res;
+}
+
+std::string FnCache::renumber(const Entry& entry,
+  size_t labelBase, size_t strBase){
+	const std::string& text = entry.text;
+	if (labelBase == entry.labelBase && strBase == entry.strBase){
+		return text;
+	}
+	long long labelShift = static_cast<long long>(labelBase)
+		- static_cast<long long>(entry.labelBase);
+	long long strShift = static_cast<long long>(strBase)
+		- static_cast<long long>(entry.strBase);
+
+	std::string res;
+	res.reserve(text.size());
+	size_t lineStart = 0;
+	while (lineStart < text.size()){
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos){ lineEnd = text.size(); }
+		std::string line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+
+		//A quad's comment pads its labels out to a fixed width
+		// (see Quad::toString), which has to be redone when the
+		// labels change length
+		size_t hash = line.find('#');
+		bool quadComment = hash != std::string::npos
+			&& line.find('"') == std::string::npos
+			&& hash + 1 < line.size() && line[hash + 1] != ' ';
+		size_t colon = std::string::npos;
+		if (quadComment){ colon = line.find(": ", hash); }
+		if (colon == std::string::npos){
+			res += shiftNames(line, labelShift, strShift);
+		} else {
+			res += shiftNames(line.substr(0, hash + 1),
+				labelShift, strShift);
+			std::string labels = shiftNames(
+				line.substr(hash + 1, colon - hash - 1),
+				labelShift, strShift);
+			size_t body = line.find_first_not_of(' ', colon + 1);
+			if (body == std::string::npos){ body = line.size(); }
+			res += labels;
+			res += ": ";
+			for (size_t w = labels.size() + 2; w < Quad::LABEL_SPACE; w++){
+				res += ' ';
+			}
+			res += shiftNames(line.substr(body), labelShift, strShift);
+		}
+		if (lineEnd < text.size()){ res += '\n'; }
+	}
+	return res;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef A_LANG_FN_CACHE_HPP
+#define A_LANG_FN_CACHE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace a_lang{
+
+//On-disk cache of the assembly emitted for each function, used
+// by the streaming compiler. An entry is found by a hash of its
+// key (the function's source text plus whatever it can see
+// outside itself), and only used if the stored key matches
+// exactly, so a hash collision is just a miss.
+class FnCache{
+public:
+	struct Entry{
+		//The label and string numbers the function was given
+		// when the entry was made
+		size_t labelBase;
+		size_t numLabels;
+		size_t strBase;
+		size_t numStrings;
+		std::string text;
+	};
+
+	//Entries live in dir, which is created if need be
+	FnCache(const std::string& dirIn);
+
+	const std::string& getDir() const { return dir; }
+
+	bool lookup(const std::string& key, Entry& entry) const;
+	void store(const std::string& key, const Entry& entry) const;
+
+	//Labels and strings are numbered across the whole program,
+	// so cached text is renumbered to where the function now
+	// sits. Only names the compiler made up are touched: a
+	// function whose source mentions lbl_ or str_ isn't cached.
+	static std::string renumber(const Entry& entry,
+	  size_t labelBase, size_t strBase);
+	static bool cacheable(const char * src, size_t len);
+private:
+	std::string path(const std::string& key) const;
+	static uint64_t hash(const std::string& key);
+	//Names the ac binary, which entries must match
+	static const std::string& buildID();
+	bool readEntry(const std::string& key, Entry& entry) const;
+	void remember(const std::string& key, const Entry& entry) const;
+
+	std::string dir;
+	//Entries already read or written by this process, so a
+	// compile server doesn't go back to disk for them. Dropped
+	// wholesale once it holds more than MEMO_LIMIT bytes.
+	static const size_t MEMO_LIMIT = 64 << 20;
+	mutable std::unordered_map<std::string, Entry> memo;
+	mutable size_t memoBytes;
+};
+
+}
+
+#endif
@@ -0,0 +1,636 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ir_binary.hpp"
+
+namespace a_lang{
+
+static const char IR_MAGIC[] = "ALIR";
+static const size_t IR_VERSION = 1;
+
+enum TypeTag{
+	TYPE_BASIC, TYPE_IMMUTABLE, TYPE_FN
+};
+
+//The program's randBool symbol isn't a global, so it gets its
+// own kind and stands for the loading program's one
+enum SymTag{
+	SYM_VAR, SYM_FN, SYM_RAND
+};
+
+IRWriter::IRWriter(IRProgram * progIn)
+: prog(progIn), numTypes(0), numSyms(0), numProgOpds(0){
+	strRef("");
+}
+
+void IRWriter::numTo(std::string& buf, size_t val){
+	while (val >= 0x80){
+		buf += static_cast<char>((val & 0x7f) | 0x80);
+		val >>= 7;
+	}
+	buf += static_cast<char>(val);
+}
+
+void IRWriter::num(size_t val){
+	numTo(body, val);
+}
+
+void IRWriter::kind(QuadKind kind){
+	num(static_cast<size_t>(kind));
+}
+
+size_t IRWriter::strRef(const std::string& val){
+	auto found = strIdx.find(val);
+	if (found != strIdx.end()){ return found->second; }
+	size_t idx = strOrder.size();
+	auto added = strIdx.insert(std::make_pair(val, idx)).first;
+	strOrder.push_back(&added->first);
+	return idx;
+}
+
+size_t IRWriter::typeRef(const DataType * type){
+	auto found = typeIdx.find(type);
+	if (found != typeIdx.end()){ return found->second; }
+
+	//Parts are numbered before the type made from them
+	std::string entry;
+	if (const BasicType * basic = dynamic_cast<const BasicType *>(type)){
+		numTo(entry, TYPE_BASIC);
+		numTo(entry, static_cast<size_t>(basic->getBaseType()));
+	} else if (const ImmutableType * imm
+	  = dynamic_cast<const ImmutableType *>(type)){
+		size_t sub = typeRef(imm->getSubType());
+		numTo(entry, TYPE_IMMUTABLE);
+		numTo(entry, sub);
+	} else if (const FnType * fn = dynamic_cast<const FnType *>(type)){
+		std::vector<size_t> parts;
+		for (const DataType * formal : *fn->getFormalTypes()->getTypes()){
+			parts.push_back(typeRef(formal));
+		}
+		size_t ret = typeRef(fn->getReturnType());
+		numTo(entry, TYPE_FN);
+		numTo(entry, parts.size());
+		for (size_t part : parts){ numTo(entry, part); }
+		numTo(entry, ret);
+	} else {
+		std::string msg = "No binary IR form for type " + type->getString();
+		throw new InternalError(msg.c_str());
+	}
+	types += entry;
+	typeIdx[type] = numTypes;
+	return numTypes++;
+}
+
+size_t IRWriter::symRef(const SemSymbol * sym){
+	auto found = symIdx.find(sym);
+	if (found != symIdx.end()){ return found->second; }
+
+	size_t tag = SYM_VAR;
+	if (sym == prog->getRandSym()){ tag = SYM_RAND; }
+	else if (sym->getKind() == FN){ tag = SYM_FN; }
+	size_t name = strRef(sym->getName());
+	size_t typeNum = typeRef(sym->getDataType());
+	numTo(syms, tag);
+	numTo(syms, name);
+	numTo(syms, typeNum);
+	symIdx[sym] = numSyms;
+	return numSyms++;
+}
+
+void IRWriter::type(const DataType * type){
+	num(typeRef(type));
+}
+
+void IRWriter::sym(const SemSymbol * sym){
+	num(symRef(sym));
+}
+
+void IRWriter::opd(Opd * opd){
+	auto found = opdIdx.find(opd);
+	if (found == opdIdx.end()){
+		throw new InternalError("Operand not owned by its procedure");
+	}
+	num(found->second);
+}
+
+void IRWriter::label(Label * label){
+	auto found = labelIdx.find(label);
+	if (found == labelIdx.end()){
+		throw new InternalError("Label not owned by its procedure");
+	}
+	num(found->second);
+}
+
+void IRWriter::write(std::ostream& out){
+	num(prog->globalOrder.size());
+	for (SymOpd * global : prog->globalOrder){
+		sym(global->getSym());
+		opdIdx[global] = numProgOpds++;
+	}
+	num(prog->strings.size());
+	for (auto entry : prog->strings){
+		num(strRef(entry.first->valString()));
+		num(strRef(entry.second));
+		opdIdx[entry.first] = numProgOpds++;
+	}
+	num(prog->max_label);
+	num(prog->str_idx);
+
+	num(prog->procs->size() + 1);
+	writeProc(prog->init);
+	for (Procedure * proc : *prog->procs){
+		writeProc(proc);
+	}
+
+	std::string head(IR_MAGIC);
+	numTo(head, IR_VERSION);
+	numTo(head, strOrder.size());
+	for (const std::string * val : strOrder){
+		numTo(head, val->size());
+		head += *val;
+	}
+	numTo(head, numTypes);
+	head += types;
+	numTo(head, numSyms);
+	head += syms;
+	out.write(head.data(), static_cast<std::streamsize>(head.size()));
+	out.write(body.data(), static_cast<std::streamsize>(body.size()));
+}
+
+void IRWriter::writeProc(Procedure * proc){
+	//Everything numbered in the last procedure is forgotten
+	for (auto itr = opdIdx.begin(); itr != opdIdx.end(); ){
+		if (itr->second >= numProgOpds){ itr = opdIdx.erase(itr); }
+		else { ++itr; }
+	}
+	labelIdx.clear();
+
+	//The first two labels are the enter and leave labels,
+	// which the procedure makes for itself
+	const std::string& leaveName = proc->leaveLabel->getName();
+	if (proc->labels.size() < 2 || proc->labels[1] != proc->leaveLabel
+	  || leaveName.compare(0, 4, "lbl_") != 0){
+		throw new InternalError("Unexpected procedure labels");
+	}
+	num(strRef(proc->myName));
+	num(strtoul(leaveName.c_str() + 4, nullptr, 10));
+	num(proc->labels.size() - 2);
+	for (size_t i = 0; i < proc->labels.size(); i++){
+		if (i >= 2){ num(strRef(proc->labels[i]->getName())); }
+		labelIdx[proc->labels[i]] = i;
+	}
+
+	size_t next = numProgOpds;
+	num(proc->formals.size());
+	for (SymOpd * formal : proc->formals){
+		sym(formal->getSym());
+		opdIdx[formal] = next++;
+	}
+	num(proc->locals.size());
+	for (SymOpd * local : proc->locals){
+		sym(local->getSym());
+		opdIdx[local] = next++;
+	}
+	num(proc->temps.size());
+	for (AuxOpd * tmp : proc->temps){
+		num(strRef(tmp->getName()));
+		num(tmp->getWidth());
+		opdIdx[tmp] = next++;
+	}
+	num(proc->addrOpds.size());
+	for (AddrOpd * addr : proc->addrOpds){
+		num(strRef(addr->getName()));
+		num(addr->getWidth());
+		opdIdx[addr] = next++;
+	}
+	num(proc->lits.size());
+	for (LitOpd * lit : proc->lits){
+		num(strRef(lit->valString()));
+		num(lit->getWidth());
+		opdIdx[lit] = next++;
+	}
+	num(proc->maxTmp);
+
+	num(proc->bodyQuads->size());
+	for (Quad * quad : *proc->bodyQuads){
+		quad->writeIR(*this);
+		num(quad->getLabels().size());
+		for (Label * lbl : quad->getLabels()){ label(lbl); }
+		num(strRef(quad->getComment()));
+	}
+}
+
+void BinOpQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_BINOP);
+	out.opd(dst);
+	out.num(static_cast<size_t>(opr));
+	out.opd(src1);
+	out.opd(src2);
+}
+
+void UnaryOpQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_UNARYOP);
+	out.opd(dst);
+	out.num(static_cast<size_t>(op));
+	out.opd(src);
+}
+
+void AssignQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_ASSIGN);
+	out.opd(dst);
+	out.opd(src);
+}
+
+void LocQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_LOC);
+	out.opd(src);
+	out.opd(tgt);
+	out.num(srcIsLoc ? 1 : 0);
+	out.num(tgtIsLoc ? 1 : 0);
+}
+
+void GotoQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_GOTO);
+	out.label(tgt);
+}
+
+void IfzQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_IFZ);
+	out.opd(cnd);
+	out.label(tgt);
+}
+
+void IfnzQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_IFNZ);
+	out.opd(cnd);
+	out.label(tgt);
+}
+
+void CountQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_COUNT);
+	out.num(counter);
+}
+
+void NopQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_NOP);
+}
+
+void WriteQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_WRITE);
+	out.opd(mySrc);
+	out.type(mySrcType);
+}
+
+void ReadQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_READ);
+	out.opd(myDst);
+	out.type(myDstType);
+}
+
+void CallQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_CALL);
+	out.sym(sym);
+}
+
+void EnterQuad::writeIR(IRWriter& out){
+	throw new InternalError("enter is written with its procedure");
+}
+
+void LeaveQuad::writeIR(IRWriter& out){
+	throw new InternalError("leave is written with its procedure");
+}
+
+void SetArgQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_SETARG);
+	out.num(index);
+	out.opd(opd);
+	out.type(type);
+}
+
+void GetArgQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_GETARG);
+	out.num(index);
+	out.opd(opd);
+}
+
+void SetRetQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_SETRET);
+	out.opd(opd);
+}
+
+void GetRetQuad::writeIR(IRWriter& out){
+	out.kind(QUAD_GETRET);
+	out.opd(opd);
+}
+
+IRReader::IRReader(const char * path)
+: myPath(path), myMapped(nullptr), myLen(0), myPos(0),
+  prog(nullptr), numProgOpds(0){
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		std::string msg = "Bad input stream ";
+		msg += path;
+		throw new InternalError(msg.c_str());
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		std::string msg = "Cannot stat ";
+		msg += path;
+		throw new InternalError(msg.c_str());
+	}
+	size_t len = static_cast<size_t>(info.st_size);
+	if (len > 0){
+		void * map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED){
+			close(fd);
+			std::string msg = "Cannot map ";
+			msg += path;
+			throw new InternalError(msg.c_str());
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+		myMapped = static_cast<const char *>(map);
+		myLen = len;
+	}
+	close(fd);
+}
+
+IRReader::~IRReader(){
+	if (myMapped != nullptr){
+		munmap(const_cast<char *>(myMapped), myLen);
+	}
+}
+
+void IRReader::bad(const char * what){
+	std::string msg = "Bad IR file " + myPath + ": " + what;
+	throw new InternalError(msg.c_str());
+}
+
+uint8_t IRReader::byte(){
+	if (myPos >= myLen){ bad("truncated"); }
+	return static_cast<uint8_t>(myMapped[myPos++]);
+}
+
+size_t IRReader::num(){
+	size_t val = 0;
+	unsigned shift = 0;
+	while (true){
+		uint8_t b = byte();
+		if (shift >= 64){ bad("number too long"); }
+		val |= static_cast<size_t>(b & 0x7f) << shift;
+		if ((b & 0x80) == 0){ return val; }
+		shift += 7;
+	}
+}
+
+size_t IRReader::index(size_t limit){
+	size_t idx = num();
+	if (idx >= limit){ bad("index out of range"); }
+	return idx;
+}
+
+std::string IRReader::str(){
+	const std::pair<size_t, size_t>& entry = strs[index(strs.size())];
+	return std::string(myMapped + entry.first, entry.second);
+}
+
+const DataType * IRReader::type(){
+	return types[index(types.size())];
+}
+
+SemSymbol * IRReader::sym(){
+	return syms[index(syms.size())];
+}
+
+Opd * IRReader::opd(){
+	return opds[index(opds.size())];
+}
+
+Label * IRReader::label(){
+	return labels[index(labels.size())];
+}
+
+IRProgram * IRReader::load(){
+	size_t magicLen = sizeof(IR_MAGIC) - 1;
+	if (myLen < magicLen
+	  || std::string(myMapped, magicLen) != IR_MAGIC){
+		bad("not binary IR");
+	}
+	myPos = magicLen;
+	if (num() != IR_VERSION){ bad("unknown version"); }
+
+	size_t numStrs = num();
+	for (size_t i = 0; i < numStrs; i++){
+		size_t len = num();
+		if (len > myLen - myPos){ bad("truncated"); }
+		strs.push_back(std::make_pair(myPos, len));
+		myPos += len;
+	}
+
+	size_t numTypes = num();
+	for (size_t i = 0; i < numTypes; i++){
+		size_t tag = num();
+		if (tag == TYPE_BASIC){
+			size_t base = num();
+			if (base > static_cast<size_t>(BaseType::BOOL)){ bad("no such base type"); }
+			types.push_back(BasicType::produce(static_cast<BaseType>(base)));
+		} else if (tag == TYPE_IMMUTABLE){
+			types.push_back(ImmutableType::produce(type()));
+		} else if (tag == TYPE_FN){
+			std::list<const DataType *> formals;
+			size_t numFormals = num();
+			for (size_t f = 0; f < numFormals; f++){
+				formals.push_back(type());
+			}
+			const DataType * ret = type();
+			types.push_back(FnType::produce(TypeList::produce(formals), ret));
+		} else {
+			bad("no such type");
+		}
+	}
+
+	prog = new IRProgram(nullptr);
+	size_t numSyms = num();
+	for (size_t i = 0; i < numSyms; i++){
+		size_t tag = num();
+		std::string name = str();
+		const DataType * symType = type();
+		if (tag == SYM_RAND){
+			syms.push_back(prog->getRandSym());
+		} else if (tag == SYM_FN){
+			const FnType * fnType = symType->asFn();
+			if (fnType == nullptr){ bad("function without a function type"); }
+			syms.push_back(prog->keepSym(new FnSymbol(name, fnType)));
+		} else if (tag == SYM_VAR){
+			syms.push_back(prog->keepSym(new VarSymbol(name, symType)));
+		} else {
+			bad("no such symbol kind");
+		}
+	}
+
+	size_t numGlobals = num();
+	for (size_t i = 0; i < numGlobals; i++){
+		SemSymbol * global = sym();
+		prog->gatherGlobal(global);
+		opds.push_back(prog->getGlobal(global));
+	}
+	size_t numStrings = num();
+	for (size_t i = 0; i < numStrings; i++){
+		LitOpd * lit = new LitOpd(str(), 8);
+		prog->strings.emplace_back(lit, str());
+		opds.push_back(lit);
+	}
+	size_t labelsMade = num();
+	size_t stringsMade = num();
+	numProgOpds = opds.size();
+
+	size_t numProcs = num();
+	if (numProcs == 0){ bad("no <init> procedure"); }
+	for (size_t i = 0; i < numProcs; i++){
+		readProc(i == 0);
+	}
+	prog->max_label = labelsMade;
+	prog->str_idx = stringsMade;
+	if (myPos != myLen){ bad("trailing data"); }
+	return prog;
+}
+
+void IRReader::readProc(bool isInit){
+	std::string name = str();
+	size_t leaveNum = num();
+
+	//The procedure makes its own enter and leave labels; the
+	// leave label gets the number it had by making it next
+	Procedure * proc;
+	if (isInit){
+		proc = prog->init;
+	} else {
+		prog->max_label = leaveNum;
+		proc = prog->makeProc(name);
+	}
+	if (proc->leaveLabel->getName() != "lbl_" + std::to_string(leaveNum)){
+		bad("procedure labels out of order");
+	}
+	size_t numLabels = num();
+	for (size_t i = 0; i < numLabels; i++){
+		proc->labels.push_back(new Label(str()));
+	}
+	labels = proc->labels;
+
+	opds.resize(numProgOpds);
+	size_t numFormals = num();
+	for (size_t i = 0; i < numFormals; i++){
+		proc->gatherFormal(sym());
+		opds.push_back(proc->formals.back());
+	}
+	size_t numLocals = num();
+	for (size_t i = 0; i < numLocals; i++){
+		proc->gatherLocal(sym());
+		opds.push_back(proc->locals.back());
+	}
+	size_t numTemps = num();
+	for (size_t i = 0; i < numTemps; i++){
+		std::string tmpName = str();
+		AuxOpd * tmp = new AuxOpd(tmpName, num());
+		proc->temps.push_back(tmp);
+		opds.push_back(tmp);
+	}
+	size_t numAddrs = num();
+	for (size_t i = 0; i < numAddrs; i++){
+		std::string addrName = str();
+		AddrOpd * addr = new AddrOpd(addrName, num());
+		proc->addrOpds.push_back(addr);
+		opds.push_back(addr);
+	}
+	size_t numLits = num();
+	for (size_t i = 0; i < numLits; i++){
+		std::string val = str();
+		opds.push_back(proc->keepLit(new LitOpd(val, num())));
+	}
+	proc->maxTmp = num();
+
+	size_t numQuads = num();
+	for (size_t i = 0; i < numQuads; i++){
+		Quad * quad = readQuad();
+		size_t numQuadLabels = num();
+		for (size_t l = 0; l < numQuadLabels; l++){
+			quad->addLabel(label());
+		}
+		quad->setComment(str());
+		proc->addQuad(quad);
+	}
+}
+
+Quad * IRReader::readQuad(){
+	size_t kind = num();
+	switch (kind){
+	case QUAD_BINOP: {
+		Opd * dst = opd();
+		size_t op = num();
+		if (op > static_cast<size_t>(AND8)){ bad("no such operator"); }
+		Opd * src1 = opd();
+		Opd * src2 = opd();
+		return new BinOpQuad(dst, static_cast<BinOp>(op), src1, src2);
+	}
+	case QUAD_UNARYOP: {
+		Opd * dst = opd();
+		size_t op = num();
+		if (op > static_cast<size_t>(NOT8)){ bad("no such operator"); }
+		return new UnaryOpQuad(dst, static_cast<UnaryOp>(op), opd());
+	}
+	case QUAD_ASSIGN: {
+		Opd * dst = opd();
+		return new AssignQuad(dst, opd());
+	}
+	case QUAD_LOC: {
+		Opd * src = opd();
+		Opd * tgt = opd();
+		bool srcIsLoc = num() != 0;
+		bool tgtIsLoc = num() != 0;
+		return new LocQuad(src, tgt, srcIsLoc, tgtIsLoc);
+	}
+	case QUAD_GOTO:
+		return new GotoQuad(label());
+	case QUAD_IFZ: {
+		Opd * cnd = opd();
+		return new IfzQuad(cnd, label());
+	}
+	case QUAD_NOP:
+		return new NopQuad();
+	case QUAD_WRITE: {
+		Opd * src = opd();
+		return new WriteQuad(src, type());
+	}
+	case QUAD_READ: {
+		Opd * dst = opd();
+		return new ReadQuad(dst, type());
+	}
+	case QUAD_CALL:
+		return new CallQuad(sym());
+	case QUAD_SETARG: {
+		size_t idx = num();
+		Opd * src = opd();
+		return new SetArgQuad(idx, src, type());
+	}
+	case QUAD_GETARG: {
+		size_t idx = num();
+		return new GetArgQuad(idx, opd());
+	}
+	case QUAD_SETRET:
+		return new SetRetQuad(opd());
+	case QUAD_GETRET:
+		return new GetRetQuad(opd());
+	case QUAD_IFNZ: {
+		Opd * cnd = opd();
+		return new IfnzQuad(cnd, label());
+	}
+	case QUAD_COUNT:
+		return new CountQuad(num());
+	}
+	bad("no such quad");
+	return nullptr;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef A_LANG_IR_BINARY_HPP
+#define A_LANG_IR_BINARY_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//A compact binary form of an IRProgram, so code generation
+// can be run again later without the front end. All numbers
+// are LEB128 varints, and names, literals and comments are
+// kept once each in a string table. The file is, in order:
+//  - the magic "ALIR" and a format version
+//  - the string table, then the types and the symbols, each
+//    entry referring only to entries before it
+//  - the globals and string literals
+//  - the label and string counters
+//  - the procedures, <init> first. Each lists its labels
+//    and operands, then its body quads, which refer to them
+//    by index.
+enum QuadKind{
+	QUAD_BINOP, QUAD_UNARYOP, QUAD_ASSIGN, QUAD_LOC, QUAD_GOTO,
+	QUAD_IFZ, QUAD_NOP, QUAD_WRITE, QUAD_READ, QUAD_CALL,
+	QUAD_SETARG, QUAD_GETARG, QUAD_SETRET, QUAD_GETRET,
+	QUAD_IFNZ, QUAD_COUNT
+};
+
+class IRWriter{
+public:
+	IRWriter(IRProgram * progIn);
+	void write(std::ostream& out);
+
+	//Fields of a quad, for Quad::writeIR
+	void kind(QuadKind kind);
+	void num(size_t val);
+	void opd(Opd * opd);
+	void label(Label * label);
+	void type(const DataType * type);
+	void sym(const SemSymbol * sym);
+private:
+	void writeProc(Procedure * proc);
+	size_t strRef(const std::string& val);
+	size_t typeRef(const DataType * type);
+	size_t symRef(const SemSymbol * sym);
+	static void numTo(std::string& buf, size_t val);
+
+	IRProgram * prog;
+	//The tables are only complete once every procedure has
+	// been written, so the rest goes to body and the tables
+	// are put in front of it at the end
+	std::string body;
+	std::string types;
+	std::string syms;
+	std::map<std::string, size_t> strIdx;
+	std::vector<const std::string *> strOrder;
+	std::map<const DataType *, size_t> typeIdx;
+	size_t numTypes;
+	std::map<const SemSymbol *, size_t> symIdx;
+	size_t numSyms;
+	//Operands and labels of the program, then of the
+	// procedure being written
+	std::map<Opd *, size_t> opdIdx;
+	size_t numProgOpds;
+	std::map<Label *, size_t> labelIdx;
+};
+
+//Rebuilds an IRProgram from a file in the binary format. The
+// file is mapped into memory and decoded in place.
+class IRReader{
+public:
+	IRReader(const char * path);
+	~IRReader();
+	IRReader(const IRReader&) = delete;
+	IRReader& operator=(const IRReader&) = delete;
+
+	IRProgram * load();
+private:
+	void readProc(bool isInit);
+	Quad * readQuad();
+	uint8_t byte();
+	size_t num();
+	size_t index(size_t limit);
+	std::string str();
+	const DataType * type();
+	SemSymbol * sym();
+	Opd * opd();
+	Label * label();
+	void bad(const char * what);
+
+	std::string myPath;
+	const char * myMapped;
+	size_t myLen;
+	size_t myPos;
+
+	IRProgram * prog;
+	std::vector<std::pair<size_t, size_t>> strs;
+	std::vector<const DataType *> types;
+	std::vector<SemSymbol *> syms;
+	std::vector<Opd *> opds;
+	size_t numProgOpds;
+	std::vector<Label *> labels;
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include <unordered_set>
+#include "ir_verifier.hpp"
+
+namespace a_lang{
+
+static void fail(Procedure * proc, const char * after, const char * what){
+	std::string msg = "Bad IR in " + proc->getName() + " after pass ";
+	msg += after;
+	msg += ": ";
+	msg += what;
+	throw new InternalError(msg.c_str());
+}
+
+void IRVerifier::check(Procedure * proc, const char * after){
+	QuadList * quads = proc->getQuads();
+	std::unordered_set<Label *> placed;
+	for (Label * label : proc->getLeave()->getLabels()){
+		placed.insert(label);
+	}
+
+	size_t count = 0;
+	std::vector<Opd *> srcs;
+	for (auto it = quads->begin(); it != quads->end(); ++it){
+		Quad * quad = *it;
+		count++;
+		if (quad == nullptr){ fail(proc, after, "empty slot in the body"); }
+		//A quad in two slots has the handle of one at most
+		if (quad->getHandle() != it.handle()){
+			fail(proc, after, "quad's handle is not its slot");
+		}
+		for (Label * label : quad->getLabels()){
+			if (!placed.insert(label).second){
+				fail(proc, after, "label placed twice");
+			}
+		}
+
+		srcs.clear();
+		quad->uses(srcs);
+		for (Opd * src : srcs){
+			if (src == nullptr){ fail(proc, after, "quad reads nothing"); }
+		}
+		if (dynamic_cast<LitOpd *>(quad->def()) != nullptr){
+			fail(proc, after, "quad writes a literal");
+		}
+	}
+	if (count != quads->size()){
+		fail(proc, after, "body's size is off");
+	}
+
+	for (Quad * quad : *quads){
+		Label * target = quad->branchTarget();
+		if (target != nullptr && placed.count(target) == 0){
+			fail(proc, after, "branch to a label that isn't placed");
+		}
+	}
+}
+
+}
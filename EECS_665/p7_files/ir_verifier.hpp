@@ -0,0 +1,19 @@
+#ifndef A_LANG_IR_VERIFIER_HPP
+#define A_LANG_IR_VERIFIER_HPP
+
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//Checks that a procedure's 3AC still hangs together, so a pass
+// that breaks it is named right away instead of showing up as
+// wrong code later
+class IRVerifier{
+public:
+	//Throws an InternalError naming the pass that ran last
+	static void check(Procedure * proc, const char * after);
+};
+
+}
+
+#endif
@@ -1,15 +1,63 @@
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <memory>
 #include <string.h>
+#include <thread>
+#include <unistd.h>
 #include "errors.hpp"
 #include "scanner.hpp"
+#include "fast_scanner.hpp"
+#include "pipelined_scanner.hpp"
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "stream_compiler.hpp"
+#include "fn_cache.hpp"
+#include "ir_binary.hpp"
+#include "compile_server.hpp"
+#include "pass_timer.hpp"
+#include "code_stats.hpp"
+#include "pass_manager.hpp"
+#include "block_profile.hpp"
 
 using namespace std;
 using namespace a_lang;
 
+//Use the hand-written mmap/SIMD scanner instead of flex
+static bool useFastLexer = false;
+//Lex in parallel, line-aligned chunks on this many threads
+static size_t lexJobs = 1;
+//Lex on a separate thread, overlapped with parsing
+static bool pipelineLexer = false;
+//Analyse function bodies on this many threads
+static size_t semaJobs = 1;
+//Compile -o output one declaration at a time
+static bool streamCompile = false;
+//Directory of per-function code kept between streaming compiles
+static const char * cacheDir = nullptr;
+//The input is binary IR written by -emit-ir, not source
+static bool loadIR = false;
+//Report where the compile's time and memory went
+static bool timePasses = false;
+//...or write the same report as JSON here ("--" for stdout)
+static const char * timePassesJSON = nullptr;
+//Which optimization passes run on the 3AC (-O and friends)
+static std::unique_ptr<PassManager> passes;
+//Count how often each block runs, for -fprofile-use
+static bool profileGenerate = false;
+//Block counts from a -fprofile-generate build's run, if any
+static std::unique_ptr<BlockProfile> profile;
+//Time each function's calls, for a flat profile at exit
+static bool profileCycles = false;
+
+//Thrown by usageAndDie, so a bad request to the compile server
+// fails that request instead of the server
+struct UsageError{ };
+
 static void usageAndDie(){
 	std::cerr << "Usage: ac <infile> <options>\n"
+	<< "       ac -serve <socket>: Compile requests sent to <socket>\n"
+	<< "       ac -connect <socket> <infile> <options>: Have the server on <socket> compile\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
 	<< " [-p]: Parse the input to check syntax\n"
 	<< " [-u <unparseFile>]: Output canonical program text to <unparseFile>\n"
@@ -17,10 +65,74 @@ static void usageAndDie(){
 	<< " [-c]: Do type checking\n"
 	<< " [-a <3ACFile>]: Output program as 3-address code\n"
 	<< " [-o <ASMFile>]: Output x64 assembly to <ASMFile>\n"
+	<< " [-q]: Omit the 3AC comment before each quad's assembly\n"
+	<< " [-fast-lex]: Scan with the hand-written mmap/SIMD lexer\n"
+	<< " [-lex-jobs <N>]: Lex with the fast lexer on N threads (0: one per core)\n"
+	<< " [-pipe-lex]: Run the fast lexer on its own thread, feeding the parser\n"
+	<< " [-sema-jobs <N>]: Analyse function bodies on N threads (0: one per core)\n"
+	<< " [-stream]: Compile -o output one function at a time, in bounded memory\n"
+	<< " [-cache <dir>]: Reuse unchanged functions' code from <dir> (implies -stream)\n"
+	<< " [-emit-ir <IRFile>]: Output the program's 3AC in binary form to <IRFile>\n"
+	<< " [-load-ir]: Read <infile> as binary IR from -emit-ir (for -a, -o and -stats)\n"
+	<< " [-time-passes]: Report each phase's time and memory on stderr\n"
+	<< " [-time-passes-json <file>]: Write the -time-passes report as JSON to <file>\n"
+	<< " [-stats <statsFile>]: Output per-procedure IR and x64 statistics as JSON\n"
+	<< " [-O0|-O1|-O2]: Optimization level (default -O0: no passes)\n"
+	<< " [-enable-pass <pass>]: Run <pass> whatever the level\n"
+	<< " [-disable-pass <pass>]: Don't run <pass>\n"
+	<< " [-verify-ir]: Check the IR after each pass (always on in DEBUG=1 builds)\n"
+	<< " [-fprofile-generate]: Make -o code count its blocks into ac.profile (or $AC_PROFILE)\n"
+	<< " [-fprofile-use <file>]: Lay code out by the counts in <file>\n"
+	<< " [-fprofile-cycles]: Make -o code time its functions and print a profile at exit\n"
 	;
 	std::cout << std::flush;
 	std::cerr << std::flush;
-	exit(1);
+	throw UsageError();
+}
+
+//Every pass reads the same input, so it is lexed once and
+// later passes replay the buffered tokens
+static a_lang::TokenBuffer inputTokens;
+
+//What a compile built, so the compile server can free it
+// before the next one
+static std::vector<a_lang::ProgramNode *> builtASTs;
+static std::vector<a_lang::NameAnalysis *> builtNames;
+static std::vector<a_lang::TypeAnalysis *> builtTypes;
+static std::vector<a_lang::IRProgram *> builtProgs;
+
+static a_lang::Scanner * pickScanner(const char * inPath,
+  std::ifstream * inStream){
+	if (lexJobs > 1){
+		a_lang::FastScanner::lexParallel(inPath, &inputTokens, lexJobs);
+		return new a_lang::Scanner(inStream, &inputTokens);
+	}
+	if (pipelineLexer){
+		return new a_lang::PipelinedScanner(inPath, &inputTokens);
+	}
+	if (useFastLexer){
+		return new a_lang::FastScanner(inPath, &inputTokens);
+	}
+	return new a_lang::Scanner(inStream, &inputTokens);
+}
+
+static a_lang::Scanner * makeScanner(const char * inPath,
+  std::ifstream * inStream){
+	if (inputTokens.complete()){
+		return new a_lang::Scanner(inStream, &inputTokens);
+	}
+	//An earlier pass stopped partway (e.g. on a syntax error)
+	inputTokens.clear();
+	if (!PassTimer::enabled()){ return pickScanner(inPath, inStream); }
+
+	//Timing each token as the parser asks for it would cost
+	// more than the lexing, so when timing the whole input is
+	// lexed up front (and -pipe-lex loses its overlap)
+	PassTimer::Phase phase("scan");
+	a_lang::Scanner * scanner = pickScanner(inPath, inStream);
+	scanner->lexAll();
+	phase.items("tokens", inputTokens.size());
+	return scanner;
 }
 
 static void writeTokenStream(const char * inPath, const char * outPath){
@@ -35,9 +147,10 @@ static void writeTokenStream(const char * inPath, const char * outPath){
 		throw new a_lang::InternalError(msg.c_str());
 	}
 
-	a_lang::Scanner scanner(&inStream);
+	std::unique_ptr<a_lang::Scanner> scanner(
+		makeScanner(inPath, &inStream));
 	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
+		scanner->outputTokens(std::cout);
 	} else {
 		std::ofstream outStream(outPath);
 		if (!outStream.good()){
@@ -45,12 +158,13 @@ static void writeTokenStream(const char * inPath, const char * outPath){
 			msg += outPath;
 			throw new InternalError(msg.c_str());
 		}
-		scanner.outputTokens(outStream);
+		scanner->outputTokens(outStream);
 		outStream.close();
 	}
 }
 
-static a_lang::ProgramNode * parse(const char * inFile){
+static a_lang::ProgramNode * parse(const char * inFile,
+  a_lang::DeclSink * sink = nullptr){
 	std::ifstream inStream(inFile);
 	if (!inStream.good()){
 		std::string msg = "Bad input stream ";
@@ -62,16 +176,21 @@ static a_lang::ProgramNode * parse(const char * inFile){
 	// AST after parsing
 	a_lang::ProgramNode * root = nullptr;
 
-	a_lang::Scanner scanner(&inStream);
-	a_lang::Parser parser(scanner, &root);
+	std::unique_ptr<a_lang::Scanner> scanner(
+		makeScanner(inFile, &inStream));
+	PassTimer::Phase phase("parse");
+	a_lang::Parser parser(*scanner, &root, sink);
 
 	int errCode = parser.parse();
+	phase.items("nodes", ASTNode::numIDs());
 	if (errCode != 0){ return nullptr; }
 
+	if (sink == nullptr){ builtASTs.push_back(root); }
 	return root;
 }
 
 static void outputAST(ASTNode * ast, const char * outPath){
+	PassTimer::Phase phase("unparse");
 	if (strcmp(outPath, "--") == 0){
 		ast->unparse(std::cout, 0);
 	} else {
@@ -89,7 +208,14 @@ static a_lang::NameAnalysis * doNameAnalysis(const char * inputPath){
 	a_lang::ProgramNode * ast = parse(inputPath);
 	if (ast == nullptr){ return nullptr; }
 
-	return a_lang::NameAnalysis::build(ast);
+	//Error positions are resolved to lines from several threads
+	// at once, so build the line table before they start
+	if (semaJobs > 1){ inputTokens.indexLines(); }
+	PassTimer::Phase phase("name analysis");
+	phase.items("nodes", ASTNode::numIDs());
+	a_lang::NameAnalysis * names = a_lang::NameAnalysis::build(ast, semaJobs);
+	if (names != nullptr){ builtNames.push_back(names); }
+	return names;
 }
 
 static bool doUnparsing(const char * inputPath, const char * outPath){
@@ -106,19 +232,31 @@ static bool doUnparsing(const char * inputPath, const char * outPath){
 static a_lang::TypeAnalysis * doTypeAnalysis(const char * inputPath){
 	a_lang::NameAnalysis * nameAnalysis = doNameAnalysis(inputPath);
 	if (nameAnalysis == nullptr){ return nullptr; }
-	return TypeAnalysis::build(nameAnalysis);
+	PassTimer::Phase phase("type analysis");
+	phase.items("nodes", ASTNode::numIDs());
+	TypeAnalysis * types = TypeAnalysis::build(nameAnalysis, semaJobs);
+	if (types != nullptr){ builtTypes.push_back(types); }
+	return types;
 }
 
 static void write3AC(a_lang::IRProgram * prog, const char * outPath){
 	if (outPath == nullptr){
 		throw new InternalError("Null 3AC flat file given");
 	}
-	std::string flatProg = prog->toString();
+	PassTimer::Phase phase("3AC output");
 	if (strcmp(outPath, "--") == 0){
-		std::cout << flatProg << std::endl;
+		BufferedWriter writer(std::cout);
+		prog->write3AC(writer);
+		writer << "\n";
+		writer.flush();
+		phase.items("bytes", writer.written());
 	} else {
 		std::ofstream outStream(outPath);
-		outStream << flatProg << std::endl;
+		BufferedWriter writer(outStream);
+		prog->write3AC(writer);
+		writer << "\n";
+		writer.flush();
+		phase.items("bytes", writer.written());
 		outStream.close();
 	}
 }
@@ -128,31 +266,200 @@ static IRProgram * do3AC(const char * inputPath){
 	a_lang::TypeAnalysis * typeAnalysis = doTypeAnalysis(inputPath);
 	if (typeAnalysis == nullptr){ return nullptr; }
 
+	PassTimer::Phase phase("3AC");
 	IRProgram * prog = typeAnalysis->ast->to3AC(typeAnalysis);
+	phase.items("quads", prog->numQuads());
+	builtProgs.push_back(prog);
 	return prog;
 }
 
-static int writeX64(a_lang::IRProgram * prog, const char * outPath){
+static IRProgram * optimize(IRProgram * prog){
+	if (prog == nullptr){ return nullptr; }
+	//Blocks are counted on the 3AC as lowered, before any pass
+	// changes it, so a profile taken at one -O level fits all
+	if (profileGenerate){
+		PassTimer::Phase phase("profile instrument");
+		BlockProfile::instrument(prog);
+	}
+	if (profile != nullptr){
+		PassTimer::Phase phase("profile layout");
+		profile->apply(prog);
+	}
+	PassTimer::Phase phase("optimize");
+	passes->run(prog);
+	phase.items("quads", prog->numQuads());
+	return prog;
+}
+
+static void writeBinaryIR(a_lang::IRProgram * prog, const char * outPath){
+	std::ofstream outStream(outPath, std::ios::binary);
+	if (!outStream.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	PassTimer::Phase phase("IR output");
+	IRWriter writer(prog);
+	writer.write(outStream);
+	outStream.close();
+}
+
+//The optimized IR of the program, from the front end or, with
+// -load-ir, from a file written by an earlier -emit-ir
+static IRProgram * getIR(const char * inputPath){
+	if (loadIR){
+		IRProgram * prog;
+		{
+			PassTimer::Phase phase("IR load");
+			IRReader reader(inputPath);
+			prog = reader.load();
+			builtProgs.push_back(prog);
+		}
+		return optimize(prog);
+	}
+	return optimize(do3AC(inputPath));
+}
+
+static int writeX64(a_lang::IRProgram * prog, const char * outPath,
+  bool asmComments){
 	if (outPath == nullptr){
 		throw new InternalError("Null codegen file given");
 	}
+	PassTimer::Phase phase("x64");
 	if (strcmp(outPath, "--") == 0){
-		prog->toX64(std::cout);
+		X64Emitter emitter(std::cout);
+		emitter.setComments(asmComments);
+		prog->toX64(emitter);
+		emitter.flush();
+		phase.items("bytes", emitter.written());
 	} else {
 		std::ofstream outStream(outPath);
-		prog->toX64(outStream);
+		X64Emitter emitter(outStream);
+		emitter.setComments(asmComments);
+		prog->toX64(emitter);
+		emitter.flush();
+		phase.items("bytes", emitter.written());
 		outStream.close();
 	}
 	return 0;
 }
 
-int
-main( const int argc, const char **argv )
-{
+static void writeStats(a_lang::IRProgram * prog, const char * outPath){
+	PassTimer::Phase phase("stats");
+	CodeStats stats;
+	prog->statsX64(stats);
+	if (strcmp(outPath, "--") == 0){
+		stats.writeJSON(std::cout);
+		std::cout << std::flush;
+		return;
+	}
+	std::ofstream outStream(outPath);
+	if (!outStream.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	stats.writeJSON(outStream);
+}
+
+static std::string absolutePath(const char * path){
+	if (path[0] == '/'){ return path; }
+	char * cwd = getcwd(nullptr, 0);
+	if (cwd == nullptr){ return path; }
+	std::string res = std::string(cwd) + "/" + path;
+	free(cwd);
+	return res;
+}
+
+//Parse and compile in one go, writing each declaration as soon
+// as it has been parsed. The output file is removed if the
+// program turns out to have errors.
+static bool streamX64(const char * inputPath, const char * outPath,
+  bool asmComments){
+	if (outPath == nullptr){
+		throw new InternalError("Null codegen file given");
+	}
+	bool toStdout = strcmp(outPath, "--") == 0;
+	std::ofstream outStream;
+	if (!toStdout){
+		outStream.open(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new InternalError(msg.c_str());
+		}
+	}
+	X64Emitter emitter(toStdout ? std::cout : outStream);
+	emitter.setComments(asmComments);
+
+	//Kept from one compile to the next, so the compile server
+	// has the entries it has already seen in memory
+	static std::unique_ptr<FnCache> cache;
+	if (cacheDir != nullptr){
+		std::string dir = absolutePath(cacheDir);
+		if (!cache || cache->getDir() != dir){ cache.reset(new FnCache(dir)); }
+	}
+	StreamCompiler compiler(emitter, passes.get(),
+		cacheDir != nullptr ? cache.get() : nullptr, &inputTokens);
+	a_lang::ProgramNode * ast = parse(inputPath, &compiler);
+	bool ok = ast != nullptr && compiler.finish();
+	if (ast != nullptr){ ASTNode::destroy(ast); }
+	emitter.flush();
+	if (!toStdout){
+		outStream.close();
+		if (!ok){ std::remove(outPath); }
+	}
+	return ok;
+}
+
+//Turns -time-passes timing on for one compile and reports it
+// however the compile ends
+class TimingReport{
+public:
+	TimingReport(){
+		if (timePasses || timePassesJSON != nullptr){ PassTimer::start(); }
+	}
+	~TimingReport(){
+		if (!PassTimer::enabled()){ return; }
+		PassTimer::stop();
+		if (timePasses){ PassTimer::printTable(std::cerr); }
+		if (timePassesJSON == nullptr){ return; }
+		if (strcmp(timePassesJSON, "--") == 0){
+			PassTimer::printJSON(std::cout);
+			std::cout << std::flush;
+			return;
+		}
+		std::ofstream outStream(timePassesJSON);
+		if (!outStream.good()){
+			std::cerr << "Bad output file " << timePassesJSON << "\n";
+			return;
+		}
+		PassTimer::printJSON(outStream);
+	}
+};
+
+//Run one command line (argv[0] being the program name)
+static int compile(const int argc, const char **argv){
+	//A compile server runs many of these, so start from the
+	// defaults and with no input
+	useFastLexer = false;
+	lexJobs = 1;
+	pipelineLexer = false;
+	semaJobs = 1;
+	streamCompile = false;
+	cacheDir = nullptr;
+	loadIR = false;
+	timePasses = false;
+	timePassesJSON = nullptr;
+	passes.reset(new PassManager());
+	profileGenerate = false;
+	profile.reset();
+	profileCycles = false;
+	inputTokens.clear();
+
 	if (argc <= 1){ usageAndDie(); }
-	std::ifstream * input = new std::ifstream(argv[1]);
-	if (input == nullptr){ usageAndDie(); }
-	if (!input->good()){
+	std::ifstream input(argv[1]);
+	if (!input.good()){
 		std::cerr << "Bad path " << argv[1] << std::endl;
 		usageAndDie();
 	}
@@ -165,12 +472,88 @@ main( const int argc, const char **argv )
 	bool checkTypes = false;
 	const char * threeACFile = NULL;
 	const char * asmFile = NULL;
+	const char * irFile = NULL;
+	const char * statsFile = NULL;
+	bool asmComments = true;
+	const char * profileFile = NULL;
 
 	bool useful = false;
 	int i = 1;
 	for (int i = 1 ; i < argc ; i++){
 		if (argv[i][0] == '-'){
-			if (argv[i][1] == 't'){
+			if (strcmp(argv[i], "-fast-lex") == 0){
+				useFastLexer = true;
+			} else if (strcmp(argv[i], "-pipe-lex") == 0){
+				pipelineLexer = true;
+			} else if (strcmp(argv[i], "-lex-jobs") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				lexJobs = strtoul(argv[i], nullptr, 10);
+				if (lexJobs == 0){
+					lexJobs = std::thread::hardware_concurrency();
+				}
+			} else if (strcmp(argv[i], "-sema-jobs") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				semaJobs = strtoul(argv[i], nullptr, 10);
+				if (semaJobs == 0){
+					semaJobs = std::thread::hardware_concurrency();
+				}
+			} else if (strcmp(argv[i], "-stream") == 0){
+				streamCompile = true;
+			} else if (strcmp(argv[i], "-cache") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				cacheDir = argv[i];
+				streamCompile = true;
+			} else if (strcmp(argv[i], "-emit-ir") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				irFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "-load-ir") == 0){
+				loadIR = true;
+			} else if (strcmp(argv[i], "-time-passes") == 0){
+				timePasses = true;
+			} else if (strcmp(argv[i], "-time-passes-json") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				timePassesJSON = argv[i];
+			} else if (strcmp(argv[i], "-stats") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				statsFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "-O0") == 0){
+				passes->setLevel(0);
+			} else if (strcmp(argv[i], "-O1") == 0){
+				passes->setLevel(1);
+			} else if (strcmp(argv[i], "-O2") == 0){
+				passes->setLevel(2);
+			} else if (strcmp(argv[i], "-enable-pass") == 0
+			  || strcmp(argv[i], "-disable-pass") == 0){
+				bool on = strcmp(argv[i], "-enable-pass") == 0;
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				if (!passes->setEnabled(argv[i], on)){
+					std::cerr << "No pass named " << argv[i] << "; passes are:";
+					for (const std::string& name : passes->passNames()){
+						std::cerr << " " << name;
+					}
+					std::cerr << std::endl;
+					usageAndDie();
+				}
+			} else if (strcmp(argv[i], "-verify-ir") == 0){
+				passes->setVerify(true);
+			} else if (strcmp(argv[i], "-fprofile-generate") == 0){
+				profileGenerate = true;
+			} else if (strcmp(argv[i], "-fprofile-use") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				profileFile = argv[i];
+			} else if (strcmp(argv[i], "-fprofile-cycles") == 0){
+				profileCycles = true;
+			} else if (argv[i][1] == 't'){
 				i++;
 				tokensFile = argv[i];
 				useful = true;
@@ -199,6 +582,8 @@ main( const int argc, const char **argv )
 				if (i >= argc){ usageAndDie(); }
 				asmFile = argv[i];
 				useful = true;
+			} else if (argv[i][1] == 'q'){
+				asmComments = false;
 			} else {
 				std::cerr << "Unrecognized argument: ";
 				std::cerr << argv[i] << std::endl;
@@ -221,7 +606,26 @@ main( const int argc, const char **argv )
 		std::cerr << "Hey, you didn't tell the compiler to do anything!\n";
 		usageAndDie();
 	}
+	if (loadIR && (tokensFile || checkParse || unparseFile || namesFile
+	  || checkTypes || irFile || streamCompile)){
+		std::cerr << "Only -a, -o and -stats can start from binary IR\n";
+		usageAndDie();
+	}
+	if ((profileGenerate || profileFile != nullptr || profileCycles)
+	  && streamCompile){
+		std::cerr << "Profiles need the whole program, so not -stream\n";
+		usageAndDie();
+	}
+	if (profileGenerate && profileFile != nullptr){
+		std::cerr << "Use -fprofile-generate or -fprofile-use, not both\n";
+		usageAndDie();
+	}
+	if (profileFile != nullptr){
+		//Like a stale profile, a missing one only costs speed
+		profile.reset(BlockProfile::load(profileFile));
+	}
 
+	TimingReport timing;
 	try {
 		if (tokensFile != nullptr){
 			writeTokenStream(inFile, tokensFile);
@@ -251,15 +655,32 @@ main( const int argc, const char **argv )
 				return 1;
 			}
 		}
-		if (threeACFile != nullptr){
-			auto prog = do3AC(inFile);
+		//-a, -o and -stats share one build of the program, so
+		// the front end and passes run (and are timed) once;
+		// -emit-ir writes it out before the passes change it
+		bool needIR = threeACFile != nullptr || statsFile != nullptr
+			|| (asmFile != nullptr && !streamCompile);
+		IRProgram * prog = nullptr;
+		if (irFile != nullptr){
+			prog = do3AC(inFile);
+			if (prog == nullptr){ return 1; }
+			writeBinaryIR(prog, irFile);
+			if (needIR){ optimize(prog); }
+		} else if (needIR){
+			prog = getIR(inFile);
 			if (prog == nullptr){ return 1; }
+		}
+		if (needIR){ prog->setCycleProfile(profileCycles); }
+		if (threeACFile != nullptr){
 			write3AC(prog, threeACFile);
 		}
-		if (asmFile != nullptr){
-			auto prog = do3AC(inFile);
-			if (prog == nullptr){ return 1; }
-			writeX64(prog, asmFile);
+		if (asmFile != nullptr && streamCompile){
+			if (!streamX64(inFile, asmFile, asmComments)){ return 1; }
+		} else if (asmFile != nullptr){
+			writeX64(prog, asmFile, asmComments);
+		}
+		if (statsFile != nullptr){
+			writeStats(prog, statsFile);
 		}
 	} catch (a_lang::ToDoError * e){
 		std::cerr << "ToDoError: " << e->msg() << std::endl;
@@ -270,3 +691,52 @@ main( const int argc, const char **argv )
 	}
 	return 0;
 }
+
+static int run(const int argc, const char **argv){
+	try {
+		return compile(argc, argv);
+	} catch (UsageError&){
+		return 1;
+	}
+}
+
+//Free what the last compile built. The process ends after a
+// single compile, so only the compile server needs this.
+static void releaseCompile(){
+	for (IRProgram * prog : builtProgs){ delete prog; }
+	for (TypeAnalysis * types : builtTypes){ delete types; }
+	for (NameAnalysis * names : builtNames){ delete names; }
+	for (ProgramNode * ast : builtASTs){ ASTNode::destroy(ast); }
+	builtProgs.clear();
+	builtTypes.clear();
+	builtNames.clear();
+	builtASTs.clear();
+	//Symbol IDs index per-program tables, so they would
+	// otherwise keep growing from one compile to the next
+	SemSymbol::resetIDs();
+}
+
+int
+main( const int argc, const char **argv )
+{
+	a_lang::Position::setLineMap(&inputTokens);
+	if (argc == 3 && strcmp(argv[1], "-serve") == 0){
+		CompileServer server(argv[2],
+		  [](const std::vector<std::string>& args){
+			std::vector<const char *> cmd(1, "ac");
+			for (const std::string& arg : args){ cmd.push_back(arg.c_str()); }
+			return run(static_cast<int>(cmd.size()), cmd.data());
+		}, releaseCompile);
+		return server.serve();
+	}
+	if (argc >= 3 && strcmp(argv[1], "-connect") == 0){
+		std::vector<std::string> args(argv + 3, argv + argc);
+		int status;
+		if (CompileServer::request(argv[2], args, status)){
+			return status;
+		}
+		//No server there, so compile in this process
+		return run(argc - 2, argv + 2);
+	}
+	return run(argc, argv);
+}
@@ -1,10 +1,18 @@
-#include "ast.hpp"
+#include <memory>
+#include <sstream>
+#include "ast_walk.hpp"
+#include "parallel.hpp"
 #include "symbol_table.hpp"
 #include "errName.hpp"
 #include "types.hpp"
 
 namespace a_lang{
 
+bool ASTNode::nameStep(NameWalk& walk, WalkFrame& f){
+	f.ok = nameAnalysis(walk.symTab);
+	return false;
+}
+
 bool ProgramNode::nameAnalysis(SymbolTable * symTab){
 	//Enter the global scope
 	symTab->enterScope();
@@ -18,6 +26,58 @@ bool ProgramNode::nameAnalysis(SymbolTable * symTab){
 	return res;
 }
 
+bool ProgramNode::nameAnalysis(SymbolTable * symTab, size_t jobs){
+	if (jobs <= 1){ return nameAnalysis(symTab); }
+
+	ScopeTable * globals = symTab->enterScope();
+
+	//Errors are buffered per declaration and printed in source
+	// order at the end, so the report reads the same as the
+	// serial pass no matter which thread finished first
+	size_t numDecls = myGlobals->size();
+	std::vector<std::ostringstream> errs(numDecls);
+	std::vector<FnDeclNode *> fns;
+	std::vector<size_t> fnErrs;
+	std::vector<size_t> fnVisible;
+
+	bool res = true;
+	size_t idx = 0;
+	for (auto decl : *myGlobals){
+		Report::setSink(&errs[idx]);
+		FnDeclNode * fn = decl->asFnDecl();
+		if (fn == nullptr){
+			res = decl->nameAnalysis(symTab) && res;
+		} else {
+			res = fn->nameSignature(symTab) && res;
+			fns.push_back(fn);
+			fnErrs.push_back(idx);
+			//The body may only see globals declared up to here
+			fnVisible.push_back(SemSymbol::numIDs());
+		}
+		idx++;
+	}
+
+	std::vector<char> bodyOK(fns.size(), 1);
+	//The block scopes entered in a body hold its locals, which
+	// must outlive the body's table
+	std::vector<std::unique_ptr<SymbolTable>> locals(fns.size());
+	parallelFor(fns.size(), jobs, [&](size_t k){
+		Report::setSink(&errs[fnErrs[k]]);
+		locals[k].reset(new SymbolTable(globals, fns[k]->scope(), fnVisible[k]));
+		bodyOK[k] = fns[k]->nameBody(locals[k].get());
+		Report::setSink(nullptr);
+	});
+	Report::setSink(nullptr);
+	for (auto& local : locals){
+		if (local){ symTab->adopt(*local); }
+	}
+
+	for (auto& err : errs){ Report::sink() << err.str(); }
+	for (char ok : bodyOK){ res = ok && res; }
+	symTab->leaveScope();
+	return res;
+}
+
 bool AssignStmtNode::nameAnalysis(SymbolTable * symTab){
 	bool result = true;
 	result = myDst->nameAnalysis(symTab) && result;
@@ -42,41 +102,66 @@ bool ToConsoleStmtNode::nameAnalysis(SymbolTable * symTab){
 }
 
 bool IfStmtNode::nameAnalysis(SymbolTable * symTab){
-	bool result = true;
-	result = myCond->nameAnalysis(symTab) && result;
-	symTab->enterScope();
-	for (auto stmt : *myBody){
-		result = stmt->nameAnalysis(symTab) && result;
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
+}
+
+bool IfStmtNode::nameStep(NameWalk& walk, WalkFrame& f){
+	if (f.step == 0){
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
 	}
-	symTab->leaveScope();
-	return result;
+	size_t i = f.step - 1;
+	if (i == 0){ walk.symTab->enterScope(); }
+	if (i < myBody->size()){ return walk.visit(walk.kid(f, i)); }
+	walk.symTab->leaveScope();
+	return false;
 }
 
 bool IfElseStmtNode::nameAnalysis(SymbolTable * symTab){
-	bool result = true;
-	result = myCond->nameAnalysis(symTab) && result;
-	symTab->enterScope();
-	for (auto stmt : *myBodyTrue){
-		result = stmt->nameAnalysis(symTab) && result;
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
+}
+
+bool IfElseStmtNode::nameStep(NameWalk& walk, WalkFrame& f){
+	if (f.step == 0){
+		f.kids = walk.queue(myBodyTrue);
+		walk.queue(myBodyFalse);
+		return walk.visit(myCond);
 	}
-	symTab->leaveScope();
-	symTab->enterScope();
-	for (auto stmt : *myBodyFalse){
-		result = stmt->nameAnalysis(symTab) && result;
+	size_t i = f.step - 1;
+	size_t numTrue = myBodyTrue->size();
+	if (i == 0){ walk.symTab->enterScope(); }
+	if (i < numTrue){ return walk.visit(walk.kid(f, i)); }
+	if (i == numTrue){
+		walk.symTab->leaveScope();
+		walk.symTab->enterScope();
 	}
-	symTab->leaveScope();
-	return result;
+	if (i < numTrue + myBodyFalse->size()){
+		return walk.visit(walk.kid(f, i));
+	}
+	walk.symTab->leaveScope();
+	return false;
 }
 
 bool WhileStmtNode::nameAnalysis(SymbolTable * symTab){
-	bool result = true;
-	result = myCond->nameAnalysis(symTab) && result;
-	symTab->enterScope();
-	for (auto stmt : *myBody){
-		result = stmt->nameAnalysis(symTab) && result;
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
+}
+
+bool WhileStmtNode::nameStep(NameWalk& walk, WalkFrame& f){
+	if (f.step == 0){
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
 	}
-	symTab->leaveScope();
-	return result;
+	size_t i = f.step - 1;
+	if (i == 0){ walk.symTab->enterScope(); }
+	if (i < myBody->size()){ return walk.visit(walk.kid(f, i)); }
+	walk.symTab->leaveScope();
+	return false;
 }
 
 bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
@@ -117,6 +202,14 @@ bool ImmutableTypeNode::nameAnalysis(SymbolTable * symTab){
 }
 
 bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
+	bool validSig = nameSignature(symTab);
+	symTab->resumeScope(myScope);
+	bool validBody = nameBody(symTab);
+	symTab->leaveScope();
+	return validSig && validBody;
+}
+
+bool FnDeclNode::nameSignature(SymbolTable * symTab){
 	std::string fnName = this->ID()->getName();
 
 	bool validRet = myRetType->nameAnalysis(symTab);
@@ -155,37 +248,58 @@ bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
 		this->myID->attachSymbol(sym);
 	}
 
+	myScope = inFnScope;
+	symTab->leaveScope();
+	return (validRet && validFormals && validName);
+}
+
+bool FnDeclNode::nameBody(SymbolTable * symTab){
 	bool validBody = true;
 	for (auto stmt : *myBody){
 		validBody = stmt->nameAnalysis(symTab) && validBody;
 	}
-
-	symTab->leaveScope();
-	return (validRet && validFormals && validName && validBody);
+	return validBody;
 }
 
 bool BinaryExpNode::nameAnalysis(SymbolTable * symTab){
-	bool resultLHS = myExp1->nameAnalysis(symTab);
-	bool resultRHS = myExp2->nameAnalysis(symTab);
-	return resultLHS && resultRHS;
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
 }
 
-bool CallExpNode::nameAnalysis(SymbolTable* symTab){
-	bool result = true;
-	result = myCallee->nameAnalysis(symTab) && result;
-	for (auto arg : *myArgs){
-		result = arg->nameAnalysis(symTab) && result;
+bool BinaryExpNode::nameStep(NameWalk& walk, WalkFrame& f){
+	switch (f.step){
+	case 0: return walk.visit(myExp1);
+	case 1: return walk.visit(myExp2);
+	default: return false;
 	}
-	return result;
 }
 
-bool NegNode::nameAnalysis(SymbolTable* symTab){
-	return myExp->nameAnalysis(symTab);
+bool CallExpNode::nameAnalysis(SymbolTable* symTab){
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
 }
 
+bool CallExpNode::nameStep(NameWalk& walk, WalkFrame& f){
+	if (f.step == 0){
+		f.kids = walk.queue(myArgs);
+		return walk.visit(myCallee);
+	}
+	size_t i = f.step - 1;
+	if (i < myArgs->size()){ return walk.visit(walk.kid(f, i)); }
+	return false;
+}
 
-bool NotNode::nameAnalysis(SymbolTable* symTab){
-	return myExp->nameAnalysis(symTab);
+bool UnaryExpNode::nameAnalysis(SymbolTable* symTab){
+	NameWalk walk(symTab);
+	walk.run(this);
+	return walk.ok();
+}
+
+bool UnaryExpNode::nameStep(NameWalk& walk, WalkFrame& f){
+	if (f.step == 0){ return walk.visit(myExp); }
+	return false;
 }
 
 bool ReturnStmtNode::nameAnalysis(SymbolTable * symTab){
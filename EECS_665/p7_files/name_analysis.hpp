@@ -7,21 +7,29 @@ namespace a_lang{
 
 class NameAnalysis{
 public:
-	static NameAnalysis * build(ProgramNode * astIn){
-		NameAnalysis * nameAnalysis = new NameAnalysis;
+	static NameAnalysis * build(ProgramNode * astIn, size_t jobs = 1){
 		SymbolTable * symTab = new SymbolTable();
-		bool res = astIn->nameAnalysis(symTab);
-		delete symTab;
-		if (!res){ return nullptr; }
+		bool res = astIn->nameAnalysis(symTab, jobs);
+		if (!res){
+			delete symTab;
+			return nullptr;
+		}
 
+		NameAnalysis * nameAnalysis = new NameAnalysis;
 		nameAnalysis->ast = astIn;
+		nameAnalysis->symTab = symTab;
 		return nameAnalysis;
 	}
+	//The symbols the AST now points to live as long as this
+	~NameAnalysis(){ delete symTab; }
+	NameAnalysis(const NameAnalysis&) = delete;
+	NameAnalysis& operator=(const NameAnalysis&) = delete;
 	ProgramNode * ast;
 
 private:
 	NameAnalysis(){
 	}
+	SymbolTable * symTab;
 };
 
 }
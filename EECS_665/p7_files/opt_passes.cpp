@@ -0,0 +1,233 @@
+#include <cstdlib>
+#include "opt_passes.hpp"
+
+namespace a_lang{
+
+//The passes change the body as they go, so each walks a copy
+static std::vector<Quad *> bodyOf(Procedure * proc){
+	std::vector<Quad *> quads;
+	quads.reserve(proc->getQuads()->size());
+	for (Quad * quad : *proc->getQuads()){ quads.push_back(quad); }
+	return quads;
+}
+
+//The value of an integer or bool literal (string literals are
+// named "str_N", so they don't count)
+static bool litValue(Opd * opd, int64_t& val){
+	LitOpd * lit = dynamic_cast<LitOpd *>(opd);
+	if (lit == nullptr){ return false; }
+	std::string text = lit->valString();
+	const char * begin = text.c_str();
+	char * end = nullptr;
+	long long parsed = strtoll(begin, &end, 10);
+	if (end == begin || *end != '\0'){ return false; }
+	val = parsed;
+	return true;
+}
+
+static LitOpd * makeLit(Procedure * proc, int64_t val, size_t width){
+	return proc->keepLit(new LitOpd(std::to_string(val), width));
+}
+
+//Arithmetic wraps, as the machine's does
+static int64_t wrap(uint64_t val){ return static_cast<int64_t>(val); }
+
+static bool foldBinary(BinOp op, int64_t a, int64_t b, int64_t& res){
+	uint64_t ua = static_cast<uint64_t>(a);
+	uint64_t ub = static_cast<uint64_t>(b);
+	switch (op){
+	case ADD64: res = wrap(ua + ub); return true;
+	case SUB64: res = wrap(ua - ub); return true;
+	case MULT64: res = wrap(ua * ub); return true;
+	case DIV64:
+		//Left for the machine to trap on
+		if (b == 0 || (a == INT64_MIN && b == -1)){ return false; }
+		res = a / b;
+		return true;
+	case AND64: res = a & b; return true;
+	case OR64: res = a | b; return true;
+	case EQ64: res = a == b; return true;
+	case NEQ64: res = a != b; return true;
+	case LT64: res = a < b; return true;
+	case GT64: res = a > b; return true;
+	case LTE64: res = a <= b; return true;
+	case GTE64: res = a >= b; return true;
+	default: return false;
+	}
+}
+
+static bool foldUnary(UnaryOp op, int64_t a, int64_t& res){
+	switch (op){
+	case NEG64: res = wrap(0 - static_cast<uint64_t>(a)); return true;
+	case NOT64: res = a == 0; return true;
+	default: return false;
+	}
+}
+
+bool FoldPass::run(Procedure * proc, ProcAnalyses& facts){
+	bool changed = false;
+	for (Quad * quad : bodyOf(proc)){
+		int64_t a, b, res;
+		Opd * dst = nullptr;
+		if (BinOpQuad * bin = dynamic_cast<BinOpQuad *>(quad)){
+			if (!litValue(bin->getSrc1(), a)){ continue; }
+			if (!litValue(bin->getSrc2(), b)){ continue; }
+			if (!foldBinary(bin->getOp(), a, b, res)){ continue; }
+			dst = bin->getDst();
+		} else if (UnaryOpQuad * unary = dynamic_cast<UnaryOpQuad *>(quad)){
+			if (!litValue(unary->getSrc(), a)){ continue; }
+			if (!foldUnary(unary->getOp(), a, res)){ continue; }
+			dst = unary->getDst();
+		} else {
+			continue;
+		}
+		LitOpd * lit = makeLit(proc, res, dst->getWidth());
+		proc->swapQuad(quad, new AssignQuad(dst, lit));
+		changed = true;
+	}
+	return changed;
+}
+
+bool LitPropPass::run(Procedure * proc, ProcAnalyses& facts){
+	DefUse& du = facts.defUse();
+	bool changed = false;
+	for (Quad * quad : bodyOf(proc)){
+		AssignQuad * assign = dynamic_cast<AssignQuad *>(quad);
+		if (assign == nullptr){ continue; }
+		AuxOpd * tmp = dynamic_cast<AuxOpd *>(assign->getDst());
+		int64_t val;
+		if (tmp == nullptr || !litValue(assign->getSrc(), val)){ continue; }
+		const DefUse::Info& info = du.get(tmp);
+		if (info.defs != 1 || info.pinned){ continue; }
+
+		//A temporary is written before it is read, so with one
+		// write every read sees the literal
+		Opd * lit = assign->getSrc();
+		if (lit->getWidth() != tmp->getWidth()){
+			lit = makeLit(proc, val, tmp->getWidth());
+		}
+		for (Quad * user : du.users(tmp)){ user->replaceUse(tmp, lit); }
+		proc->removeQuad(assign);
+		changed = true;
+	}
+	return changed;
+}
+
+//Whether dropping the quad would lose more than its result
+static bool hasEffects(Quad * quad){
+	BinOpQuad * bin = dynamic_cast<BinOpQuad *>(quad);
+	if (bin != nullptr && bin->getOp() == DIV64){
+		//It may divide by zero, or overflow (INT64_MIN / -1)
+		int64_t divisor;
+		return !litValue(bin->getSrc2(), divisor) || divisor == 0
+			|| divisor == -1;
+	}
+	return dynamic_cast<BinOpQuad *>(quad) == nullptr
+		&& dynamic_cast<UnaryOpQuad *>(quad) == nullptr
+		&& dynamic_cast<AssignQuad *>(quad) == nullptr
+		&& dynamic_cast<GetRetQuad *>(quad) == nullptr;
+}
+
+bool DeadPass::run(Procedure * proc, ProcAnalyses& facts){
+	DefUse& du = facts.defUse();
+	//Reads lost with the quads dropped so far. Walking backwards,
+	// a chain of dead temporaries goes in one run.
+	HashMap<Opd *, size_t> dropped;
+	std::vector<Quad *> quads = bodyOf(proc);
+	std::vector<Opd *> srcs;
+	bool changed = false;
+	for (auto it = quads.rbegin(); it != quads.rend(); ++it){
+		Quad * quad = *it;
+		AuxOpd * tmp = dynamic_cast<AuxOpd *>(quad->def());
+		if (tmp == nullptr || hasEffects(quad)){ continue; }
+		const DefUse::Info& info = du.get(tmp);
+		if (info.pinned){ continue; }
+		if (info.uses > 0){
+			auto gone = dropped.find(tmp);
+			if (gone == dropped.end() || gone->second < info.uses){ continue; }
+		}
+
+		srcs.clear();
+		quad->uses(srcs);
+		for (Opd * src : srcs){ dropped[src]++; }
+		proc->removeQuad(quad);
+		changed = true;
+	}
+	return changed;
+}
+
+static bool hasLabel(Quad * quad, Label * label){
+	for (Label * has : quad->getLabels()){
+		if (has == label){ return true; }
+	}
+	return false;
+}
+
+bool BranchPass::run(Procedure * proc, ProcAnalyses& facts){
+	bool changed = false;
+	for (Quad * quad : bodyOf(proc)){
+		if (IfzQuad * branch = dynamic_cast<IfzQuad *>(quad)){
+			int64_t val;
+			bool isLit = litValue(branch->getCnd(), val);
+			if (hasLabel(proc->nextQuad(branch), branch->getTarget())
+			  || (isLit && val != 0)){
+				//Never taken, or lands where it would anyway
+				proc->removeQuad(branch);
+				changed = true;
+				continue;
+			}
+			if (!isLit){ continue; }
+			//Always taken
+			quad = new GotoQuad(branch->getTarget());
+			proc->swapQuad(branch, quad);
+			changed = true;
+		} else if (IfnzQuad * branch = dynamic_cast<IfnzQuad *>(quad)){
+			int64_t val;
+			bool isLit = litValue(branch->getCnd(), val);
+			if (hasLabel(proc->nextQuad(branch), branch->getTarget())
+			  || (isLit && val == 0)){
+				proc->removeQuad(branch);
+				changed = true;
+				continue;
+			}
+			if (!isLit){ continue; }
+			quad = new GotoQuad(branch->getTarget());
+			proc->swapQuad(branch, quad);
+			changed = true;
+		}
+		if (GotoQuad * jump = dynamic_cast<GotoQuad *>(quad)){
+			if (hasLabel(proc->nextQuad(jump), jump->getTarget())){
+				proc->removeQuad(jump);
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+bool UnreachablePass::run(Procedure * proc, ProcAnalyses& facts){
+	const ControlFlowGraph& cfg = facts.cfg();
+	std::vector<bool> reached = cfg.reachable();
+	bool changed = false;
+	for (size_t idx = 0; idx < cfg.numBlocks(); idx++){
+		if (reached[idx]){ continue; }
+		for (Quad * quad : cfg.getBlocks()[idx].quads){
+			proc->removeQuad(quad);
+		}
+		changed = true;
+	}
+	return changed;
+}
+
+bool NopPass::run(Procedure * proc, ProcAnalyses& facts){
+	bool changed = false;
+	for (Quad * quad : bodyOf(proc)){
+		if (dynamic_cast<NopQuad *>(quad) != nullptr){
+			proc->removeQuad(quad);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+}
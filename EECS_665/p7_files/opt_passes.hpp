@@ -0,0 +1,57 @@
+#ifndef A_LANG_OPT_PASSES_HPP
+#define A_LANG_OPT_PASSES_HPP
+
+#include "pass_manager.hpp"
+
+namespace a_lang{
+
+//Work out operations whose operands are all literals
+class FoldPass : public Pass{
+public:
+	const char * name() const override { return "fold"; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+//Replace temporaries assigned a literal once with the literal
+class LitPropPass : public Pass{
+public:
+	const char * name() const override { return "lit-prop"; }
+	AnalysisSet needs() const override { return DEF_USE_ANALYSIS; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+//Drop computations into temporaries nothing reads
+class DeadPass : public Pass{
+public:
+	const char * name() const override { return "dead"; }
+	AnalysisSet needs() const override { return DEF_USE_ANALYSIS; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+//Drop jumps to the next quad and settle branches on literals
+class BranchPass : public Pass{
+public:
+	const char * name() const override { return "branch"; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+//Drop quads control can never reach
+class UnreachablePass : public Pass{
+public:
+	const char * name() const override { return "unreachable"; }
+	AnalysisSet needs() const override { return CFG_ANALYSIS; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+//Drop nops (their labels move on to the next quad)
+class NopPass : public Pass{
+public:
+	const char * name() const override { return "nop"; }
+	//Nops read and write nothing
+	AnalysisSet preserves() const override { return DEF_USE_ANALYSIS; }
+	bool run(Procedure * proc, ProcAnalyses& facts) override;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef A_LANG_PARALLEL_HPP
+#define A_LANG_PARALLEL_HPP
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace a_lang{
+
+//Run work(0), ..., work(count - 1) on up to jobs threads,
+// counting the calling thread. Each thread takes the next item
+// off a shared counter, so one long item (a big function, say)
+// doesn't hold up a batch of short ones. If an item throws,
+// the first exception is rethrown here once every thread has
+// stopped.
+template <typename Work>
+void parallelFor(size_t count, size_t jobs, Work work){
+	std::atomic<size_t> next(0);
+	std::exception_ptr failure;
+	std::mutex failureLock;
+	auto worker = [&](){
+		try {
+			for (size_t i = next++; i < count; i = next++){
+				work(i);
+			}
+		} catch (...){
+			std::lock_guard<std::mutex> guard(failureLock);
+			if (!failure){ failure = std::current_exception(); }
+			next = count;
+		}
+	};
+
+	if (jobs > count){ jobs = count; }
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < jobs; t++){
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads){ thread.join(); }
+	if (failure){ std::rethrow_exception(failure); }
+}
+
+}
+
+#endif
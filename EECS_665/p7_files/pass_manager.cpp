@@ -0,0 +1,107 @@
+#include "pass_manager.hpp"
+#include "opt_passes.hpp"
+#include "ir_verifier.hpp"
+#include "pass_timer.hpp"
+
+namespace a_lang{
+
+//-O2 reruns the passes while they keep finding work, since each
+// one opens up more for the others; this bounds how long
+static const unsigned MAX_ROUNDS = 4;
+
+PassManager::PassManager() : level(0){
+	//Checking costs a walk of each procedure per pass, so only
+	// DEBUG=1 builds do it unless -verify-ir asks
+#ifdef AC_DEBUG
+	verify = true;
+#else
+	verify = false;
+#endif
+	passes.emplace_back(new FoldPass());
+	levels.push_back(1);
+	passes.emplace_back(new LitPropPass());
+	levels.push_back(2);
+	passes.emplace_back(new DeadPass());
+	levels.push_back(2);
+	passes.emplace_back(new BranchPass());
+	levels.push_back(1);
+	passes.emplace_back(new UnreachablePass());
+	levels.push_back(2);
+	passes.emplace_back(new NopPass());
+	levels.push_back(1);
+}
+
+void PassManager::setLevel(unsigned levelIn){
+	level = levelIn > 2 ? 2 : levelIn;
+}
+
+bool PassManager::setEnabled(const std::string& passName, bool on){
+	for (const std::unique_ptr<Pass>& pass : passes){
+		if (passName != pass->name()){ continue; }
+		if (on){
+			forcedOn.insert(passName);
+			forcedOff.erase(passName);
+		} else {
+			forcedOff.insert(passName);
+			forcedOn.erase(passName);
+		}
+		return true;
+	}
+	return false;
+}
+
+bool PassManager::enabled(size_t idx) const{
+	const char * name = passes[idx]->name();
+	if (forcedOff.count(name) > 0){ return false; }
+	if (forcedOn.count(name) > 0){ return true; }
+	return level >= levels[idx];
+}
+
+void PassManager::run(IRProgram * prog){
+	for (Procedure * proc : *prog->getProcs()){ runProc(proc); }
+}
+
+void PassManager::runProc(Procedure * proc){
+	ProcAnalyses facts(proc);
+	unsigned rounds = level >= 2 ? MAX_ROUNDS : 1;
+	for (unsigned round = 0; round < rounds; round++){
+		bool changed = false;
+		for (size_t idx = 0; idx < passes.size(); idx++){
+			if (!enabled(idx)){ continue; }
+			Pass * pass = passes[idx].get();
+			bool did;
+			{
+				PassTimer::Phase phase(pass->name());
+				phase.items("quads", proc->getQuads()->size());
+				facts.require(pass->needs());
+				did = pass->run(proc, facts);
+			}
+			if (!did){ continue; }
+			changed = true;
+			facts.invalidate(pass->preserves());
+			if (verify){ IRVerifier::check(proc, pass->name()); }
+		}
+		if (!changed){ break; }
+	}
+}
+
+std::string PassManager::describe() const{
+	std::string res = "passes";
+	for (size_t idx = 0; idx < passes.size(); idx++){
+		if (!enabled(idx)){ continue; }
+		res += " ";
+		res += passes[idx]->name();
+	}
+	if (level >= 2){ res += " (to a fixpoint)"; }
+	return res;
+}
+
+std::vector<std::string> PassManager::passNames() const{
+	std::vector<std::string> names;
+	for (const std::unique_ptr<Pass>& pass : passes){
+		names.push_back(pass->name());
+	}
+	return names;
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef A_LANG_PASS_MANAGER_HPP
+#define A_LANG_PASS_MANAGER_HPP
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "3ac.hpp"
+#include "proc_analyses.hpp"
+
+namespace a_lang{
+
+//One optimization of a procedure's 3AC
+class Pass{
+public:
+	virtual ~Pass(){ }
+	//Name used by -enable-pass, -disable-pass and -time-passes
+	virtual const char * name() const = 0;
+	//Analyses the pass reads
+	virtual AnalysisSet needs() const { return 0; }
+	//Analyses still true once the pass has changed the procedure
+	virtual AnalysisSet preserves() const { return 0; }
+	//Returns whether it changed anything
+	virtual bool run(Procedure * proc, ProcAnalyses& facts) = 0;
+};
+
+//Runs the passes an optimization level asks for over each
+// procedure, between lowering to 3AC and writing anything out.
+// -O0 runs nothing, so its output is the plain lowering.
+class PassManager{
+public:
+	PassManager();
+	//0, 1 or 2 (higher levels are 2)
+	void setLevel(unsigned levelIn);
+	unsigned getLevel() const { return level; }
+	//Run (or don't run) a pass whatever the level says. Returns
+	// false if there is no pass by that name.
+	bool setEnabled(const std::string& passName, bool on);
+	//Check the IR after every pass that changes it
+	void setVerify(bool on){ verify = on; }
+	bool verifying() const { return verify; }
+
+	void run(IRProgram * prog);
+	void runProc(Procedure * proc);
+	//Everything that decides what the passes do to a procedure,
+	// for cache keys
+	std::string describe() const;
+	//Every pass, in the order they run
+	std::vector<std::string> passNames() const;
+private:
+	bool enabled(size_t idx) const;
+
+	//All known passes, in pipeline order, and the level each
+	// is first run at
+	std::vector<std::unique_ptr<Pass>> passes;
+	std::vector<unsigned> levels;
+	std::set<std::string> forcedOn;
+	std::set<std::string> forcedOff;
+	unsigned level;
+	bool verify;
+};
+
+}
+
+#endif
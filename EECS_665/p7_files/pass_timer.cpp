@@ -0,0 +1,227 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+#include <time.h>
+#include "pass_timer.hpp"
+
+namespace a_lang{
+
+std::atomic<bool> PassTimer::on(false);
+PassTimer::Sample PassTimer::wholeBegin = PassTimer::Sample::zero();
+std::vector<PassTimer::Totals> PassTimer::totals;
+std::vector<PassTimer::Open> PassTimer::open;
+
+static std::atomic<uint64_t> allocCountTotal(0);
+static std::atomic<uint64_t> allocBytesTotal(0);
+
+void PassTimer::noteAlloc(size_t bytes){
+	if (!enabled()){ return; }
+	allocCountTotal.fetch_add(1, std::memory_order_relaxed);
+	allocBytesTotal.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static double clockMS(clockid_t clock){
+	timespec ts;
+	clock_gettime(clock, &ts);
+	return static_cast<double>(ts.tv_sec) * 1000.0
+		+ static_cast<double>(ts.tv_nsec) / 1000000.0;
+}
+
+PassTimer::Sample PassTimer::Sample::now(){
+	Sample res;
+	res.wallMS = clockMS(CLOCK_MONOTONIC);
+	res.cpuMS = clockMS(CLOCK_PROCESS_CPUTIME_ID);
+	res.allocs = allocCountTotal.load(std::memory_order_relaxed);
+	res.allocBytes = allocBytesTotal.load(std::memory_order_relaxed);
+	return res;
+}
+
+PassTimer::Sample PassTimer::Sample::zero(){
+	Sample res;
+	res.wallMS = 0;
+	res.cpuMS = 0;
+	res.allocs = 0;
+	res.allocBytes = 0;
+	return res;
+}
+
+PassTimer::Sample PassTimer::Sample::operator-(const Sample& other) const{
+	Sample res;
+	res.wallMS = wallMS - other.wallMS;
+	res.cpuMS = cpuMS - other.cpuMS;
+	res.allocs = allocs - other.allocs;
+	res.allocBytes = allocBytes - other.allocBytes;
+	return res;
+}
+
+PassTimer::Sample& PassTimer::Sample::operator+=(const Sample& other){
+	wallMS += other.wallMS;
+	cpuMS += other.cpuMS;
+	allocs += other.allocs;
+	allocBytes += other.allocBytes;
+	return *this;
+}
+
+long PassTimer::peakRSSKB(){
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0){ return 0; }
+	return usage.ru_maxrss;
+}
+
+PassTimer::Phase::Phase(const char * name) : active(enabled()), idx(0){
+	if (active){ idx = begin(name); }
+}
+
+PassTimer::Phase::~Phase(){
+	if (active){ end(); }
+}
+
+void PassTimer::Phase::items(const char * unit, uint64_t count){
+	if (!active || idx >= totals.size()){ return; }
+	totals[idx].unit = unit;
+	totals[idx].items += count;
+}
+
+void PassTimer::start(){
+	totals.clear();
+	open.clear();
+	on = true;
+	wholeBegin = Sample::now();
+}
+
+void PassTimer::stop(){
+	//Anything still open (after an exception, say) ends here
+	while (!open.empty()){ end(); }
+	on = false;
+}
+
+size_t PassTimer::begin(const char * name){
+	size_t idx = 0;
+	while (idx < totals.size() && totals[idx].name != name){ idx++; }
+	if (idx == totals.size()){
+		Totals fresh;
+		fresh.name = name;
+		fresh.runs = 0;
+		fresh.self = Sample::zero();
+		fresh.peakRSSKB = 0;
+		fresh.unit = nullptr;
+		fresh.items = 0;
+		totals.push_back(fresh);
+	}
+	Open phase;
+	phase.totals = idx;
+	phase.nested = Sample::zero();
+	phase.begin = Sample::now();
+	open.push_back(phase);
+	return idx;
+}
+
+void PassTimer::end(){
+	if (open.empty()){ return; }
+	Sample spent = Sample::now() - open.back().begin;
+	Totals& total = totals[open.back().totals];
+	total.runs++;
+	total.self += spent - open.back().nested;
+	long rss = peakRSSKB();
+	if (rss > total.peakRSSKB){ total.peakRSSKB = rss; }
+	open.pop_back();
+	if (!open.empty()){ open.back().nested += spent; }
+}
+
+//Units of work a second, given the milliseconds they took
+static double rate(uint64_t items, double ms){
+	return ms > 0 ? static_cast<double>(items) * 1000.0 / ms : 0;
+}
+
+void PassTimer::printTable(std::ostream& out){
+	Sample whole = Sample::now() - wholeBegin;
+	char line[200];
+	snprintf(line, sizeof(line),
+		"%-16s %5s %10s %10s %10s %11s %12s %12s %s\n",
+		"phase", "runs", "wall ms", "cpu ms", "allocs", "alloc KB",
+		"peak RSS KB", "items", "items/s");
+	out << line;
+	for (const Totals& total : totals){
+		snprintf(line, sizeof(line),
+			"%-16s %5zu %10.2f %10.2f %10llu %11.1f %12ld",
+			total.name.c_str(), total.runs,
+			total.self.wallMS, total.self.cpuMS,
+			static_cast<unsigned long long>(total.self.allocs),
+			static_cast<double>(total.self.allocBytes) / 1024.0,
+			total.peakRSSKB);
+		out << line;
+		if (total.unit != nullptr){
+			snprintf(line, sizeof(line), " %12llu %.0f %s/s",
+				static_cast<unsigned long long>(total.items),
+				rate(total.items, total.self.wallMS), total.unit);
+			out << line;
+		}
+		out << "\n";
+	}
+	snprintf(line, sizeof(line),
+		"%-16s %5s %10.2f %10.2f %10llu %11.1f %12ld\n",
+		"total", "", whole.wallMS, whole.cpuMS,
+		static_cast<unsigned long long>(whole.allocs),
+		static_cast<double>(whole.allocBytes) / 1024.0, peakRSSKB());
+	out << line;
+}
+
+static void jsonNumbers(std::ostream& out, double wall, double cpu,
+  uint64_t allocs, uint64_t bytes, long rss){
+	char nums[200];
+	snprintf(nums, sizeof(nums),
+		"\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %llu, "
+		"\"alloc_bytes\": %llu, \"peak_rss_kb\": %ld",
+		wall, cpu, static_cast<unsigned long long>(allocs),
+		static_cast<unsigned long long>(bytes), rss);
+	out << nums;
+}
+
+void PassTimer::printJSON(std::ostream& out){
+	Sample whole = Sample::now() - wholeBegin;
+	out << "{\n  \"schema\": \"ac-time-passes\",\n  \"version\": 1,\n"
+		<< "  \"total\": {";
+	jsonNumbers(out, whole.wallMS, whole.cpuMS, whole.allocs,
+		whole.allocBytes, peakRSSKB());
+	out << "},\n  \"phases\": [";
+	bool first = true;
+	for (const Totals& total : totals){
+		out << (first ? "\n" : ",\n");
+		first = false;
+		//Phase names are fixed strings with nothing to escape
+		out << "    {\"name\": \"" << total.name << "\", \"runs\": "
+			<< total.runs << ", ";
+		jsonNumbers(out, total.self.wallMS, total.self.cpuMS,
+			total.self.allocs, total.self.allocBytes, total.peakRSSKB);
+		if (total.unit != nullptr){
+			char items[120];
+			snprintf(items, sizeof(items),
+				", \"unit\": \"%s\", \"items\": %llu, \"items_per_sec\": %.1f",
+				total.unit, static_cast<unsigned long long>(total.items),
+				rate(total.items, total.self.wallMS));
+			out << items;
+		}
+		out << "}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+}
+
+//Allocations are counted by replacing the global allocator;
+// the array and nothrow forms all come through these
+void * operator new(size_t size){
+	a_lang::PassTimer::noteAlloc(size);
+	void * mem = malloc(size == 0 ? 1 : size);
+	if (mem == nullptr){ throw std::bad_alloc(); }
+	return mem;
+}
+
+void operator delete(void * mem) noexcept{
+	free(mem);
+}
+
+void operator delete(void * mem, size_t) noexcept{
+	free(mem);
+}
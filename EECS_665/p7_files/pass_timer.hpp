@@ -0,0 +1,88 @@
+#ifndef A_LANG_PASS_TIMER_HPP
+#define A_LANG_PASS_TIMER_HPP
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace a_lang{
+
+//Where the compiler spends its time (-time-passes). Each phase
+// of a compile is wrapped in a PassTimer::Phase, and when timing
+// is on the phase's wall time, CPU time, allocations and the
+// peak RSS reached by its end are added to a per-name total.
+// Phases nest (scanning happens inside parsing, and a streaming
+// compile analyses each declaration inside the parse); every
+// number is the phase's own share, not counting phases inside
+// it, so the rows add up to the whole compile. Phases are only
+// started on the main thread, but CPU time and allocations
+// count every thread, so work farmed out by a phase is its own.
+class PassTimer{
+public:
+	class Phase{
+	public:
+		Phase(const char * nameIn);
+		~Phase();
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+		//Credit the phase with count units of work (tokens, AST
+		// nodes...), so its throughput can be reported
+		void items(const char * unit, uint64_t count);
+	private:
+		bool active;
+		size_t idx;
+	};
+
+	//Turn timing on, forgetting any earlier compile's numbers
+	static void start();
+	static void stop();
+	static bool enabled(){ return on.load(std::memory_order_relaxed); }
+
+	static void printTable(std::ostream& out);
+	//The same numbers under a stable schema: new phases only
+	// add rows, and fields are only ever added
+	static void printJSON(std::ostream& out);
+
+	//Called for every allocation (see pass_timer.cpp)
+	static void noteAlloc(size_t bytes);
+private:
+	struct Sample{
+		double wallMS;
+		double cpuMS;
+		uint64_t allocs;
+		uint64_t allocBytes;
+		static Sample now();
+		static Sample zero();
+		Sample operator-(const Sample& other) const;
+		Sample& operator+=(const Sample& other);
+	};
+	struct Totals{
+		std::string name;
+		size_t runs;
+		Sample self;
+		long peakRSSKB;
+		const char * unit;
+		uint64_t items;
+	};
+	struct Open{
+		size_t totals;
+		Sample begin;
+		//Everything spent in phases nested inside this one
+		Sample nested;
+	};
+
+	static size_t begin(const char * name);
+	static void end();
+	static long peakRSSKB();
+
+	static std::atomic<bool> on;
+	static Sample wholeBegin;
+	static std::vector<Totals> totals;
+	static std::vector<Open> open;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "pipelined_scanner.hpp"
+#include "fast_scanner.hpp"
+
+namespace a_lang{
+
+using TokenKind = a_lang::Parser::token;
+
+//Tokens per hand-off, and hand-offs in flight. Big enough
+// that the ring is touched rarely, small enough that the
+// parser gets going right away.
+static const size_t BATCH_TOKENS = 1024;
+static const size_t RING_BATCHES = 64;
+
+PipelinedScanner::PipelinedScanner(const char * path,
+  TokenBuffer * tokensIn)
+: Scanner(nullptr, tokensIn), myRing(RING_BATCHES), myStop(false){
+	myTokens->mapSource(path);
+	//The lexer thread prints error positions
+	myTokens->indexLines();
+	myLexer = std::thread(&PipelinedScanner::produce, this);
+}
+
+PipelinedScanner::~PipelinedScanner(){
+	//The parser may stop early (e.g. on a syntax error), so
+	// the lexer can't count on the ring being drained
+	myStop.store(true, std::memory_order_relaxed);
+	myLexer.join();
+	Batch * batch;
+	while (myRing.pop(batch)){ delete batch; }
+}
+
+//Runs on the lexer thread
+void PipelinedScanner::produce(){
+	const char * src = myTokens->source();
+	FastScanner lexer(nullptr, src, 0, myTokens->sourceSize());
+	bool done = false;
+	while (!done){
+		Batch * batch = new Batch();
+		batch->tokens.reserve(BATCH_TOKENS);
+		lexer.setTokens(&batch->tokens);
+		lexer.redirectErrors(batch->errs);
+		while (batch->tokens.size() < BATCH_TOKENS){
+			if (lexer.lexToken() == TokenKind::END){
+				done = true;
+				break;
+			}
+		}
+		while (!myRing.push(batch)){
+			if (myStop.load(std::memory_order_relaxed)){
+				delete batch;
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+}
+
+int PipelinedScanner::lexToken(){
+	Batch * batch;
+	while (!myRing.pop(batch)){
+		std::this_thread::yield();
+	}
+	std::cerr << batch->errs.str();
+	myTokens->append(batch->tokens);
+	bool last = batch->tokens.complete();
+	delete batch;
+	//The batch's own END has no real offset
+	if (last){ return addEnd(); }
+	return myTokens->kind(myTokens->size() - 1);
+}
+
+}
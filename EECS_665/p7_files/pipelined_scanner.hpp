@@ -0,0 +1,41 @@
+#ifndef __A_LANG_PIPELINED_SCANNER_HPP__
+#define __A_LANG_PIPELINED_SCANNER_HPP__ 1
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include "scanner.hpp"
+#include "spsc_ring.hpp"
+
+namespace a_lang {
+
+//Overlaps lexing with parsing. A FastScanner runs on its own
+// thread and hands over tokens in batches through a lock-free
+// ring; lexToken on the parser's side just moves the next
+// batch into the token buffer. Lexical errors travel with
+// their batch, so they are printed on the parser's thread
+// when that batch is reached rather than as soon as the lexer
+// finds them.
+class PipelinedScanner : public Scanner {
+public:
+   PipelinedScanner(const char * path, TokenBuffer * tokensIn);
+   virtual ~PipelinedScanner();
+
+   virtual int lexToken() override;
+
+private:
+   struct Batch{
+	TokenBuffer tokens;
+	std::ostringstream errs;
+   };
+
+   void produce();
+
+   SpscRing<Batch *> myRing;
+   std::atomic<bool> myStop;
+   std::thread myLexer;
+};
+
+} /* end namespace */
+
+#endif /* END __A_LANG_PIPELINED_SCANNER_HPP__ */
@@ -0,0 +1,26 @@
+#include "position.hpp"
+#include "errors.hpp"
+
+namespace a_lang{
+
+const LineMap * Position::lineMap = nullptr;
+
+std::string Position::lineCol(size_t offset){
+	if (lineMap == nullptr){
+		throw new InternalError("No line map to print positions with");
+	}
+	size_t line;
+	size_t col;
+	lineMap->locate(offset, line, col);
+	return "[" + std::to_string(line) + "," + std::to_string(col) + "]";
+}
+
+std::string Position::begin() const{
+	return lineCol(myBegin);
+}
+
+std::string Position::span() const{
+	return begin() + "-" + lineCol(myEnd);
+}
+
+}
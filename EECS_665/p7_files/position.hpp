@@ -1,48 +1,44 @@
 #ifndef A_LANG_POSITION_H
 #define A_LANG_POSITION_H
 
+#include <stdint.h>
 #include <string>
 
 namespace a_lang{
 
+//Whatever holds the input text. Positions only become lines
+// and columns when they are printed, by asking this.
+class LineMap{
+public:
+	virtual ~LineMap(){ }
+	virtual void locate(size_t offset, size_t& line, size_t& col) const = 0;
+};
+
+//A stretch of the input, as byte offsets [begin, end) into
+// the source file. Small enough to pass and store by value.
 class Position{
 public: 
-	Position(size_t lineI, size_t colI, size_t lineE, size_t colE)
-	: myLineI(lineI), myColI(colI), myLineE(lineE), myColE(colE){
-	}
-	Position(const Position * start, const Position * end)
-	: myLineI(start->myLineI), myColI(start->myColI),
-	  myLineE(end->myLineE),myColE(end->myColE){
+	Position() : myBegin(0), myEnd(0){ }
+	Position(size_t beginIn, size_t endIn)
+	: myBegin(static_cast<uint32_t>(beginIn)),
+	  myEnd(static_cast<uint32_t>(endIn)){
 	}
-	virtual void expand(const Position * start, const Position * end){
-	  myLineI = start->myLineI;
-	  myColI = start->myColI;
-	  myLineE = end->myLineE;
-	  myColE = end->myColE;
-	}
-	virtual std::string begin() const{
-		std::string result = "[" 
-		+ std::to_string(myLineI)
-		+ "," 
-		+ std::to_string(myColI)
-		+ "]";
-		return result;
-	}
-	virtual std::string span() const{
-		std::string result = begin()
-		+ "-[" 
-		+ std::to_string(myLineE)
-		+ "," 
-		+ std::to_string(myColE)
-		+ "]";
-		return result;
+	Position(const Position& start, const Position& end)
+	: myBegin(start.myBegin), myEnd(end.myEnd){
 	}
+	size_t beginOffset() const { return myBegin; }
+	size_t endOffset() const { return myEnd; }
+	std::string begin() const;
+	std::string span() const;
+
+	//Set the map used to print positions
+	static void setLineMap(const LineMap * map){ lineMap = map; }
 private:
-	size_t myLineI;
-	size_t myColI;
-	size_t myLineE;
-	size_t myColE;
+	static std::string lineCol(size_t offset);
 
+	uint32_t myBegin;
+	uint32_t myEnd;
+	static const LineMap * lineMap;
 };
 
 }
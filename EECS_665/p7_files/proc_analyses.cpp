@@ -0,0 +1,83 @@
+#include "proc_analyses.hpp"
+
+namespace a_lang{
+
+DefUse::DefUse(Procedure * proc){
+	infos.reserve(proc->getQuads()->size());
+	std::vector<Opd *> srcs;
+	for (Quad * quad : *proc->getQuads()){
+		srcs.clear();
+		quad->uses(srcs);
+		for (Opd * src : srcs){
+			Info& info = infos[src];
+			info.uses++;
+			if (quad->opaque()){ info.pinned = true; }
+			//Only temporaries' readers are ever asked for
+			if (dynamic_cast<AuxOpd *>(src) == nullptr){ continue; }
+			std::vector<Quad *>& quads = readers[src];
+			//An operand read twice by one quad is listed once
+			if (quads.empty() || quads.back() != quad){
+				quads.push_back(quad);
+			}
+		}
+		if (Opd * dst = quad->def()){
+			Info& info = infos[dst];
+			info.defs++;
+			info.def = quad;
+		}
+	}
+}
+
+const DefUse::Info& DefUse::get(Opd * opd) const{
+	auto found = infos.find(opd);
+	return found == infos.end() ? none : found->second;
+}
+
+const std::vector<Quad *>& DefUse::users(AuxOpd * tmp) const{
+	auto found = readers.find(tmp);
+	return found == readers.end() ? noReaders : found->second;
+}
+
+ProcAnalyses::ProcAnalyses(Procedure * procIn)
+: proc(procIn), allowed(ALL_ANALYSES), myCFG(nullptr), myDefUse(nullptr){ }
+
+ProcAnalyses::~ProcAnalyses(){
+	invalidate(0);
+}
+
+void ProcAnalyses::check(AnalysisSet which) const{
+	if (!(allowed & which)){
+		throw new InternalError("analysis asked for but not declared");
+	}
+}
+
+ControlFlowGraph& ProcAnalyses::cfg(){
+	check(CFG_ANALYSIS);
+	if (myCFG == nullptr){ myCFG = new ControlFlowGraph(proc); }
+	return *myCFG;
+}
+
+DefUse& ProcAnalyses::defUse(){
+	check(DEF_USE_ANALYSIS);
+	if (myDefUse == nullptr){ myDefUse = new DefUse(proc); }
+	return *myDefUse;
+}
+
+void ProcAnalyses::require(AnalysisSet needed){
+	allowed = needed;
+	if (needed & CFG_ANALYSIS){ cfg(); }
+	if (needed & DEF_USE_ANALYSIS){ defUse(); }
+}
+
+void ProcAnalyses::invalidate(AnalysisSet preserved){
+	if (!(preserved & CFG_ANALYSIS)){
+		delete myCFG;
+		myCFG = nullptr;
+	}
+	if (!(preserved & DEF_USE_ANALYSIS)){
+		delete myDefUse;
+		myDefUse = nullptr;
+	}
+}
+
+}
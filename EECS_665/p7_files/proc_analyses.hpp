@@ -0,0 +1,71 @@
+#ifndef A_LANG_PROC_ANALYSES_HPP
+#define A_LANG_PROC_ANALYSES_HPP
+
+#include "3ac.hpp"
+#include "cfg.hpp"
+
+namespace a_lang{
+
+//Facts about a procedure that optimization passes can ask for.
+// A pass names the ones it reads and the ones its changes leave
+// true; the pass manager builds the first before running it and
+// throws away all but the second if it changes anything.
+enum Analysis{
+	CFG_ANALYSIS = 1 << 0,
+	DEF_USE_ANALYSIS = 1 << 1,
+	ALL_ANALYSES = CFG_ANALYSIS | DEF_USE_ANALYSIS,
+};
+using AnalysisSet = unsigned;
+
+//Where each operand is written and read in a procedure body
+class DefUse{
+public:
+	struct Info{
+		size_t defs = 0;
+		size_t uses = 0;
+		//The last quad to write it
+		Quad * def = nullptr;
+		//Used by an opaque quad, so not to be touched
+		bool pinned = false;
+	};
+
+	DefUse(Procedure * proc);
+	//Info for an operand the body never mentions is all zero
+	const Info& get(Opd * opd) const;
+	//Quads that read tmp, in body order
+	const std::vector<Quad *>& users(AuxOpd * tmp) const;
+private:
+	HashMap<Opd *, Info> infos;
+	HashMap<Opd *, std::vector<Quad *>> readers;
+	Info none;
+	std::vector<Quad *> noReaders;
+};
+
+//The analyses of one procedure, built when first asked for
+class ProcAnalyses{
+public:
+	ProcAnalyses(Procedure * procIn);
+	~ProcAnalyses();
+	ProcAnalyses(const ProcAnalyses&) = delete;
+	ProcAnalyses& operator=(const ProcAnalyses&) = delete;
+
+	//Each throws if the analysis isn't among those allowed
+	ControlFlowGraph& cfg();
+	DefUse& defUse();
+	//Build the analyses in needed, and allow only those to be
+	// asked for until the next call
+	void require(AnalysisSet needed);
+	//Forget everything not in preserved
+	void invalidate(AnalysisSet preserved);
+private:
+	void check(AnalysisSet which) const;
+
+	Procedure * proc;
+	AnalysisSet allowed;
+	ControlFlowGraph * myCFG;
+	DefUse * myDefUse;
+};
+
+}
+
+#endif
@@ -6,22 +6,29 @@ using namespace a_lang;
 using TokenKind = a_lang::Parser::token;
 using Lexeme = a_lang::Parser::semantic_type;
 
+int Scanner::yylex(Lexeme * const lval){
+	if (myNext == myTokens->size()){
+		if (myTokens->complete()){ return TokenKind::END; }
+		this->lexToken();
+	}
+	size_t tok = myNext++;
+	int kind = myTokens->kind(tok);
+	if (kind != TokenKind::END){
+		lval->emplace<size_t>(tok);
+	}
+	return kind;
+}
+
+void Scanner::lexAll(){
+	while (!myTokens->complete()){
+		this->lexToken();
+	}
+}
+
 void Scanner::outputTokens(std::ostream& outstream){
-	Lexeme lastMatch;
-	//Token * t = lex.as<Token *>();
-	int tokenKind;
-	while(true){
-		tokenKind = this->yylex(&lastMatch);
-		if (tokenKind == TokenKind::END){
-			outstream << "EOF" 
-			  << " [" << this->lineNum 
-			  << "," << this->colNum << "]"
-			  << std::endl;
-			return;
-		} else {
-			//outstream << lex.as<Token *>()->toString()
-			outstream << lastMatch.as<Token *>()->toString()
-			  << std::endl;
-		}
+	lexAll();
+	for (size_t tok = 0; tok < myTokens->size(); tok++){
+		outstream << myTokens->toString(tok) << "\n";
 	}
+	outstream << std::flush;
 }
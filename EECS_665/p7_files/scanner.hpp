@@ -6,6 +6,7 @@
 #endif
 
 #include "frontend.hh"
+#include "tokens.hpp"
 #include "errors.hpp"
 
 using TokenKind = a_lang::Parser::token;
@@ -15,10 +16,10 @@ namespace a_lang {
 class Scanner : public yyFlexLexer{
 public:
    
-   Scanner(std::istream *in) : yyFlexLexer(in)
+   Scanner(std::istream *in, TokenBuffer * tokensIn)
+   : yyFlexLexer(in), myTokens(tokensIn), myNext(0), myMatchStart(0),
+     myErrs(&std::cerr)
    {
-	lineNum = 1;
-	colNum = 1;
    };
    virtual ~Scanner() {
    };
@@ -26,51 +27,84 @@ public:
    //get rid of override virtual function warning
    using FlexLexer::yylex;
 
-   // YY_DECL defined in the flex a_lang.l
-   virtual int yylex( a_lang::Parser::semantic_type * const lval);
+   //Hand the parser the index of the next token, lexing it
+   // only if an earlier pass hasn't already filled the buffer
+   int yylex( a_lang::Parser::semantic_type * const lval);
+
+   TokenBuffer& tokens(){ return *myTokens; }
+   void setTokens(TokenBuffer * tokensIn){ myTokens = tokensIn; }
+
+   // YY_DECL defined in the flex a_lang.l. Each call records
+   // at least one more token in the buffer and returns the
+   // kind of the last one
+   virtual int lexToken();
+
+   //Lex the rest of the input into the buffer
+   void lexAll();
+
+   //Called by flex before every action
+   void beginMatch(){
+	myMatchStart = myTokens->sourceSize();
+	myTokens->appendSource(yytext, static_cast<size_t>(yyleng));
+   }
 
    int makeBareToken(int tagIn){
-	size_t len = static_cast<size_t>(yyleng);
-	Position * pos = new Position(
-	  this->lineNum, this->colNum,
-	  this->lineNum, this->colNum+len);
-        this->yylval->emplace<a_lang::Token *>(new Token(pos, tagIn));
-        colNum += len;
-        return tagIn;
+	return addToken(tagIn, static_cast<size_t>(yyleng), 0);
+   }
+
+   int addToken(int tagIn, size_t len, int value){
+	myTokens->add(tagIn, myMatchStart, len, value);
+	return tagIn;
+   }
+
+   int addEnd(){
+	myTokens->add(TokenKind::END, myTokens->sourceSize(), 0, 0);
+	return TokenKind::END;
+   }
+
+   //Where the current match sits in the source
+   Position matchPos(size_t len) const {
+	return Position(myMatchStart, myMatchStart + len);
+   }
+
+   //Send lexical errors somewhere other than stderr
+   void redirectErrors(std::ostream& out){
+	myErrs = &out;
    }
 
-   void errIllegal(Position * pos, std::string match){
-	a_lang::Report::fatal(pos, 
-	"Illegal character " + match);
+   void errIllegal(const Position& pos, std::string match){
+	a_lang::Report::fatal(*myErrs, &pos, 
+	("Illegal character " + match).c_str());
    }
 
-   void errStrEsc(Position * pos){
-	a_lang::Report::fatal(pos, 
+   void errStrEsc(const Position& pos){
+	a_lang::Report::fatal(*myErrs, &pos, 
 	"String literal with bad escape sequence detected");
    }
 
-   void errStrUnterm(Position * pos){
-	a_lang::Report::fatal(pos,
+   void errStrUnterm(const Position& pos){
+	a_lang::Report::fatal(*myErrs, &pos,
 	"Unterminated string literal detected");
    }
 
-   void errStrEscAndUnterm(Position * pos){
-	a_lang::Report::fatal(pos, 
+   void errStrEscAndUnterm(const Position& pos){
+	a_lang::Report::fatal(*myErrs, &pos, 
 	"Unterminated string literal with bad escape sequence detected");
    }
 
-   void errIntOverflow(Position * pos){
-	a_lang::Report::fatal(pos, "Integer literal overflow");
+   void errIntOverflow(const Position& pos){
+	a_lang::Report::fatal(*myErrs, &pos, "Integer literal overflow");
    }
 
    static std::string tokenKindString(int tokenKind);
 
    void outputTokens(std::ostream& outstream);
 
-private:
-   a_lang::Parser::semantic_type *yylval = nullptr;
-   size_t lineNum;
-   size_t colNum;
+protected:
+   TokenBuffer * myTokens;
+   size_t myNext;
+   size_t myMatchStart;
+   std::ostream * myErrs;
 };
 
 } /* end namespace */
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include "slot_alloc.hpp"
+#include "cfg.hpp"
+
+namespace a_lang{
+
+static const size_t NONE = SIZE_MAX;
+
+//Sets of the operands being placed, a bit each
+using Bits = std::vector<uint64_t>;
+
+static void setBit(uint64_t * bits, size_t idx){
+	bits[idx / 64] |= uint64_t(1) << (idx % 64);
+}
+
+static bool hasBit(const uint64_t * bits, size_t idx){
+	return (bits[idx / 64] >> (idx % 64)) & 1;
+}
+
+std::vector<size_t> SlotAllocator::assign(Procedure * proc,
+  const std::vector<Opd *>& opds, size_t& numSlots){
+	std::vector<size_t> slots(opds.size(), 0);
+	//Operands used as addresses could be read through at any
+	// time, so nothing shares with anything then
+	for (Quad * quad : *proc->getQuads()){
+		if (!quad->opaque()){ continue; }
+		for (size_t idx = 0; idx < opds.size(); idx++){ slots[idx] = idx; }
+		numSlots = opds.size();
+		return slots;
+	}
+
+	//Operands by address, to number the ones being placed
+	HashMap<Opd *, size_t> index;
+	index.reserve(opds.size());
+	for (size_t idx = 0; idx < opds.size(); idx++){ index[opds[idx]] = idx; }
+	auto indexOf = [&index](Opd * opd){
+		auto found = index.find(opd);
+		return found == index.end() ? NONE : found->second;
+	};
+
+	//Each operand's lifetime is the span of points, in body
+	// order, from the first to the last where it is read, written
+	// or live. A quad reads at its point 2n and writes at 2n + 1,
+	// so what it writes can take the slot of what it last reads.
+	std::vector<size_t> begins(opds.size(), NONE);
+	std::vector<size_t> ends(opds.size(), 0);
+	auto cover = [&begins, &ends](size_t idx, size_t point){
+		if (begins[idx] == NONE || point < begins[idx]){ begins[idx] = point; }
+		if (point > ends[idx]){ ends[idx] = point; }
+	};
+
+	//What each block reads before writing it, and writes. Each
+	// set is a row of words in one array for all the blocks.
+	const ControlFlowGraph cfg(proc);
+	const std::vector<ControlFlowGraph::Block>& blocks = cfg.getBlocks();
+	size_t words = (opds.size() + 63) / 64;
+	Bits reads(blocks.size() * words, 0);
+	Bits writes(blocks.size() * words, 0);
+	std::vector<size_t> firstQuad(blocks.size() + 1, 0);
+	std::vector<Opd *> srcs;
+	size_t at = 0;
+	for (size_t block = 0; block < blocks.size(); block++){
+		uint64_t * read = &reads[block * words];
+		uint64_t * written = &writes[block * words];
+		firstQuad[block] = at;
+		for (Quad * quad : blocks[block].quads){
+			srcs.clear();
+			quad->uses(srcs);
+			for (Opd * src : srcs){
+				size_t idx = indexOf(src);
+				if (idx == NONE){ continue; }
+				cover(idx, 2 * at);
+				if (!hasBit(written, idx)){ setBit(read, idx); }
+			}
+			size_t dst = indexOf(quad->def());
+			if (dst != NONE){
+				cover(dst, 2 * at + 1);
+				setBit(written, dst);
+			}
+			at++;
+		}
+	}
+	firstQuad[blocks.size()] = at;
+
+	//Live on the way in and out of each block. Control mostly
+	// runs forward, so going over the blocks last to first
+	// settles in a few rounds.
+	Bits liveIn(blocks.size() * words, 0);
+	Bits liveOut(blocks.size() * words, 0);
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (size_t block = blocks.size(); block-- > 0;){
+			uint64_t * out = &liveOut[block * words];
+			for (size_t succ : blocks[block].succs){
+				if (succ == ControlFlowGraph::EXIT){ continue; }
+				const uint64_t * in = &liveIn[succ * words];
+				for (size_t w = 0; w < words; w++){ out[w] |= in[w]; }
+			}
+			uint64_t * in = &liveIn[block * words];
+			const uint64_t * read = &reads[block * words];
+			const uint64_t * written = &writes[block * words];
+			for (size_t w = 0; w < words; w++){
+				uint64_t word = read[w] | (out[w] & ~written[w]);
+				if (word != in[w]){
+					in[w] = word;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	//Live into a block covers its start, and out of one its end
+	for (size_t block = 0; block < blocks.size(); block++){
+		for (size_t w = 0; w < words; w++){
+			uint64_t word = liveIn[block * words + w];
+			for (; word != 0; word &= word - 1){
+				size_t idx = 64 * w + static_cast<size_t>(__builtin_ctzll(word));
+				cover(idx, 2 * firstQuad[block]);
+			}
+			word = liveOut[block * words + w];
+			for (; word != 0; word &= word - 1){
+				size_t idx = 64 * w + static_cast<size_t>(__builtin_ctzll(word));
+				cover(idx, 2 * firstQuad[block + 1] - 1);
+			}
+		}
+	}
+
+	//Take the lifetimes in the order they begin, each into the
+	// lowest slot free by then. Operands the body never mentions
+	// are never read or written, so slot 0 will do for them.
+	std::vector<size_t> order;
+	order.reserve(opds.size());
+	for (size_t idx = 0; idx < opds.size(); idx++){
+		if (begins[idx] != NONE){ order.push_back(idx); }
+	}
+	std::sort(order.begin(), order.end(), [&begins](size_t a, size_t b){
+		return begins[a] < begins[b];
+	});
+	using Ending = std::pair<size_t, size_t>;
+	std::priority_queue<Ending, std::vector<Ending>, std::greater<Ending>> inUse;
+	std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> free;
+	numSlots = 0;
+	for (size_t idx : order){
+		while (!inUse.empty() && inUse.top().first < begins[idx]){
+			free.push(inUse.top().second);
+			inUse.pop();
+		}
+		if (free.empty()){
+			slots[idx] = numSlots++;
+		} else {
+			slots[idx] = free.top();
+			free.pop();
+		}
+		inUse.emplace(ends[idx], slots[idx]);
+	}
+	return slots;
+}
+
+}
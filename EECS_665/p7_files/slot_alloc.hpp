@@ -0,0 +1,27 @@
+#ifndef A_LANG_SLOT_ALLOC_HPP
+#define A_LANG_SLOT_ALLOC_HPP
+
+#include <vector>
+#include "3ac.hpp"
+
+namespace a_lang{
+
+//Shares frame slots between operands whose lifetimes don't
+// overlap, so a frame grows with how much is live at once
+// rather than with how many temps the lowering made. A
+// lifetime is the stretch of the body from the first to the
+// last quad where the operand is read, written or live (as
+// found over the procedure's CFG); the stretches are packed
+// into slots first come, first served, as in linear scan.
+class SlotAllocator{
+public:
+	//A slot number (from 0) for each of opds, which must all be
+	// the procedure's own locals or temps; numSlots is set to how
+	// many slots there are in all
+	static std::vector<size_t> assign(Procedure * proc,
+	  const std::vector<Opd *>& opds, size_t& numSlots);
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef A_LANG_SPSC_RING_H
+#define A_LANG_SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include "errors.hpp"
+
+namespace a_lang{
+
+//A bounded queue for exactly one producer thread and one
+// consumer thread. Neither side takes a lock: each owns one
+// index, publishes it with a release store, and only reads
+// the other side's index (acquire) when its cached copy says
+// the ring looks full or empty.
+template <typename T>
+class SpscRing{
+public:
+	//capacity must be a power of two
+	explicit SpscRing(size_t capacity)
+	: slots(capacity), mask(capacity - 1),
+	  head(0), tailCache(0), tail(0), headCache(0){
+		if (capacity == 0 || (capacity & mask) != 0){
+			throw new InternalError("Ring capacity must be a power of 2");
+		}
+	}
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	//Producer side. False if the ring is full
+	bool push(const T& item){
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - headCache == slots.size()){
+			headCache = head.load(std::memory_order_acquire);
+			if (t - headCache == slots.size()){ return false; }
+		}
+		slots[t & mask] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer side. False if the ring is empty
+	bool pop(T& item){
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tailCache){
+			tailCache = tail.load(std::memory_order_acquire);
+			if (h == tailCache){ return false; }
+		}
+		item = slots[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	//Keep each side's index on its own cache line so the
+	// two threads don't invalidate each other on every op
+	static const size_t LINE = 64;
+
+	std::vector<T> slots;
+	const size_t mask;
+	char padSlots[LINE];
+	//Consumer-owned
+	std::atomic<size_t> head;
+	size_t tailCache;
+	char padHead[LINE];
+	//Producer-owned
+	std::atomic<size_t> tail;
+	size_t headCache;
+	char padTail[LINE];
+};
+
+}
+
+#endif
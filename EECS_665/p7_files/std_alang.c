@@ -1,6 +1,7 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include <inttypes.h>
+#include <string.h>
 #include <time.h>
 
 void printBool(int64_t c){
@@ -57,3 +58,95 @@ int64_t getInt(){
 	long int res = atol(buffer);
 	return res;
 }
+
+//Programs built with -fprofile-generate define these (see
+// block_profile.hpp). They are weak, so other programs link
+// without them.
+extern int64_t ac_prof_counts[] __attribute__((weak));
+extern const int64_t ac_prof_num __attribute__((weak));
+extern const char ac_prof_table[] __attribute__((weak));
+
+//Add in the counts an earlier run left at path, if that run
+// was of the same program
+static void mergeProfile(const char * path){
+	FILE * in = fopen(path, "r");
+	if (in == NULL){ return; }
+	size_t len = strlen(ac_prof_table);
+	char * head = malloc(len);
+	int64_t * old = malloc(sizeof(int64_t) * ac_prof_num);
+	int64_t num = 0;
+	int64_t i = 0;
+	if (fread(head, 1, len, in) == len && memcmp(head, ac_prof_table, len) == 0
+	  && fscanf(in, "counts %" SCNd64, &num) == 1 && num == ac_prof_num){
+		while (i < num && fscanf(in, "%" SCNd64, &old[i]) == 1){ i++; }
+	}
+	if (i == ac_prof_num){
+		for (i = 0; i < ac_prof_num; i++){ ac_prof_counts[i] += old[i]; }
+	}
+	free(old);
+	free(head);
+	fclose(in);
+}
+
+//Write the block counts out when the program ends, to
+// $AC_PROFILE or else ac.profile
+__attribute__((destructor)) static void writeProfile(void){
+	if (ac_prof_table == NULL){ return; }
+	const char * path = getenv("AC_PROFILE");
+	if (path == NULL){ path = "ac.profile"; }
+	mergeProfile(path);
+	FILE * out = fopen(path, "w");
+	if (out == NULL){
+		fprintf(stderr, "Can't write profile %s\n", path);
+		return;
+	}
+	fputs(ac_prof_table, out);
+	fprintf(out, "counts %" PRId64 "\n", ac_prof_num);
+	for (int64_t i = 0; i < ac_prof_num; i++){
+		fprintf(out, "%" PRId64 "\n", ac_prof_counts[i]);
+	}
+	fclose(out);
+}
+
+//Programs built with -fprofile-cycles define these: for each
+// procedure, its calls, inclusive cycles, self cycles and a
+// recursion depth, then the procedures' names one after another
+extern int64_t ac_fn_stats[] __attribute__((weak));
+extern const int64_t ac_fn_num __attribute__((weak));
+extern const char ac_fn_names[] __attribute__((weak));
+
+static int bySelfCycles(const void * a, const void * b){
+	int64_t selfA = ac_fn_stats[4 * *(const int64_t *)a + 2];
+	int64_t selfB = ac_fn_stats[4 * *(const int64_t *)b + 2];
+	return (selfA < selfB) - (selfA > selfB);
+}
+
+//Print the flat profile to stderr when the program ends, the
+// procedures that took the most cycles themselves first
+__attribute__((destructor)) static void printCycleProfile(void){
+	if (ac_fn_names == NULL){ return; }
+	const char ** names = malloc(sizeof(char *) * ac_fn_num);
+	int64_t * order = malloc(sizeof(int64_t) * ac_fn_num);
+	int64_t total = 0;
+	const char * name = ac_fn_names;
+	for (int64_t i = 0; i < ac_fn_num; i++){
+		names[i] = name;
+		name += strlen(name) + 1;
+		order[i] = i;
+		total += ac_fn_stats[4 * i + 2];
+	}
+	qsort(order, ac_fn_num, sizeof(int64_t), bySelfCycles);
+
+	fprintf(stderr, "Flat profile (rdtsc cycles):\n");
+	fprintf(stderr, "%7s %16s %16s %12s  %s\n",
+		"%self", "self", "inclusive", "calls", "procedure");
+	for (int64_t i = 0; i < ac_fn_num; i++){
+		const int64_t * stats = &ac_fn_stats[4 * order[i]];
+		if (stats[0] == 0){ continue; }
+		double share = total > 0 ? 100.0 * stats[2] / total : 0.0;
+		fprintf(stderr, "%7.2f %16" PRId64 " %16" PRId64 " %12" PRId64 "  %s\n",
+			share, stats[2], stats[1], stats[0], names[order[i]]);
+	}
+	free(order);
+	free(names);
+}
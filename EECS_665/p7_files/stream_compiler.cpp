@@ -0,0 +1,180 @@
+#include <cctype>
+#include <set>
+#include "stream_compiler.hpp"
+#include "fn_cache.hpp"
+#include "pass_manager.hpp"
+#include "pass_timer.hpp"
+#include "symbol_table.hpp"
+#include "tokens.hpp"
+#include "type_analysis.hpp"
+
+namespace a_lang{
+
+StreamCompiler::StreamCompiler(X64Emitter& outIn, PassManager * passesIn,
+  FnCache * cacheIn, const TokenBuffer * sourceIn)
+: out(outIn), passes(passesIn), cache(cacheIn), source(sourceIn),
+  firstID(0), namesOK(true), typesOK(true){
+	symTab = new SymbolTable();
+	symTab->enterScope();
+	prog = new IRProgram(nullptr);
+}
+
+StreamCompiler::~StreamCompiler(){
+	delete prog;
+	delete symTab;
+}
+
+void StreamCompiler::declare(DeclNode * decl){
+	//Once there has been an error nothing more is written, so
+	// there is nothing to reuse or to save
+	std::string key;
+	FnDeclNode * fn = decl->asFnDecl();
+	bool reused = false;
+	if (cache != nullptr && fn != nullptr && namesOK && typesOK){
+		PassTimer::Phase phase("cache");
+		key = cacheKey(fn);
+		reused = !key.empty() && reuse(fn, key);
+	}
+	if (!reused){
+		compile(decl, key);
+	}
+
+	ASTNode::destroy(decl);
+	firstID = ASTNode::numIDs();
+}
+
+static bool isIdentChar(char c){
+	return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+std::string StreamCompiler::cacheKey(FnDeclNode * fn){
+	if (source == nullptr){ return ""; }
+	size_t begin = fn->pos()->beginOffset();
+	size_t end = fn->pos()->endOffset();
+	if (begin >= end || end > source->sourceSize()){ return ""; }
+	const char * text = source->source() + begin;
+	size_t len = end - begin;
+	if (!FnCache::cacheable(text, len)){ return ""; }
+
+	std::string key = out.comments() ? "comments\n" : "no comments\n";
+	if (passes != nullptr){ key += passes->describe() + "\n"; }
+	key.append(text, len);
+	key += "\n";
+
+	//Any word in the text could name a global (the ones that
+	// don't, like keywords, just cost a line of key)
+	std::set<std::string> seen;
+	size_t i = 0;
+	while (i < len){
+		if (!isIdentChar(text[i])){ i++; continue; }
+		size_t start = i;
+		while (i < len && isIdentChar(text[i])){ i++; }
+		if (isdigit(static_cast<unsigned char>(text[start]))){
+			continue;
+		}
+		std::string word(text + start, i - start);
+		if (!seen.insert(word).second){ continue; }
+
+		key += word;
+		SemSymbol * sym = symTab->find(word);
+		if (sym == nullptr){
+			key += " none\n";
+		} else {
+			key += sym->getKind() == FN ? " fn " : " var ";
+			key += sym->getDataType()->getString();
+			key += "\n";
+		}
+	}
+	return key;
+}
+
+bool StreamCompiler::reuse(FnDeclNode * fn, const std::string& key){
+	FnCache::Entry entry;
+	if (!cache->lookup(key, entry)){ return false; }
+
+	//The body was compiled cleanly before with every name in
+	// it meaning the same thing, so only the signature needs
+	// declaring, for the functions after this one
+	Report::setSink(&nameErrs);
+	namesOK = fn->nameSignature(symTab) && namesOK;
+	Report::setSink(nullptr);
+	if (namesOK){
+		out << FnCache::renumber(entry,
+			prog->labelsMade(), prog->stringsMade());
+		prog->reuseProc(fn->ID()->getSymbol(),
+			entry.numLabels, entry.numStrings);
+	}
+	return true;
+}
+
+void StreamCompiler::compile(DeclNode * decl, const std::string& key){
+	Report::setSink(&nameErrs);
+	{
+		PassTimer::Phase phase("name analysis");
+		phase.items("nodes", ASTNode::numIDs() - firstID);
+		namesOK = decl->nameAnalysis(symTab) && namesOK;
+	}
+
+	//Once any declaration has a name error, the later ones are
+	// only name checked, as the whole-program passes would do
+	if (namesOK){
+		Report::setSink(&typeErrs);
+		TypeAnalysis * typing;
+		{
+			PassTimer::Phase phase("type analysis");
+			phase.items("nodes", ASTNode::numIDs() - firstID);
+			typing = TypeAnalysis::build(decl, firstID);
+		}
+		typesOK = typing->passed() && typesOK;
+		//Nothing more is written after an error, since the
+		// output will be thrown away
+		if (typesOK){
+			FnCache::Entry entry;
+			entry.labelBase = prog->labelsMade();
+			entry.strBase = prog->stringsMade();
+			prog->setTypes(typing);
+			{
+				PassTimer::Phase phase("3AC");
+				size_t quads = prog->numQuads();
+				decl->to3AC(prog);
+				phase.items("quads", prog->numQuads() - quads);
+			}
+			if (passes != nullptr){
+				PassTimer::Phase phase("optimize");
+				passes->run(prog);
+				phase.items("quads", prog->numQuads());
+			}
+			PassTimer::Phase phase("x64");
+			size_t written = out.written();
+			if (key.empty()){
+				prog->streamX64(out);
+			} else {
+				//Keep a copy of the code for the cache
+				std::ostringstream text;
+				X64Emitter capture(text, 1 << 12);
+				capture.setComments(out.comments());
+				prog->streamX64(capture);
+				capture.flush();
+				entry.text = text.str();
+				entry.numLabels = prog->labelsMade() - entry.labelBase;
+				entry.numStrings = prog->stringsMade() - entry.strBase;
+				out << entry.text;
+				cache->store(key, entry);
+			}
+			phase.items("bytes", out.written() - written);
+			prog->setTypes(nullptr);
+		}
+		delete typing;
+	}
+	Report::setSink(nullptr);
+}
+
+bool StreamCompiler::finish(){
+	out.flush();
+	std::cerr << nameErrs.str();
+	if (!namesOK){ return false; }
+	std::cerr << typeErrs.str();
+	return typesOK;
+}
+
+}
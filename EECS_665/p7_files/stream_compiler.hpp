@@ -0,0 +1,66 @@
+#ifndef A_LANG_STREAM_COMPILER_HPP
+#define A_LANG_STREAM_COMPILER_HPP
+
+#include <sstream>
+#include "ast.hpp"
+#include "x64_emitter.hpp"
+
+namespace a_lang{
+
+class SymbolTable;
+class TokenBuffer;
+class FnCache;
+class PassManager;
+
+//Compiles a program one top-level declaration at a time, as
+// the parser finishes each one: the declaration is name
+// checked, typed, lowered and written out, then its AST, types
+// and IR are freed before the next one is parsed. Memory use
+// then depends on the biggest function rather than the whole
+// program.
+//
+// Errors are held back and printed by finish() in the same
+// order the whole-program passes would print them, so a name
+// error anywhere still hides every type error.
+class StreamCompiler : public DeclSink{
+public:
+	//With a cache, functions whose source and surroundings are
+	// unchanged since an earlier compile are copied from it
+	// rather than compiled. The cache keys on function source,
+	// which it reads from source. Each declaration's 3AC goes
+	// through passesIn (if given) before it is written.
+	StreamCompiler(X64Emitter& outIn, PassManager * passesIn = nullptr,
+	  FnCache * cacheIn = nullptr, const TokenBuffer * sourceIn = nullptr);
+	~StreamCompiler();
+	StreamCompiler(const StreamCompiler&) = delete;
+	StreamCompiler& operator=(const StreamCompiler&) = delete;
+
+	void declare(DeclNode * decl) override;
+	//Report the held-back errors. Returns whether the program
+	// compiled, i.e. whether the output is usable.
+	bool finish();
+private:
+	//Everything the function's code depends on: its text, and
+	// what each name in it meant just before it was declared
+	std::string cacheKey(FnDeclNode * fn);
+	bool reuse(FnDeclNode * fn, const std::string& key);
+	void compile(DeclNode * decl, const std::string& key);
+
+	X64Emitter& out;
+	SymbolTable * symTab;
+	IRProgram * prog;
+	PassManager * passes;
+	FnCache * cache;
+	const TokenBuffer * source;
+	//First node ID of the declaration being parsed (the parser
+	// numbers nodes from 0, whatever was parsed before)
+	size_t firstID;
+	bool namesOK;
+	bool typesOK;
+	std::ostringstream nameErrs;
+	std::ostringstream typeErrs;
+};
+
+}
+
+#endif
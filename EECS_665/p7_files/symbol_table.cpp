@@ -2,8 +2,30 @@
 #include "types.hpp"
 namespace a_lang {
 
-SymbolTable::SymbolTable(){
+std::atomic<size_t> SemSymbol::nextID(0);
+
+SymbolTable::SymbolTable()
+: myGlobals(nullptr), myVisibleIDs(0){
+	scopeTableChain = new std::list<ScopeTable *>();
+}
+
+SymbolTable::SymbolTable(ScopeTable * globals, ScopeTable * fnScope,
+  size_t visibleIDs)
+: myGlobals(globals), myVisibleIDs(visibleIDs){
 	scopeTableChain = new std::list<ScopeTable *>();
+	scopeTableChain->push_front(globals);
+	scopeTableChain->push_front(fnScope);
+}
+
+SymbolTable::~SymbolTable(){
+	for (ScopeTable * scope : ownedScopes){ delete scope; }
+	delete scopeTableChain;
+}
+
+void SymbolTable::adopt(SymbolTable& other){
+	ownedScopes.insert(ownedScopes.end(),
+		other.ownedScopes.begin(), other.ownedScopes.end());
+	other.ownedScopes.clear();
 }
 
 void SymbolTable::print(){
@@ -15,10 +37,15 @@ void SymbolTable::print(){
 
 ScopeTable * SymbolTable::enterScope(){
 	ScopeTable * newScope = new ScopeTable();
+	ownedScopes.push_back(newScope);
 	scopeTableChain->push_front(newScope);
 	return newScope;
 }
 
+void SymbolTable::resumeScope(ScopeTable * scope){
+	scopeTableChain->push_front(scope);
+}
+
 void SymbolTable::leaveScope(){
 	if (scopeTableChain->empty()){
 		throw new InternalError("Attempt to pop"
@@ -39,7 +66,11 @@ bool SymbolTable::clash(std::string varName){
 SemSymbol * SymbolTable::find(std::string varName){
 	for (ScopeTable * scope : *scopeTableChain){
 		SemSymbol * sym = scope->lookup(varName);
-		
+		if (sym != nullptr && scope == myGlobals
+		  && sym->getID() >= myVisibleIDs){
+			//Declared after the function being analysed
+			return nullptr;
+		}
 		if (sym != nullptr) { return sym; }
 	}
 	return nullptr;
@@ -53,6 +84,11 @@ ScopeTable::ScopeTable(){
 	symbols = new HashMap<std::string, SemSymbol *>();
 }
 
+ScopeTable::~ScopeTable(){
+	for (auto entry : *symbols){ delete entry.second; }
+	delete symbols;
+}
+
 std::string ScopeTable::toString() const{
 	std::string result = "";
 	for (auto entry : *symbols){
@@ -1,8 +1,10 @@
 #ifndef A_LANG_SYMBOL_TABLE_HPP
 #define A_LANG_SYMBOL_TABLE_HPP
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include "types.hpp"
 
 //Use an alias template so that we can use
@@ -27,13 +29,20 @@ enum SymbolKind {
 class SemSymbol {
 public:
 	SemSymbol(std::string nameIn, const DataType * typeIn)
-	: myName(nameIn), myType(typeIn){ 
+	: myName(nameIn), myType(typeIn), myID(nextID++){ 
 		if (myType == nullptr){
 			throw new InternalError("symbol with no type");
 		}
 	}
+	virtual ~SemSymbol(){ }
 	virtual std::string toString() const;
-	std::string getName() const { return myName; }
+	const std::string& getName() const { return myName; }
+	//Dense ID in creation order, used to index per-symbol
+	// tables (e.g. the operand of each symbol during 3AC)
+	size_t getID() const { return myID; }
+	static size_t numIDs(){ return nextID; }
+	//Only once every symbol made so far is dead
+	static void resetIDs(){ nextID = 0; }
 	virtual SymbolKind getKind() const = 0;
 
 	virtual const DataType * getDataType() const{
@@ -49,6 +58,10 @@ public:
 protected:
 	std::string myName;
 	const DataType * myType;
+private:
+	const size_t myID;
+	//Function bodies may be analysed on several threads at once
+	static std::atomic<size_t> nextID;
 };
 
 class VarSymbol : public SemSymbol {
@@ -75,6 +88,10 @@ public:
 class ScopeTable {
 	public:
 		ScopeTable();
+		//Frees the scope's symbols
+		~ScopeTable();
+		ScopeTable(const ScopeTable&) = delete;
+		ScopeTable& operator=(const ScopeTable&) = delete;
 		SemSymbol * lookup(std::string name);
 		bool insert(SemSymbol * symbol);
 		bool clash(std::string name);
@@ -94,7 +111,23 @@ class ScopeTable {
 class SymbolTable{
 	public:
 		SymbolTable();
+		//A table for analysing one function body apart from the
+		// rest of the program: it starts in the function's own
+		// scope, backed by the global scope, and only sees the
+		// globals declared before the function (symbol IDs below
+		// visibleIDs), just as when the program is analysed in order
+		SymbolTable(ScopeTable * globals, ScopeTable * fnScope,
+		  size_t visibleIDs);
+		//Frees every scope entered through this table, and so
+		// every symbol declared in them
+		~SymbolTable();
+		SymbolTable(const SymbolTable&) = delete;
+		SymbolTable& operator=(const SymbolTable&) = delete;
+		//Take over the scopes other has entered, so they outlive it
+		void adopt(SymbolTable& other);
 		ScopeTable * enterScope();
+		//Make a scope left earlier the current one again
+		void resumeScope(ScopeTable * scope);
 		void leaveScope();
 		ScopeTable * getCurrentScope();
 		bool insert(SemSymbol * symbol);
@@ -109,6 +142,9 @@ class SymbolTable{
 		void print();
 	private:
 		std::list<ScopeTable *> * scopeTableChain;
+		std::vector<ScopeTable *> ownedScopes;
+		ScopeTable * myGlobals;
+		size_t myVisibleIDs;
 };
 
 
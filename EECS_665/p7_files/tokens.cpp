@@ -1,10 +1,17 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
 #include "tokens.hpp" // Get the class declarations
+#include "errors.hpp"
 #include "frontend.hh" // Get the TokenKind definitions
 
 namespace a_lang{
 
 using TokenKind = a_lang::Parser::token;
-using Lexeme = a_lang::Parser::semantic_type;
 
 static std::string tokenKindString(int tokKind){
 	switch(tokKind){
@@ -58,60 +65,165 @@ static std::string tokenKindString(int tokKind){
 	}
 }
 
-Token::Token(Position * posIn, int kindIn)
-  : myPos(posIn), myKind(kindIn){
+TokenBuffer::TokenBuffer()
+: linesIndexed(0), myMapped(nullptr), myMapLen(0){
+	lineStarts.push_back(0);
 }
 
-std::string Token::toString(){
-	return tokenKindString(kind())
-	+ " " + myPos->begin();
+TokenBuffer::~TokenBuffer(){
+	clear();
 }
 
-int Token::kind() const { 
-	return this->myKind; 
+void TokenBuffer::clear(){
+	kinds.clear();
+	offsets.clear();
+	lengths.clear();
+	values.clear();
+	lineStarts.assign(1, 0);
+	linesIndexed = 0;
+	myOwnedSource.clear();
+	if (myMapped != nullptr){
+		munmap(const_cast<char *>(myMapped), myMapLen);
+		myMapped = nullptr;
+	}
+	myMapLen = 0;
+}
+
+void TokenBuffer::mapSource(const char * path){
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		std::string msg = "Bad input stream ";
+		msg += path;
+		throw new InternalError(msg.c_str());
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		std::string msg = "Cannot stat ";
+		msg += path;
+		throw new InternalError(msg.c_str());
+	}
+	size_t len = static_cast<size_t>(info.st_size);
+	if (len > 0){
+		void * map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED){
+			close(fd);
+			std::string msg = "Cannot map ";
+			msg += path;
+			throw new InternalError(msg.c_str());
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+		myMapped = static_cast<const char *>(map);
+		myMapLen = len;
+	}
+	close(fd);
+}
+
+void TokenBuffer::appendSource(const char * text, size_t len){
+	myOwnedSource.append(text, len);
 }
 
-const Position * Token::pos() const {
-	return myPos;
+const char * TokenBuffer::source() const {
+	if (myMapped != nullptr){ return myMapped; }
+	return myOwnedSource.data();
 }
 
-IDToken::IDToken(Position * posIn, std::string vIn)
-  : Token(posIn, TokenKind::ID), myValue(vIn){ 
+size_t TokenBuffer::sourceSize() const {
+	if (myMapped != nullptr){ return myMapLen; }
+	return myOwnedSource.size();
 }
 
-std::string IDToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ myValue + " " + myPos->begin();
+size_t TokenBuffer::add(int kind, size_t offset, size_t len, int value){
+	//Offsets are stored in 32 bits to keep the arrays small
+	if (offset + len > UINT32_MAX){
+		throw new InternalError("Source file too large to tokenize");
+	}
+	kinds.push_back(static_cast<uint16_t>(kind));
+	offsets.push_back(static_cast<uint32_t>(offset));
+	lengths.push_back(static_cast<uint32_t>(len));
+	values.push_back(value);
+	return kinds.size() - 1;
+}
+
+void TokenBuffer::append(const TokenBuffer& chunk){
+	size_t count = chunk.size();
+	if (chunk.complete()){ count--; }
+	auto take = [count](const auto& from, auto& to){
+		to.insert(to.end(), from.begin(), from.begin() + static_cast<long>(count));
+	};
+	take(chunk.kinds, kinds);
+	take(chunk.offsets, offsets);
+	take(chunk.lengths, lengths);
+	take(chunk.values, values);
+}
+
+void TokenBuffer::reserve(size_t numTokens){
+	kinds.reserve(numTokens);
+	offsets.reserve(numTokens);
+	lengths.reserve(numTokens);
+	values.reserve(numTokens);
 }
 
-const std::string IDToken::value() const { 
-	return this->myValue; 
+bool TokenBuffer::complete() const {
+	return !kinds.empty() && kinds.back() == TokenKind::END;
 }
 
-StrToken::StrToken(Position * posIn, std::string sIn)
-  : Token(posIn, TokenKind::STRINGLITERAL), myStr(sIn){
+std::string TokenBuffer::text(size_t tok) const {
+	return std::string(source() + offsets[tok], lengths[tok]);
 }
 
-std::string StrToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ this->myStr + " " + myPos->begin();
+//Record the line starts up to offset (source text is only
+// ever appended to, so what's already indexed stays valid)
+void TokenBuffer::indexLinesTo(size_t offset) const {
+	size_t end = std::min(offset, sourceSize());
+	if (end <= linesIndexed){ return; }
+	const char * text = source();
+	const char * p = text + linesIndexed;
+	const char * stop = text + end;
+	while (p < stop){
+		const void * nl = memchr(p, '\n', static_cast<size_t>(stop - p));
+		if (nl == nullptr){ break; }
+		p = static_cast<const char *>(nl) + 1;
+		lineStarts.push_back(static_cast<uint32_t>(p - text));
+	}
+	linesIndexed = end;
 }
 
-const std::string StrToken::str() const {
-	return this->myStr;
+void TokenBuffer::indexLines() const {
+	indexLinesTo(sourceSize());
 }
 
-IntLitToken::IntLitToken(Position * pos, int numIn)
-  : Token(pos, TokenKind::INTLITERAL), myNum(numIn){}
+void TokenBuffer::locate(size_t offset, size_t& line, size_t& col) const {
+	indexLinesTo(offset);
+	auto after = std::upper_bound(lineStarts.begin(), lineStarts.end(),
+		offset);
+	size_t idx = static_cast<size_t>(after - lineStarts.begin()) - 1;
+	line = idx + 1;
+	col = offset - lineStarts[idx] + 1;
+}
 
-std::string IntLitToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ std::to_string(this->myNum) + " "
-	+ myPos->begin();
+Position TokenBuffer::pos(size_t tok) const {
+	return Position(offsets[tok], offsets[tok] + lengths[tok]);
 }
 
-int IntLitToken::num() const {
-	return this->myNum;
+std::string TokenBuffer::toString(size_t tok) const {
+	std::string result = tokenKindString(kinds[tok]);
+	switch (kinds[tok]){
+	case TokenKind::ID:
+	case TokenKind::STRINGLITERAL:
+		result += ":" + text(tok);
+		break;
+	case TokenKind::INTLITERAL:
+		result += ":" + std::to_string(values[tok]);
+		break;
+	default:
+		break;
+	}
+	size_t line;
+	size_t col;
+	locate(offsets[tok], line, col);
+	return result + " [" + std::to_string(line)
+	  + "," + std::to_string(col) + "]";
 }
 
 } //End namespace a_lang
@@ -1,51 +1,74 @@
 #ifndef A_LANG_TOKEN_H
 #define A_LANG_TOKEN_H
 
+#include <stdint.h>
 #include <string>
+#include <vector>
 #include "position.hpp"
 
 namespace a_lang{
 
-class Token{
+//Every token of the input, stored as parallel arrays instead
+// of one heap object per token. The parser and the -t dump
+// refer to tokens by their index in the buffer. Lexemes are
+// not copied out: a token only records where it sits in the
+// source text the buffer holds (an mmapped file, or the text
+// an istream scanner has consumed so far). The table of line
+// starts that turns offsets into lines and columns is only
+// built as far as printing positions needs it.
+class TokenBuffer : public LineMap{
 public:
-	Token(Position * pos, int kindIn);
-	virtual std::string toString();
-	size_t line() const;
-	size_t col() const;
-	int kind() const;
-	const Position * pos() const;
-protected:
-	const Position * myPos;
-private:
-	const int myKind;
-};
+	TokenBuffer();
+	virtual ~TokenBuffer();
+	TokenBuffer(const TokenBuffer&) = delete;
+	TokenBuffer& operator=(const TokenBuffer&) = delete;
 
-class IDToken : public Token{
-public:
-	IDToken(Position * posIn, std::string valIn);
-	const std::string value() const;
-	virtual std::string toString() override;
-private:
-	const std::string myValue;
-	
-};
+	//Drop all tokens and source text
+	void clear();
 
-class StrToken : public Token{
-public:
-	StrToken(Position * posIn, std::string valIn);
-	virtual std::string toString() override;
-	const std::string str() const;
-private:
-	const std::string myStr;
-};
+	//Use the file at path, mapped into memory, as the source
+	void mapSource(const char * path);
+	//Append text consumed by a stream scanner to the source
+	void appendSource(const char * text, size_t len);
+	const char * source() const;
+	size_t sourceSize() const;
 
-class IntLitToken : public Token{
-public:
-	IntLitToken(Position * posIn, int numIn);
-	virtual std::string toString() override;
-	int num() const;
+	virtual void locate(size_t offset, size_t& line, size_t& col) const override;
+	//Build the whole line table now. Lookups that don't need
+	// to extend the table are safe from any thread.
+	void indexLines() const;
+
+	//Append a token and return its index
+	size_t add(int kind, size_t offset, size_t len, int value);
+	//Append the tokens and line starts of a buffer that lexed
+	// the next stretch of this buffer's source (minus its END)
+	void append(const TokenBuffer& chunk);
+	void reserve(size_t numTokens);
+	size_t size() const { return kinds.size(); }
+	//True once the END token has been recorded
+	bool complete() const;
+
+	int kind(size_t tok) const { return kinds[tok]; }
+	size_t offset(size_t tok) const { return offsets[tok]; }
+	size_t length(size_t tok) const { return lengths[tok]; }
+	int intValue(size_t tok) const { return values[tok]; }
+	std::string text(size_t tok) const;
+	Position pos(size_t tok) const;
+	std::string toString(size_t tok) const;
 private:
-	const int myNum;
+	void indexLinesTo(size_t offset) const;
+
+	std::vector<uint16_t> kinds;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> lengths;
+	std::vector<int32_t> values;
+	//Starts of the lines in source()[0, linesIndexed)
+	mutable std::vector<uint32_t> lineStarts;
+	mutable size_t linesIndexed;
+
+	std::string myOwnedSource;
+	const char * myMapped;
+	size_t myMapLen;
 };
 
 }
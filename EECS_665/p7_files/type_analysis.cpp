@@ -1,7 +1,11 @@
 #include <assert.h>
+#include <memory>
+#include <sstream>
 
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "ast_walk.hpp"
+#include "parallel.hpp"
 
 namespace a_lang {
 
@@ -21,12 +25,28 @@ static bool typeCondOpd(TypeAnalysis * ta, ExpNode * node){
 }
 
 
-TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
+bool ASTNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	throw new InternalError("No type analysis for this node");
+}
+
+bool ExpNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	typeAnalysis(walk.typing);
+	return false;
+}
+
+bool StmtNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	typeAnalysis(walk.typing);
+	return false;
+}
+
+TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis,
+  size_t jobs){
 	TypeAnalysis * typeAnalysis = new TypeAnalysis();
 	auto ast = nameAnalysis->ast;
 	typeAnalysis->ast = ast;
+	typeAnalysis->myTypes.assign(ast->nodeCount(), nullptr);
 
-	ast->typeAnalysis(typeAnalysis);
+	ast->typeAnalysis(typeAnalysis, jobs);
 	if (typeAnalysis->hasError){
 		return nullptr;
 	}
@@ -35,6 +55,14 @@ TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
 
 }
 
+TypeAnalysis * TypeAnalysis::build(DeclNode * decl, size_t firstID){
+	TypeAnalysis * typeAnalysis = new TypeAnalysis();
+	typeAnalysis->firstID = firstID;
+	typeAnalysis->myTypes.assign(decl->getID() + 1 - firstID, nullptr);
+	decl->typeAnalysis(typeAnalysis);
+	return typeAnalysis;
+}
+
 void ProgramNode::typeAnalysis(TypeAnalysis * typing){
 	for (auto decl : *myGlobals){
 		decl->typeAnalysis(typing);
@@ -42,6 +70,47 @@ void ProgramNode::typeAnalysis(TypeAnalysis * typing){
 	typing->nodeType(this, BasicType::VOID());
 }
 
+void ProgramNode::typeAnalysis(TypeAnalysis * typing, size_t jobs){
+	if (jobs <= 1){ return typeAnalysis(typing); }
+
+	//As in name analysis: globals and signatures in order, then
+	// the bodies in parallel, each writing its errors to a buffer
+	// that is printed in source order
+	size_t numDecls = myGlobals->size();
+	std::vector<std::ostringstream> errs(numDecls);
+	std::vector<FnDeclNode *> fns;
+	std::vector<size_t> fnErrs;
+
+	size_t idx = 0;
+	for (auto decl : *myGlobals){
+		Report::setSink(&errs[idx]);
+		FnDeclNode * fn = decl->asFnDecl();
+		if (fn == nullptr){
+			decl->typeAnalysis(typing);
+		} else {
+			fn->typeSignature(typing);
+			fns.push_back(fn);
+			fnErrs.push_back(idx);
+		}
+		idx++;
+	}
+
+	std::vector<std::unique_ptr<TypeAnalysis>> forks;
+	for (size_t k = 0; k < fns.size(); k++){
+		forks.emplace_back(typing->fork());
+	}
+	parallelFor(fns.size(), jobs, [&](size_t k){
+		Report::setSink(&errs[fnErrs[k]]);
+		fns[k]->typeBody(forks[k].get());
+		Report::setSink(nullptr);
+	});
+	Report::setSink(nullptr);
+
+	for (auto& err : errs){ Report::sink() << err.str(); }
+	for (auto& forked : forks){ typing->join(*forked); }
+	typing->nodeType(this, BasicType::VOID());
+}
+
 void IDNode::typeAnalysis(TypeAnalysis * typing){
 	assert(getSymbol() != nullptr);
 	const DataType * type = getSymbol()->getDataType();
@@ -71,20 +140,26 @@ void VarDeclNode::typeAnalysis(TypeAnalysis * typing){
 }
 
 void FnDeclNode::typeAnalysis(TypeAnalysis * typing){
+	typeSignature(typing);
+	typeBody(typing);
+}
+
+void FnDeclNode::typeSignature(TypeAnalysis * typing){
 	myRetType->typeAnalysis(typing);
 	const DataType * retDataType = typing->nodeType(myRetType);
 
-	//auto formalTypes = new std::list<const DataType *>();
-	auto formalNodes = new std::list<TypeNode *>();
+	std::list<TypeNode *> formalNodes;
 	for (auto formal : *myFormals){
 		formal->typeAnalysis(typing);
 		TypeNode * typeNode = formal->getTypeNode();
-		formalNodes->push_back(typeNode);
+		formalNodes.push_back(typeNode);
 	}
-	const TypeList * list = TypeList::produce(formalNodes);
+	const TypeList * list = TypeList::produce(&formalNodes);
 
 	typing->nodeType(this, FnType::produce(list, retDataType));
+}
 
+void FnDeclNode::typeBody(TypeAnalysis * typing){
 	typing->setCurrentFnType(typing->nodeType(this)->asFn());
 	for (auto stmt : *myBody){
 		stmt->typeAnalysis(typing);
@@ -154,9 +229,18 @@ void MaybeStmtNode::typeAnalysis(TypeAnalysis * typing){
 }
 
 void CallExpNode::typeAnalysis(TypeAnalysis * typing){
+	TypeWalk(typing).run(this);
+}
+
+bool CallExpNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	if (f.step == 0){ f.kids = walk.queue(myArgs); }
+	if (f.step < myArgs->size()){
+		return walk.visit(walk.kid(f, f.step));
+	}
+
+	TypeAnalysis * typing = walk.typing;
 	std::list<const DataType *> * aList = new std::list<const DataType *>();
 	for (auto actual : *myArgs){
-		actual->typeAnalysis(typing);
 		aList->push_back(typing->nodeType(actual));
 	}
 
@@ -167,7 +251,7 @@ void CallExpNode::typeAnalysis(TypeAnalysis * typing){
 	if (fnType == nullptr){
 		typing->errCallee(myCallee->pos());
 		typing->nodeType(this, ErrorType::produce());
-		return;
+		return false;
 	}
 
 	const TypeList * formals = fnType->getFormalTypes();
@@ -203,12 +287,10 @@ void CallExpNode::typeAnalysis(TypeAnalysis * typing){
 	}
 
 	typing->nodeType(this, fnType->getReturnType());
-	return;
+	return false;
 }
 
-void NegNode::typeAnalysis(TypeAnalysis * typing){
-
-	myExp->typeAnalysis(typing);
+void NegNode::typeResult(TypeAnalysis * typing){
 	const DataType * subType = typing->nodeType(myExp);
 
 	//Propagate error, don't re-report
@@ -223,8 +305,17 @@ void NegNode::typeAnalysis(TypeAnalysis * typing){
 	}
 }
 
-void NotNode::typeAnalysis(TypeAnalysis * typing){
-	myExp->typeAnalysis(typing);
+void UnaryExpNode::typeAnalysis(TypeAnalysis * typing){
+	TypeWalk(typing).run(this);
+}
+
+bool UnaryExpNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	if (f.step == 0){ return walk.visit(myExp); }
+	typeResult(walk.typing);
+	return false;
+}
+
+void NotNode::typeResult(TypeAnalysis * typing){
 	const DataType * childType = typing->nodeType(myExp);
 
 	if (childType->asError() != nullptr){
@@ -247,18 +338,17 @@ void TypeNode::typeAnalysis(TypeAnalysis * typing){
 }
 
 
-static bool typeMathOpd(TypeAnalysis * typing, ExpNode * opd){
-	opd->typeAnalysis(typing);
+static const DataType * typeMathOpd(TypeAnalysis * typing, ExpNode * opd){
 	const DataType * type = typing->nodeType(opd);
-	if (type->isInt()){ return true; }
+	if (type->isInt()){ return type; }
 	if (type->asError()){
 		//Don't re-report an error, but don't check for
 		// incompatibility
-		return false;
+		return nullptr;
 	}
 
 	typing->errMathOpd(opd->pos());
-	return false;
+	return nullptr;
 }
 
 /*
@@ -270,24 +360,20 @@ static const DataType * getEltType(const ArrayType * arrType){
 }
 */
 
-void BinaryExpNode::binaryMathTyping(
-	TypeAnalysis * typing
-){
-	bool lhsValid = typeMathOpd(typing, myExp1);
-	bool rhsValid = typeMathOpd(typing, myExp2);
-	if (!lhsValid || !rhsValid){
-		typing->nodeType(this, ErrorType::produce());
+static void binaryMathTyping(TypeAnalysis * typing, ExpNode * node,
+  const DataType * lhsType, const DataType * rhsType){
+	if (!lhsType || !rhsType){
+		typing->nodeType(node, ErrorType::produce());
 		return;
 	}
 
-	typing->nodeType(this, BasicType::INT());
+	typing->nodeType(node, BasicType::INT());
 	return;
 }
 
 static const DataType * typeLogicOpd(
 	TypeAnalysis * typing, ExpNode * opd
 ){
-	opd->typeAnalysis(typing);
 	const DataType * type = typing->nodeType(opd);
 
 	//Return type if it's valid
@@ -303,57 +389,31 @@ static const DataType * typeLogicOpd(
 	return NULL;
 }
 
-void BinaryExpNode::binaryLogicTyping(TypeAnalysis * typing){
-	const DataType * lhsType = typeLogicOpd(typing, myExp1);
-	const DataType * rhsType = typeLogicOpd(typing, myExp2);
+static void binaryLogicTyping(TypeAnalysis * typing, ExpNode * node,
+  const DataType * lhsType, const DataType * rhsType){
 	if (!lhsType || !rhsType){
-		typing->nodeType(this, ErrorType::produce());
+		typing->nodeType(node, ErrorType::produce());
 		return;
 	}
 
 	//Given valid operand types, check operator
 	if (lhsType->isBool() && rhsType->isBool()){
-		typing->nodeType(this, BasicType::BOOL());
+		typing->nodeType(node, BasicType::BOOL());
 		return;
 	}
 
 	//We never expect to get here, so we'll consider it
 	// an error with the compiler itself
 	throw new InternalError("Incomplete typing");
-	typing->nodeType(this, ErrorType::produce());
+	typing->nodeType(node, ErrorType::produce());
 	return;
 }
 
-void PlusNode::typeAnalysis(TypeAnalysis * typing){
-	binaryMathTyping(typing);
-}
-
-void MinusNode::typeAnalysis(TypeAnalysis * typing){
-	binaryMathTyping(typing);
-}
-
-void TimesNode::typeAnalysis(TypeAnalysis * typing){
-	binaryMathTyping(typing);
-}
-
-void DivideNode::typeAnalysis(TypeAnalysis * typing){
-	binaryMathTyping(typing);
-}
-
-void AndNode::typeAnalysis(TypeAnalysis * typing){
-	binaryLogicTyping(typing);
-}
-
-void OrNode::typeAnalysis(TypeAnalysis * typing){
-	binaryLogicTyping(typing);
-}
-
 static const DataType * typeEqOpd(
 	TypeAnalysis * typing, ExpNode * opd
 ){
 	assert(opd != nullptr || "opd is null!");
 
-	opd->typeAnalysis(typing);
 	const DataType * type = typing->nodeType(opd);
 
 	if (type->isInt()){ return type; }
@@ -366,38 +426,26 @@ static const DataType * typeEqOpd(
 	return ErrorType::produce();
 }
 
-void BinaryExpNode::binaryEqTyping(TypeAnalysis * typing){
-	const DataType * lhsType = typeEqOpd(typing, myExp1);
-	const DataType * rhsType = typeEqOpd(typing, myExp2);
-
+static void binaryEqTyping(TypeAnalysis * typing, ExpNode * node,
+  const DataType * lhsType, const DataType * rhsType){
 	if (lhsType->asError() || rhsType->asError()){
-		typing->nodeType(this, ErrorType::produce());
+		typing->nodeType(node, ErrorType::produce());
 		return;
 	}
 
 	if (lhsType == rhsType){
-		typing->nodeType(this, BasicType::BOOL());
+		typing->nodeType(node, BasicType::BOOL());
 		return;
 	}
 
-	typing->errEqOpr(pos());
-	typing->nodeType(this, ErrorType::produce());
+	typing->errEqOpr(node->pos());
+	typing->nodeType(node, ErrorType::produce());
 	return;
 }
 
-void EqualsNode::typeAnalysis(TypeAnalysis * typing){
-	binaryEqTyping(typing);
-	assert(typing->nodeType(this) != nullptr);
-}
-
-void NotEqualsNode::typeAnalysis(TypeAnalysis * typing){
-	binaryEqTyping(typing);
-}
-
 static const DataType * typeRelOpd(
 	TypeAnalysis * typing, ExpNode * opd
 ){
-	opd->typeAnalysis(typing);
 	const DataType * type = typing->nodeType(opd);
 
 	if (type->isInt()){ return type; }
@@ -410,17 +458,15 @@ static const DataType * typeRelOpd(
 	return nullptr;
 }
 
-void BinaryExpNode::binaryRelTyping(TypeAnalysis * typing){
-	const DataType * lhsType = typeRelOpd(typing, myExp1);
-	const DataType * rhsType = typeRelOpd(typing, myExp2);
-
+static void binaryRelTyping(TypeAnalysis * typing, ExpNode * node,
+  const DataType * lhsType, const DataType * rhsType){
 	if (!lhsType || !rhsType){
-		typing->nodeType(this, ErrorType::produce());
+		typing->nodeType(node, ErrorType::produce());
 		return;
 	}
 
 	if (lhsType->isInt() && rhsType->isInt()){
-		typing->nodeType(this, BasicType::BOOL());
+		typing->nodeType(node, BasicType::BOOL());
 		return;
 	}
 
@@ -429,20 +475,54 @@ void BinaryExpNode::binaryRelTyping(TypeAnalysis * typing){
 	return;
 }
 
-void GreaterNode::typeAnalysis(TypeAnalysis * typing){
-	binaryRelTyping(typing);
+void BinaryExpNode::typeAnalysis(TypeAnalysis * typing){
+	TypeWalk(typing).run(this);
 }
 
-void GreaterEqNode::typeAnalysis(TypeAnalysis * typing){
-	binaryRelTyping(typing);
+//Each operand is checked as soon as it has been typed, before
+// the other one is walked, so errors come out in source order
+const DataType * BinaryExpNode::typeOpd(TypeAnalysis * typing, ExpNode * opd){
+	switch (opTyping()){
+	case OpTyping::MATH: return typeMathOpd(typing, opd);
+	case OpTyping::LOGIC: return typeLogicOpd(typing, opd);
+	case OpTyping::EQ: return typeEqOpd(typing, opd);
+	case OpTyping::REL: return typeRelOpd(typing, opd);
+	}
+	throw new InternalError("Bad operator typing");
 }
 
-void LessNode::typeAnalysis(TypeAnalysis * typing){
-	binaryRelTyping(typing);
+void BinaryExpNode::typeResult(TypeAnalysis * typing,
+  const DataType * lhsType, const DataType * rhsType){
+	switch (opTyping()){
+	case OpTyping::MATH:
+		binaryMathTyping(typing, this, lhsType, rhsType);
+		return;
+	case OpTyping::LOGIC:
+		binaryLogicTyping(typing, this, lhsType, rhsType);
+		return;
+	case OpTyping::EQ:
+		binaryEqTyping(typing, this, lhsType, rhsType);
+		return;
+	case OpTyping::REL:
+		binaryRelTyping(typing, this, lhsType, rhsType);
+		return;
+	}
 }
 
-void LessEqNode::typeAnalysis(TypeAnalysis * typing){
-	binaryRelTyping(typing);
+bool BinaryExpNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	switch (f.step){
+	case 0:
+		return walk.visit(myExp1);
+	case 1:
+		walk.lhsTypes.push_back(typeOpd(walk.typing, myExp1));
+		return walk.visit(myExp2);
+	default: {
+		const DataType * lhsType = walk.lhsTypes.back();
+		walk.lhsTypes.pop_back();
+		typeResult(walk.typing, lhsType, typeOpd(walk.typing, myExp2));
+		return false;
+	}
+	}
 }
 
 void PostDecStmtNode::typeAnalysis(TypeAnalysis * typing){
@@ -517,77 +597,113 @@ void ToConsoleStmtNode::typeAnalysis(TypeAnalysis * typing){
 }
 
 void IfStmtNode::typeAnalysis(TypeAnalysis * typing){
-	//Start off the typing as void, but may update to error
-	typing->nodeType(this, BasicType::VOID());
+	TypeWalk(typing).run(this);
+}
 
-	myCond->typeAnalysis(typing);
-	const DataType * condType = typing->nodeType(myCond);
-	bool goodCond = true;
-	if (condType == nullptr){
-		typing->nodeType(this, ErrorType::produce());
-		goodCond = false;
-	} else if (condType->asError()){
-		typing->nodeType(this, ErrorType::produce());
-		goodCond = false;
-	} else if (!condType->isBool()){
-		goodCond = false;
-		typing->errCond(myCond->pos());
-		typing->nodeType(this,
-			ErrorType::produce());
+bool IfStmtNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	TypeAnalysis * typing = walk.typing;
+	if (f.step == 0){
+		//Start off the typing as void, but may update to error
+		typing->nodeType(this, BasicType::VOID());
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
 	}
 
-	for (auto stmt : *myBody){
-		stmt->typeAnalysis(typing);
+	size_t i = f.step - 1;
+	if (i == 0){
+		const DataType * condType = typing->nodeType(myCond);
+		//Whether the condition is good rides along in ok
+		f.ok = true;
+		if (condType == nullptr){
+			typing->nodeType(this, ErrorType::produce());
+			f.ok = false;
+		} else if (condType->asError()){
+			typing->nodeType(this, ErrorType::produce());
+			f.ok = false;
+		} else if (!condType->isBool()){
+			f.ok = false;
+			typing->errCond(myCond->pos());
+			typing->nodeType(this,
+				ErrorType::produce());
+		}
+	}
+
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i));
 	}
 
-	if (goodCond){
+	if (f.ok){
 		typing->nodeType(this, BasicType::produce(VOID));
 	} else {
 		typing->nodeType(this, ErrorType::produce());
 	}
+	return false;
 }
 
 void IfElseStmtNode::typeAnalysis(TypeAnalysis * typing){
-	myCond->typeAnalysis(typing);
-	const DataType * condType = typing->nodeType(myCond);
+	TypeWalk(typing).run(this);
+}
 
-	bool goodCond = true;
-	if (condType->asError()){
-		goodCond = false;
-		typing->nodeType(this, ErrorType::produce());
-	} else if (!condType->isBool()){
-		typing->errCond(myCond->pos());
-		goodCond = false;
+bool IfElseStmtNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	TypeAnalysis * typing = walk.typing;
+	if (f.step == 0){
+		f.kids = walk.queue(myBodyTrue);
+		walk.queue(myBodyFalse);
+		return walk.visit(myCond);
 	}
-	for (auto stmt : *myBodyTrue){
-		stmt->typeAnalysis(typing);
+
+	size_t i = f.step - 1;
+	if (i == 0){
+		const DataType * condType = typing->nodeType(myCond);
+		f.ok = true;
+		if (condType->asError()){
+			f.ok = false;
+			typing->nodeType(this, ErrorType::produce());
+		} else if (!condType->isBool()){
+			typing->errCond(myCond->pos());
+			f.ok = false;
+		}
 	}
-	for (auto stmt : *myBodyFalse){
-		stmt->typeAnalysis(typing);
+
+	if (i < myBodyTrue->size() + myBodyFalse->size()){
+		return walk.visit(walk.kid(f, i));
 	}
 
-	if (goodCond){
+	if (f.ok){
 		typing->nodeType(this, BasicType::produce(VOID));
 	} else {
 		typing->nodeType(this, ErrorType::produce());
 	}
+	return false;
 }
 
 void WhileStmtNode::typeAnalysis(TypeAnalysis * typing){
-	myCond->typeAnalysis(typing);
-	const DataType * condType = typing->nodeType(myCond);
+	TypeWalk(typing).run(this);
+}
 
-	typing->nodeType(this, BasicType::VOID());
-	if (condType->asError()){
-		typing->nodeType(this, ErrorType::produce());
-	} else if (!condType->isBool()){
-		typing->errCond(myCond->pos());
+bool WhileStmtNode::typeStep(TypeWalk& walk, WalkFrame& f){
+	TypeAnalysis * typing = walk.typing;
+	if (f.step == 0){
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond);
 	}
 
-	for (auto stmt : *myBody){
-		stmt->typeAnalysis(typing);
+	size_t i = f.step - 1;
+	if (i == 0){
+		const DataType * condType = typing->nodeType(myCond);
+
+		typing->nodeType(this, BasicType::VOID());
+		if (condType->asError()){
+			typing->nodeType(this, ErrorType::produce());
+		} else if (!condType->isBool()){
+			typing->errCond(myCond->pos());
+		}
 	}
 
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i));
+	}
+	return false;
 }
 
 void CallStmtNode::typeAnalysis(TypeAnalysis * typing){
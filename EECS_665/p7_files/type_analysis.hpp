@@ -1,6 +1,7 @@
 #ifndef A_LANG_TYPE_ANALYSIS
 #define A_LANG_TYPE_ANALYSIS
 
+#include <vector>
 #include "ast.hpp"
 #include "symbol_table.hpp"
 #include "types.hpp"
@@ -12,21 +13,49 @@ class NameAnalysis;
 
 // An instance of this class will be passed over the entire
 // AST. Rather than attaching types to each node, the
-// TypeAnalysis class contains a map from each ASTNode to it's
-// DataType. Thus, instead of attaching a type field to most nodes,
-// one can instead map the node to it's type, or lookup the node
-// in the map.
+// TypeAnalysis class contains a table from each ASTNode to it's
+// DataType. The table is a flat vector indexed by the node's
+// dense ID (see ASTNode::getID), so a lookup is a single index
+// rather than a hash of the node pointer.
 class TypeAnalysis {
 
 private:
 	//The private constructor here means that the type analysis
 	// can only be created via the static build function
 	TypeAnalysis(){
+		nodeToType = &myTypes;
+		firstID = 0;
+		currentFnType = nullptr;
 		hasError = false;
+		ast = nullptr;
+	}
+	//A fork writes into its parent's table (which is sized for
+	// every node up front, so forks never resize it) but keeps
+	// its own current function and error flag
+	TypeAnalysis(TypeAnalysis * parent){
+		nodeToType = parent->nodeToType;
+		firstID = parent->firstID;
+		currentFnType = nullptr;
+		hasError = false;
+		ast = parent->ast;
 	}
 
 public:
-	static TypeAnalysis * build(NameAnalysis * astRoot);
+	static TypeAnalysis * build(NameAnalysis * astRoot, size_t jobs = 1);
+	//Type a single top-level declaration whose nodes have IDs
+	// from firstID on. The table only spans those IDs. Unlike
+	// the whole-program build this always returns the analysis;
+	// check passed().
+	static TypeAnalysis * build(DeclNode * decl, size_t firstID);
+
+	//An analysis for one function body, to run on its own thread.
+	// Forks of the same analysis must type disjoint subtrees.
+	TypeAnalysis * fork(){
+		return new TypeAnalysis(this);
+	}
+	void join(const TypeAnalysis& forked){
+		hasError = hasError || forked.hasError;
+	}
 	//static TypeAnalysis * build();
 
 	//The type analysis has an instance variable to say whether
@@ -47,21 +76,27 @@ public:
 
 	//Set the type of a node. Note that the function name is
 	// overloaded: this 2-argument nodeType puts a value into the
-	// map with a given type.
+	// table with a given type.
 	void nodeType(const ASTNode * node, const DataType * type){
-		nodeToType[node] = type;
+		size_t id = slot(node);
+		if (id >= nodeToType->size()){
+			nodeToType->resize(id + 1, nullptr);
+		}
+		(*nodeToType)[id] = type;
 	}
 
-	//Gets the type of a node already placed in the map. Note
+	//Gets the type of a node already placed in the table. Note
 	// that this function name is overloaded: the 1-argument nodeType
-	// gets the type of the given node out of the map.
-	const DataType * nodeType(const ASTNode * node){
-		const DataType * res = nodeToType[node];
+	// gets the type of the given node out of the table.
+	const DataType * nodeType(const ASTNode * node) const{
+		size_t id = slot(node);
+		const DataType * res = nullptr;
+		if (id < nodeToType->size()){ res = (*nodeToType)[id]; }
 		if (res == nullptr){
 			const char * msg = "No type for node ";
 			throw new InternalError(msg);
 		}
-		return nodeToType[node];
+		return res;
 	}
 
 	//The following functions all report and error and
@@ -176,7 +211,17 @@ public:
 			"Non-lval assignment");
 	}
 private:
-	HashMap<const ASTNode *, const DataType *> nodeToType;
+	size_t slot(const ASTNode * node) const{
+		size_t id = node->getID();
+		if (id < firstID){
+			throw new InternalError("Node outside the typed range");
+		}
+		return id - firstID;
+	}
+
+	std::vector<const DataType *> myTypes;
+	std::vector<const DataType *> * nodeToType;
+	size_t firstID;
 	const FnType * currentFnType;
 	bool hasError;
 public:
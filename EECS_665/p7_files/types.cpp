@@ -53,31 +53,29 @@ static bool typelistMatch(const std::list<const DataType *> * first, const std::
 }
 
 TypeList * TypeList::produce(const std::list<TypeNode *> * typeNodes){
-	//Use a flyweight here
-	static std::list<TypeList *> knownLists;
-
-	std::list<const DataType *> * candidate = new std::list<const DataType *>();
+	std::list<const DataType *> candidate;
 	for (auto node : *typeNodes){
 		const TypeNode * n = &(*node);
-		const DataType * t = n->getType();
-		candidate->push_back(t);
+		candidate.push_back(n->getType());
 	}
+	return produce(candidate);
+}
 
-	TypeList * exists = nullptr;
+TypeList * TypeList::produce(const std::list<const DataType *>& typesIn){
+	//Use a flyweight here
+	static std::list<TypeList *> knownLists;
+	static std::mutex lock;
+
+	std::lock_guard<std::mutex> guard(lock);
 	for (TypeList * known : knownLists){
-		if (typelistMatch(known->types, candidate)){
-			exists = known;
-			break;
+		if (typelistMatch(known->types, &typesIn)){
+			return known;
 		}
 	}
 
-	if (!exists){
-		TypeList * t = new TypeList(candidate);
-		knownLists.push_back(t);
-		return t;
-	} else {
-		return exists;
-	}
+	TypeList * t = new TypeList(new std::list<const DataType *>(typesIn));
+	knownLists.push_back(t);
+	return t;
 }
 
 } //End namespace
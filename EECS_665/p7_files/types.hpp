@@ -2,6 +2,7 @@
 #define A_LANG_DATA_TYPES
 
 #include <list>
+#include <mutex>
 #include <sstream>
 #include "errors.hpp"
 
@@ -89,6 +90,9 @@ public:
 		}
 
 		static std::list<ImmutableType *> flyweights;
+		//Function bodies may be analysed on several threads
+		static std::mutex lock;
+		std::lock_guard<std::mutex> guard(lock);
 		for(ImmutableType * fly : flyweights){
 			if (fly->subType == in){
 				return fly;
@@ -120,6 +124,8 @@ public:
 	virtual size_t getSize() const override {
 		return subType->getSize();
 	}
+
+	const DataType * getSubType() const { return subType; }
 private:
 	ImmutableType(const DataType * sub)
 	: subType(sub){ }
@@ -161,16 +167,17 @@ public:
 		//means that the flyweights variable persists between
 		// multiple calls to this function (it is essentially
 		// a global variable that can only be accessed
-		// in this function).
-		static std::list<BasicType *> flyweights;
-		for(BasicType * fly : flyweights){
-			if (fly->getBaseType() == base){
-				return fly;
-			}
-		}
-		BasicType * newType = new BasicType(base);
-		flyweights.push_back(newType);
-		return newType;
+		// in this function). There are only four base types,
+		// so all of them are made the first time through (C++
+		// makes that initialization thread-safe) and lookups
+		// never write to the table afterwards.
+		static BasicType * const flyweights[] = {
+			new BasicType(BaseType::INT),
+			new BasicType(BaseType::VOID),
+			new BasicType(BaseType::STRING),
+			new BasicType(BaseType::BOOL),
+		};
+		return flyweights[base];
 	}
 	const BasicType * asBasic() const override {
 		return this;
@@ -221,6 +228,7 @@ private:
 class TypeList : public DataType{
 public:
 	static TypeList * produce(const std::list<TypeNode *> * typeNodes);
+	static TypeList * produce(const std::list<const DataType *>& typesIn);
 	size_t count() const{ return types->size(); }
 	size_t getSize() const {
 		size_t res = 0;
@@ -254,6 +262,8 @@ class FnType : public DataType{
 public:
 	static FnType * produce(const TypeList * inTypes, const DataType * outType){
 		static std::list<FnType *> knownFnTypes;
+		static std::mutex lock;
+		std::lock_guard<std::mutex> guard(lock);
 		for (auto knownFnType : knownFnTypes){
 			if (knownFnType->sameSigAs(inTypes, outType)){
 				return knownFnType;
@@ -1,4 +1,4 @@
-#include "ast.hpp"
+#include "ast_walk.hpp"
 #include "errors.hpp"
 
 namespace a_lang{
@@ -92,44 +92,78 @@ void PostDecStmtNode::unparse(std::ostream& out, int indent){
 }
 
 void IfStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "if (";
-	myCond->unparse(out, 0);
-	out << "){\n";
-	for (auto stmt : *myBody){
-		stmt->unparse(out, indent + 1);
+	UnparseWalk(out).run(this, indent);
+}
+
+bool IfStmtNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	if (f.step == 0){
+		doIndent(out, f.indent);
+		out << "if (";
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond, 0);
 	}
-	doIndent(out, indent);
+	if (f.step == 1){ out << "){\n"; }
+	size_t i = f.step - 1;
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i), f.indent + 1);
+	}
+	doIndent(out, f.indent);
 	out << "}\n";
+	return false;
 }
 
 void IfElseStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "if (";
-	myCond->unparse(out, 0);
-	out << "){\n";
-	for (auto stmt : *myBodyTrue){
-		stmt->unparse(out, indent + 1);
+	UnparseWalk(out).run(this, indent);
+}
+
+bool IfElseStmtNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	if (f.step == 0){
+		doIndent(out, f.indent);
+		out << "if (";
+		f.kids = walk.queue(myBodyTrue);
+		walk.queue(myBodyFalse);
+		return walk.visit(myCond, 0);
 	}
-	doIndent(out, indent);
-	out << "} else {\n";
-	for (auto stmt : *myBodyFalse){
-		stmt->unparse(out, indent + 1);
+	if (f.step == 1){ out << "){\n"; }
+	size_t i = f.step - 1;
+	size_t numTrue = myBodyTrue->size();
+	if (i < numTrue){
+		return walk.visit(walk.kid(f, i), f.indent + 1);
 	}
-	doIndent(out, indent);
+	if (i == numTrue){
+		doIndent(out, f.indent);
+		out << "} else {\n";
+	}
+	if (i < numTrue + myBodyFalse->size()){
+		return walk.visit(walk.kid(f, i), f.indent + 1);
+	}
+	doIndent(out, f.indent);
 	out << "}\n";
+	return false;
 }
 
 void WhileStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "while (";
-	myCond->unparse(out, 0);
-	out << "){\n";
-	for (auto stmt : *myBody){
-		stmt->unparse(out, indent + 1);
+	UnparseWalk(out).run(this, indent);
+}
+
+bool WhileStmtNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	if (f.step == 0){
+		doIndent(out, f.indent);
+		out << "while (";
+		f.kids = walk.queue(myBody);
+		return walk.visit(myCond, 0);
 	}
-	doIndent(out, indent);
+	if (f.step == 1){ out << "){\n"; }
+	size_t i = f.step - 1;
+	if (i < myBody->size()){
+		return walk.visit(walk.kid(f, i), f.indent + 1);
+	}
+	doIndent(out, f.indent);
 	out << "}\n";
+	return false;
 }
 
 void ReturnStmtNode::unparse(std::ostream& out, int indent){
@@ -165,117 +199,84 @@ void ExpNode::unparseNested(std::ostream& out){
 	out << ")";
 }
 
-void CallExpNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myCallee->unparse(out, 0);
-	out << "(";
-	
-	bool firstArg = true;
-	for(auto arg : *myArgs){
-		if (firstArg) { firstArg = false; }
-		else { out << ", "; }
-		arg->unparse(out, 0);
-	}
-	out << ")";
-}
-void CallExpNode::unparseNested(std::ostream& out){
-	unparse(out, 0);
+bool ASTNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	unparse(walk.out, f.indent);
+	return false;
 }
 
-void MinusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " - ";
-	myExp2->unparseNested(out);
+bool ExpNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	if (f.nested){ unparseNested(walk.out); }
+	else { unparse(walk.out, f.indent); }
+	return false;
 }
 
-void PlusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " + ";
-	myExp2->unparseNested(out);
-}
-
-void TimesNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " * ";
-	myExp2->unparseNested(out);
-}
-
-void DivideNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " / ";
-	myExp2->unparseNested(out);
-}
-
-void AndNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " and ";
-	myExp2->unparseNested(out);
-}
-
-void OrNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " or ";
-	myExp2->unparseNested(out);
+void CallExpNode::unparse(std::ostream& out, int indent){
+	UnparseWalk(out).run(this, indent);
 }
 
-void EqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " == ";
-	myExp2->unparseNested(out);
+void CallExpNode::unparseNested(std::ostream& out){
+	unparse(out, 0);
 }
 
-void NotEqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " != ";
-	myExp2->unparseNested(out);
+bool CallExpNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	if (f.step == 0){
+		doIndent(out, f.indent);
+		myCallee->unparse(out, 0);
+		out << "(";
+		f.kids = walk.queue(myArgs);
+	} else if (f.step < myArgs->size()){
+		out << ", ";
+	}
+	if (f.step < myArgs->size()){
+		return walk.visit(walk.kid(f, f.step), 0);
+	}
+	out << ")";
+	return false;
 }
 
-void GreaterNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " > ";
-	myExp2->unparseNested(out);
+void BinaryExpNode::unparse(std::ostream& out, int indent){
+	UnparseWalk(out).run(this, indent);
 }
 
-void GreaterEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " >= ";
-	myExp2->unparseNested(out);
+void BinaryExpNode::unparseNested(std::ostream& out){
+	UnparseWalk(out).run(this, 0, true);
 }
 
-void LessNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " < ";
-	myExp2->unparseNested(out);
+bool BinaryExpNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	switch (f.step){
+	case 0:
+		if (f.nested){ out << "("; }
+		doIndent(out, f.indent);
+		return walk.visit(myExp1, 0, true);
+	case 1:
+		out << " " << opString() << " ";
+		return walk.visit(myExp2, 0, true);
+	default:
+		if (f.nested){ out << ")"; }
+		return false;
+	}
 }
 
-void LessEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	myExp1->unparseNested(out); 
-	out << " <= ";
-	myExp2->unparseNested(out);
+void UnaryExpNode::unparse(std::ostream& out, int indent){
+	UnparseWalk(out).run(this, indent);
 }
 
-void NotNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "!";
-	myExp->unparseNested(out); 
+void UnaryExpNode::unparseNested(std::ostream& out){
+	UnparseWalk(out).run(this, 0, true);
 }
 
-void NegNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "-";
-	myExp->unparseNested(out); 
+bool UnaryExpNode::unparseStep(UnparseWalk& walk, WalkFrame& f){
+	std::ostream& out = walk.out;
+	if (f.step == 0){
+		if (f.nested){ out << "("; }
+		doIndent(out, f.indent);
+		out << opString();
+		return walk.visit(myExp, 0, true);
+	}
+	if (f.nested){ out << ")"; }
+	return false;
 }
 
 void ImmutableTypeNode::unparse(std::ostream& out, int indent){
@@ -1,93 +1,279 @@
 #include <ostream>
+#include <sstream>
 #include "3ac.hpp"
+#include "code_stats.hpp"
+#include "x64_emitter.hpp"
+#include "slot_alloc.hpp"
 
 namespace a_lang{
 
+static void allocGlobal(SymOpd * opd){
+	std::string s = "gbl_" + opd->getSym()->getName();
+	opd->setMemoryLoc(s);
+}
+
+static void datagenGlobal(X64Emitter& out, SymOpd * opd){
+	out << opd->getMemoryLoc()
+		<< ": " 
+		<< (opd->getWidth() == 1 ? ".byte" : ".quad")
+		<< " 0\n";
+}
+
+static void datagenString(X64Emitter& out, LitOpd * opd,
+  const std::string& val){
+	out << opd->getMemoryLoc()
+		<< ": .asciz "
+		<< val
+		<< "\n.align 8\n";
+}
+
 void IRProgram::allocGlobals(){
 	//Choose a label for each global
-	for (auto pair : globals) {
-		SymOpd * opd = pair.second;
-		std::string s = "gbl_" + opd->getSym()->getName();
-		opd->setMemoryLoc(s);
+	for (SymOpd * opd : globalOrder) {
+		allocGlobal(opd);
 	}
 
 }
 
-void IRProgram::datagenX64(std::ostream& out){
+void IRProgram::datagenX64(X64Emitter& out){
 	out << ".data\n";
-	for (auto pair : globals) {
-		SymOpd * opd = pair.second;
-		out << opd->getMemoryLoc()
-			<< ": " 
-			<< (opd->getWidth() == 8 ? ".byte" : ".quad")
-			<< " 0\n";
+	for (SymOpd * opd : globalOrder) {
+		datagenGlobal(out, opd);
 	}
 	
 	for (auto pair : strings) {
-		out << pair.first->getMemoryLoc()
-			<< ": .asciz "
-			<< pair.second
-			<< "\n.align 8\n";
+		datagenString(out, pair.first, pair.second);
+	}
+
+	//The runtime writes these out at exit (see std_alang.c)
+	if (profCounters > 0){
+		out << ".globl ac_prof_counts\n.globl ac_prof_num\n"
+			<< ".globl ac_prof_table\n"
+			<< ".align 8\nac_prof_counts: .zero " << 8 * profCounters << "\n"
+			<< "ac_prof_num: .quad " << profCounters << "\n"
+			<< "ac_prof_table: .asciz \"";
+		for (char c : profTable){
+			if (c == '\n'){ out << "\\n"; } else { out << c; }
+		}
+		out << "\"\n";
 	}
 
+	//Four counters per timed procedure: calls, inclusive cycles,
+	// self cycles and how deep in recursion it is now. The
+	// runtime prints them at exit, by the names that follow.
+	if (cycleProfile){
+		out << ".globl ac_fn_stats\n.globl ac_fn_num\n"
+			<< ".globl ac_fn_names\n"
+			<< ".align 8\nac_fn_stats: .zero " << 32 * procs->size() << "\n"
+			<< "ac_fn_num: .quad " << procs->size() << "\n"
+			<< "ac_fn_kids: .quad 0\n"
+			<< "ac_fn_names:\n";
+		for (Procedure * proc : *procs){
+			out << ".asciz \"" << proc->getName() << "\"\n";
+		}
+	}
+}
+
+void IRProgram::setProfileTable(size_t numCounters,
+  const std::string& table){
+	profCounters = numCounters;
+	profTable = table;
+}
+
+void IRProgram::setCycleProfile(bool on){
+	cycleProfile = on;
+	if (!on){ return; }
+	size_t timer = 0;
+	for (Procedure * proc : *procs){ proc->setTimer(timer++); }
 }
 
-void IRProgram::toX64(std::ostream& out){
+void IRProgram::toX64(X64Emitter& out){
 	allocGlobals();
 	datagenX64(out);
 	// Iterate over each procedure and codegen it
 	out << "\n.globl main\n.text\n\n";
 	for (Procedure * proc : *procs) {
+		if (proc->isCold()){ continue; }
 		proc->toX64(out);
 		out << "\n";
 	}
+	//Procedures a profiled run never called go where the linker
+	// keeps code that is unlikely to run, away from the rest
+	bool coldSection = false;
+	for (Procedure * proc : *procs) {
+		if (!proc->isCold()){ continue; }
+		if (!coldSection){
+			out << ".section .text.unlikely,\"ax\",@progbits\n\n";
+			coldSection = true;
+		}
+		proc->toX64(out);
+		out << "\n";
+	}
+}
+
+void IRProgram::statsX64(CodeStats& stats){
+	allocGlobals();
+	for (Procedure * proc : *procs) {
+		std::ostringstream text;
+		X64Emitter capture(text, 1 << 12);
+		capture.setComments(false);
+		proc->toX64(capture);
+		capture.flush();
+		stats.addProc(proc, text.str());
+	}
+}
+
+void IRProgram::streamX64(X64Emitter& out){
+	//The assembler lets .data and .text alternate, so each
+	// declaration's data can go just ahead of its code
+	if (!newGlobals.empty() || !strings.empty()){
+		out << ".data\n";
+		for (SymOpd * opd : newGlobals){
+			allocGlobal(opd);
+			datagenGlobal(out, opd);
+		}
+		for (auto pair : strings){
+			datagenString(out, pair.first, pair.second);
+		}
+	}
+	newGlobals.clear();
+
+	if (!procs->empty()){ out << "\n.text\n\n"; }
+	for (Procedure * proc : *procs){
+		if (proc->getName() == "main"){ out << ".globl main\n"; }
+		proc->toX64(out);
+		out << "\n";
+		delete proc;
+	}
+	procs->clear();
+
+	//Only this declaration's procedures used these strings
+	for (auto pair : strings){ delete pair.first; }
+	strings.clear();
+}
+
+void IRProgram::reuseProc(SemSymbol * fnSym, size_t numLabels,
+  size_t numStrings){
+	gatherGlobal(fnSym);
+	allocGlobal(newGlobals.back());
+	newGlobals.pop_back();
+	max_label += numLabels;
+	str_idx += numStrings;
+}
+
+//Bytes below %rsp that signal handlers leave alone (SysV)
+static const int RED_ZONE = 128;
+
+//Whether the quad's code calls out or stores an outgoing stack
+// argument, and so needs %rsp below the frame's slots
+static bool needsStack(Quad * quad){
+	if (SetArgQuad * arg = dynamic_cast<SetArgQuad *>(quad)){
+		return arg->getIndex() > 6;
+	}
+	return dynamic_cast<CallQuad *>(quad) != nullptr
+		|| dynamic_cast<ReadQuad *>(quad) != nullptr
+		|| dynamic_cast<WriteQuad *>(quad) != nullptr;
 }
 
 void Procedure::allocLocals(){
 	//Allocate space for locals
 	// Iterate over each procedure and codegen it
 	int formals_size = formals.size();
-	int locals_size = locals.size();
-	int temps_size = temps.size();
 	int offset;
+	//Formals past the sixth stay where the caller left them
+	int n = formals_size < 7 ? formals_size : 6;
 
-	int i = 1;
-	for (SymOpd * opd : formals) {
-		offset = (i <= 6) ? (-16 - (8 * i)) : (8 * (formals_size - i));
-		opd->setMemoryLoc(std::to_string(offset) + "(%rbp)");
-		i++;
+	//Locals and temps whose values are never live at once share
+	// a slot, below the formals the frame keeps
+	std::vector<Opd *> shared(locals.begin(), locals.end());
+	shared.insert(shared.end(), temps.begin(), temps.end());
+	size_t numSlots = 0;
+	std::vector<size_t> slotOf = SlotAllocator::assign(this, shared, numSlots);
+	int frameSlots = n + static_cast<int>(numSlots);
+
+	//Arguments past the sixth go at the bottom of the frame, in
+	// the order SysV wants them at a call, rather than being
+	// pushed; that keeps %rsp aligned without padding each call
+	int outgoing = 0;
+	for (Quad * quad : *bodyQuads){
+		SetArgQuad * arg = dynamic_cast<SetArgQuad *>(quad);
+		if (arg == nullptr || arg->getIndex() < 7){ continue; }
+		int slots = static_cast<int>(arg->getIndex()) - 6;
+		if (slots > outgoing){ outgoing = slots; }
 	}
 
-	int n = formals_size < 7 ? formals_size : 6;
+	//Slots are laid out from %rbp either way. A leaf whose slots
+	// fit in the red zone needs no frame at all, and finds them
+	// off %rsp instead (%rbp would be 8 above it); a procedure
+	// that calls only needs %rsp lowered on paths that do.
+	// -fprofile-cycles keeps its timers above the slots, in a
+	// full frame, and the outgoing arguments below them.
+	int top = timed ? -32 : -16;
+	int deepest = top - 8 * frameSlots;
+	bool leaf = true;
+	for (Quad * quad : *bodyQuads){
+		if (needsStack(quad)){ leaf = false; break; }
+	}
+	if (timed){
+		frame = FULL_FRAME;
+	} else if (leaf && deepest >= -8 - RED_ZONE){
+		frame = NO_FRAME;
+	} else if (!leaf && deepest >= -16 - RED_ZONE){
+		frame = LAZY_FRAME;
+	} else {
+		frame = FULL_FRAME;
+	}
+	auto slotLoc = [this](int offset){
+		if (frame == NO_FRAME){ return X64Emitter::stackLoc(offset + 8); }
+		return X64Emitter::frameLoc(offset);
+	};
 
-	i = 1;
-	for (auto pair : locals) {
-		offset = -16 - (8 * n) - (8 * i);
-		pair.second->setMemoryLoc(std::to_string(offset) + "(%rbp)");
+	int i = 1;
+	for (SymOpd * opd : formals) {
+		//The caller leaves the seventh argument just above the
+		// return address, the eighth above that, and so on
+		offset = (i <= 6) ? (top - (8 * i)) : (8 * (i - 7));
+		opd->setMemoryLoc(slotLoc(offset));
 		i++;
 	}
 
-	i = 1;
+	size_t idx = 0;
+	auto sharedLoc = [&](){
+		return slotLoc(top - (8 * n) - 8 * (static_cast<int>(slotOf[idx++]) + 1));
+	};
+	for (SymOpd * opd : locals) {
+		opd->setMemoryLoc(sharedLoc());
+	}
 	for (AuxOpd * opd : temps) {
-		offset = -16 - (8 * formals_size) - (8 * locals_size) - (8 * i);
-		opd->setMemoryLoc(std::to_string(offset) + "(%rbp)");
-		i++;
+		opd->setMemoryLoc(sharedLoc());
 	}
 
-	int align = ((8 * formals_size) + (8 * locals_size) + (8 * temps_size)) % 16;
-	allocBytes = align + (8 * n) + (8 * locals_size) + (8 * temps_size);
+	//%rsp is 16-byte aligned once %rbp is pushed, and has to stay
+	// so for calls
+	allocBytes = (8 * (frameSlots + outgoing) + 15) / 16 * 16;
 }
 
-void Procedure::toX64(std::ostream& out){
+void Procedure::toX64(X64Emitter& out){
 	//Allocate all locals
 	allocLocals();
 
 	enter->codegenLabels(out);
 	enter->codegenX64(out);
 	out << "#Fn body " << myName << "\n";
+	//With a lazy frame, %rsp goes below the slots ahead of the
+	// first call or push in each straight run of code. Setting
+	// it from %rbp lets every path do so, any number of times.
+	bool stackLow = false;
 	for (auto quad : *bodyQuads){
 		quad->codegenLabels(out);
-		out << "#" << quad->toString() << "\n";
+		if (!quad->getLabels().empty()){ stackLow = false; }
+		if (out.comments()){
+			out << "#" << quad->toString() << "\n";
+		}
+		if (frame == LAZY_FRAME && !stackLow && needsStack(quad)){
+			out << "leaq " << -16 - allocBytes << "(%rbp), %rsp\n";
+			stackLow = true;
+		}
 		quad->codegenX64(out);
 	}
 	out << "#Fn epilogue " << myName << "\n";
@@ -95,7 +281,7 @@ void Procedure::toX64(std::ostream& out){
 	leave->codegenX64(out);
 }
 
-void Quad::codegenLabels(std::ostream& out){
+void Quad::codegenLabels(X64Emitter& out){
 	if (labels.empty()){ return; }
 
 	size_t numLabels = labels.size();
@@ -107,29 +293,36 @@ void Quad::codegenLabels(std::ostream& out){
 	}
 }
 
-void BinOpQuad::codegenX64(std::ostream& out){
+void BinOpQuad::codegenX64(X64Emitter& out){
 	src1->genLoadVal(out, A);
-	src2->genLoadVal(out, B);
+	src2->genLoadVal(out, C);
 
-	if (opr == MULT64 || opr == DIV64) {
+	if (opr == DIV64) {
+		//idivq divides %rdx:%rax, so sign-extend the dividend
+		out << "cqto\n";
+		out << binOpToX64(opr) << " %rcx\n";
+	} else if (opr == MULT64) {
 		out << "xorq %rdx, %rdx\n";
-		out << binOpToX64(opr) << " %rbx\n";
+		out << binOpToX64(opr) << " %rcx\n";
 	} else if (opr == EQ64 || opr == NEQ64 || opr == GT64 || opr == GTE64 || opr == LT64 || opr == LTE64) {
-		out << "cmpq %rbx, %rax\n" 
-			<< binOpToX64(opr) << " " << "%al" << "\n";
+		//set* only writes %al, and the result is stored whole
+		out << "cmpq %rcx, %rax\n" 
+			<< binOpToX64(opr) << " " << "%al" << "\n"
+			<< "movzbq %al, %rax\n";
 	} else {
-		out << binOpToX64(opr) << " %rbx, %rax\n";
+		out << binOpToX64(opr) << " %rcx, %rax\n";
 	}
 	
 	dst->genStoreVal(out, A);
 }
 
-void UnaryOpQuad::codegenX64(std::ostream& out){
+void UnaryOpQuad::codegenX64(X64Emitter& out){
 	src->genLoadVal(out, A);
 	
 	if (op == NOT64) {
 		out <<"cmpq $0, %rax\n"
-			<< "setz %al\n";
+			<< "setz %al\n"
+			<< "movzbq %al, %rax\n";
 	} else if (op == NEG64) {
 		out << "negq %rax\n";
 	}
@@ -137,12 +330,12 @@ void UnaryOpQuad::codegenX64(std::ostream& out){
 	dst->genStoreVal(out, A);
 }
 
-void AssignQuad::codegenX64(std::ostream& out){
+void AssignQuad::codegenX64(X64Emitter& out){
 	src->genLoadVal(out, A);
 	dst->genStoreVal(out, A);
 }
 
-void ReadQuad::codegenX64(std::ostream& out){
+void ReadQuad::codegenX64(X64Emitter& out){
 	if (myDstType->isInt()) {
 		out << "callq getInt\n";
 	} else if (myDstType->isBool()) {
@@ -152,7 +345,7 @@ void ReadQuad::codegenX64(std::ostream& out){
 	myDst->genStoreVal(out, A);
 }
 
-void WriteQuad::codegenX64(std::ostream& out){
+void WriteQuad::codegenX64(X64Emitter& out){
 	mySrc->genLoadVal(out, DI);
 
 	if (mySrcType->isInt()) {
@@ -164,119 +357,183 @@ void WriteQuad::codegenX64(std::ostream& out){
 	}
 }
 
-void GotoQuad::codegenX64(std::ostream& out){
+void GotoQuad::codegenX64(X64Emitter& out){
 	out << "jmp " << tgt->getName() << "\n";
 }
 
-void IfzQuad::codegenX64(std::ostream& out){
+void IfzQuad::codegenX64(X64Emitter& out){
 	out << "movq $0, %rax\n";
 	cnd->genLoadVal(out, A);
 	out << "cmp $0, %rax\n";
 	out << "je " << tgt->toString() << "\n";
 }
 
-void NopQuad::codegenX64(std::ostream& out){
+void IfnzQuad::codegenX64(X64Emitter& out){
+	out << "movq $0, %rax\n";
+	cnd->genLoadVal(out, A);
+	out << "cmp $0, %rax\n";
+	out << "jne " << tgt->toString() << "\n";
+}
+
+void CountQuad::codegenX64(X64Emitter& out){
+	out << "incq ac_prof_counts+" << 8 * counter << "\n";
+}
+
+void NopQuad::codegenX64(X64Emitter& out){
 	out << "nop" << "\n";
 }
 
-void CallQuad::codegenX64(std::ostream& out){
+void CallQuad::codegenX64(X64Emitter& out){
 	out << "call fun_" << sym->getName() << "\n";
-	int args = sym->getDataType()->asFn()->getFormalTypes()->getSize();
+}
 
-	if((args / 8) > 6) {
-		int addback = 8 * (args - 6);
-		out << "addq $" << addback << ", %rsp\n";
-	}
+//rdtsc's 64-bit count in %rax (clobbering %rdx)
+static void genReadTSC(X64Emitter& out){
+	out << "rdtsc\n"
+		<< "shlq $32, %rdx\n"
+		<< "orq %rdx, %rax\n";
 }
 
-void EnterQuad::codegenX64(std::ostream& out){
+void EnterQuad::codegenX64(X64Emitter& out){
+	if (myProc->getFrame() == NO_FRAME){ return; }
 	out << "pushq %rbp\n"
 		<< "movq %rsp, %rbp\n"
-		<< "addq $16, %rbp\n" 
-		<< "subq $" << myProc->getAllocBytes() << ", %rsp\n";
-}
-
-void LeaveQuad::codegenX64(std::ostream& out){
-	out << "addq $" << myProc->getAllocBytes() << ", %rsp\n"
-		<< "popq %rbp\n"
+		<< "addq $16, %rbp\n";
+	if (myProc->getFrame() == LAZY_FRAME){ return; }
+	if (myProc->isTimed()){
+		//Push the cycles the caller's callees have taken so far,
+		// and when this call started, above the slots. %rdx holds
+		// an argument, so it is kept in %r11 meanwhile.
+		size_t stats = 32 * myProc->getTimer();
+		out << "movq %rdx, %r11\n";
+		genReadTSC(out);
+		out << "movq %r11, %rdx\n"
+			<< "pushq ac_fn_kids\n"
+			<< "movq $0, ac_fn_kids\n"
+			<< "pushq %rax\n"
+			<< "incq ac_fn_stats+" << stats << "\n"
+			<< "incq ac_fn_stats+" << stats + 24 << "\n";
+	}
+	out << "subq $" << myProc->getAllocBytes() << ", %rsp\n";
+}
+
+void LeaveQuad::codegenX64(X64Emitter& out){
+	switch (myProc->getFrame()){
+	case NO_FRAME:
+		out << "ret\n";
+		return;
+	case LAZY_FRAME:
+		//%rsp may or may not have been lowered on the way here
+		out << "leaq -16(%rbp), %rsp\n";
+		break;
+	case FULL_FRAME:
+		out << "addq $" << myProc->getAllocBytes() << ", %rsp\n";
+		break;
+	}
+	if (myProc->isTimed()){
+		//Self time leaves out the callees' time, and only the
+		// outermost of a recursion counts toward inclusive time
+		// (else the inner calls would be counted again). The
+		// return value is kept in %r11 meanwhile.
+		size_t stats = 32 * myProc->getTimer();
+		out << "movq %rax, %r11\n";
+		genReadTSC(out);
+		out << "popq %rdx\n"
+			<< "subq %rdx, %rax\n"
+			<< "movq %rax, %rdx\n"
+			<< "subq ac_fn_kids, %rdx\n"
+			<< "addq %rdx, ac_fn_stats+" << stats + 16 << "\n"
+			<< "movq $0, %rdx\n"
+			<< "decq ac_fn_stats+" << stats + 24 << "\n"
+			<< "cmovz %rax, %rdx\n"
+			<< "addq %rdx, ac_fn_stats+" << stats + 8 << "\n"
+			<< "popq %rdx\n"
+			<< "addq %rax, %rdx\n"
+			<< "movq %rdx, ac_fn_kids\n"
+			<< "movq %r11, %rax\n";
+	}
+	out << "popq %rbp\n"
 		<< "ret\n";
 }
 
-void SetArgQuad::codegenX64(std::ostream& out){
+void SetArgQuad::codegenX64(X64Emitter& out){
 	if(index <= 6) {
 		opd->genLoadVal(out, indexToReg(index));
 	} else {
+		//%rax isn't an argument register, so this can come
+		// between the ones that are
 		opd->genLoadVal(out, A);
-		out << "pushq %rax\n";
+		out << "movq %rax, " << X64Emitter::stackLoc(8 * (static_cast<long long>(index) - 7)) << "\n";
 	}
 }
 
-void GetArgQuad::codegenX64(std::ostream& out){
+void GetArgQuad::codegenX64(X64Emitter& out){
+	//Those past the sixth are used where the caller left them
 	if(index <= 6) {
 		opd->genStoreVal(out, indexToReg(index));
 	}
 }
 
-void SetRetQuad::codegenX64(std::ostream& out){
+void SetRetQuad::codegenX64(X64Emitter& out){
 	opd->genLoadVal(out, A);
 }
 
-void GetRetQuad::codegenX64(std::ostream& out){
+void GetRetQuad::codegenX64(X64Emitter& out){
 	opd->genStoreVal(out, A);
 }
 
-void LocQuad::codegenX64(std::ostream& out){
+void LocQuad::codegenX64(X64Emitter& out){
 	TODO(Implement me)
 }
 
-void SymOpd::genLoadVal(std::ostream& out, Register reg){
+void SymOpd::genLoadVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getMemoryLoc() << ", " << this->getReg(reg) << "\n";
 }
 
-void SymOpd::genStoreVal(std::ostream& out, Register reg){
+void SymOpd::genStoreVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getReg(reg) << ", " << this->getMemoryLoc() << "\n";	
 }
 
-void SymOpd::genLoadAddr(std::ostream& out, Register reg) {
+void SymOpd::genLoadAddr(X64Emitter& out, Register reg) {
 	out << "movq %eax, $0\n"
 		<< "leaq %eax, " << this->valString() << "\n";
 }
 
-void AuxOpd::genLoadVal(std::ostream& out, Register reg){
+void AuxOpd::genLoadVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getMemoryLoc() << ", " << this->getReg(reg) << "\n";
 }
 
-void AuxOpd::genStoreVal(std::ostream& out, Register reg){
+void AuxOpd::genStoreVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getReg(reg) << ", " << this->getMemoryLoc() << "\n";
 }
-void AuxOpd::genLoadAddr(std::ostream& out, Register reg){
+void AuxOpd::genLoadAddr(X64Emitter& out, Register reg){
 	out << "movq %eax, $0\n"
 		<< "leaq %eax, " << this->valString() << "\n";
 }
 
-void AddrOpd::genStoreVal(std::ostream& out, Register reg){
+void AddrOpd::genStoreVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getReg(reg) << ", " << this->getMemoryLoc() << "\n";
 }
 
-void AddrOpd::genLoadVal(std::ostream& out, Register reg){
+void AddrOpd::genLoadVal(X64Emitter& out, Register reg){
 	out << this->getMovOp() << this->getReg(reg) << ", " << this->getMemoryLoc() << "\n";
 }
 
-void AddrOpd::genStoreAddr(std::ostream& out, Register reg){
+void AddrOpd::genStoreAddr(X64Emitter& out, Register reg){
 	out << "movq %eax, $0\n"
 		<< "leaq %eax, " << this->valString() << "\n";
 }
 
-void AddrOpd::genLoadAddr(std::ostream & out, Register reg){
+void AddrOpd::genLoadAddr(X64Emitter & out, Register reg){
 	out << "movq %eax, " << this->locString() << "\n";
 
 }
 
-void LitOpd::genLoadVal(std::ostream & out, Register reg){
+void LitOpd::genLoadVal(X64Emitter & out, Register reg){
 	out << getMovOp() << " $" << val << ", " << getReg(reg) << "\n";
 }
 
-std::string binOpToX64(BinOp opr) {
+const char * binOpToX64(BinOp opr) {
 	switch(opr){
 	case ADD64: return "addq";
 	case SUB64: return "subq";
@@ -285,7 +542,7 @@ std::string binOpToX64(BinOp opr) {
 	case OR64: return "orq";
 	case AND64: return "andq";
 	case EQ64: return "sete";
-	case NEQ64: return "negq";
+	case NEQ64: return "setne";
 	case LT64: return "setl";
 	case GT64: return "setg";
 	case LTE64: return "setle";
@@ -298,7 +555,7 @@ std::string binOpToX64(BinOp opr) {
 	case OR8: return "orb";  
 	case AND8: return "andb";  
 	case EQ8: return "sete";  
-	case NEQ8: return "negb";  
+	case NEQ8: return "setne";  
 	case LT8: return "setl";  
 	case GT8: return "setg";  
 	case LTE8: return "setle";  
@@ -313,8 +570,8 @@ Register indexToReg(size_t index) {
 		case 2: return SI;
 		case 3: return D;
 		case 4: return C;
-		case 5: return A;
-		case 6: return B;
+		case 5: return R8;
+		case 6: return R9;
 		default: break;
 	}
 	throw new InternalError("Index out of range of target registers");
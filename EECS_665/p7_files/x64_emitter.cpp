@@ -0,0 +1,21 @@
+#include <string.h>
+#include "x64_emitter.hpp"
+
+namespace a_lang{
+
+static std::string slotLoc(long long offset, const char * base){
+	char loc[32];
+	size_t len = BufferedWriter::formatInt(loc, offset);
+	memcpy(loc + len, base, 6);
+	return std::string(loc, len + 6);
+}
+
+std::string X64Emitter::frameLoc(long long offset){
+	return slotLoc(offset, "(%rbp)");
+}
+
+std::string X64Emitter::stackLoc(long long offset){
+	return slotLoc(offset, "(%rsp)");
+}
+
+}
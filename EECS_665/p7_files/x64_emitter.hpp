@@ -0,0 +1,32 @@
+#ifndef A_LANG_X64_EMITTER_HPP
+#define A_LANG_X64_EMITTER_HPP
+
+#include <string>
+#include "buffered_writer.hpp"
+
+namespace a_lang{
+
+//Output sink for the x64 backend: a BufferedWriter plus
+// the knobs that control what the assembly looks like.
+class X64Emitter : public BufferedWriter{
+public:
+	X64Emitter(std::ostream& sinkIn,
+	  size_t capacityIn = DEFAULT_CAPACITY)
+	: BufferedWriter(sinkIn, capacityIn), myComments(true){ }
+
+	//Whether to annotate each instruction sequence with
+	// the 3AC quad it came from
+	void setComments(bool on){ myComments = on; }
+	bool comments() const { return myComments; }
+
+	//The operand string for a %rbp-relative frame slot
+	static std::string frameLoc(long long offset);
+	//...or for one relative to %rsp, in a procedure without %rbp
+	static std::string stackLoc(long long offset);
+private:
+	bool myComments;
+};
+
+}
+
+#endif